@@ -0,0 +1,303 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Utilidades del modo --benchmark: corpus sinteticos, estadisticas de varias
+// repeticiones, vaciado de la cache de paginas e informes JSON/CSV.
+// Las repeticiones en si las ejecuta main.cpp con los procesos base y optimizado.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Resumen de las repeticiones medidas de una configuracion (en microsegundos)
+struct EstadisticasTiempo {
+    size_t muestras = 0;
+    double media = 0;
+    double mediana = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double desviacion = 0;  // Desviacion estandar muestral
+    double minimo = 0;
+    double maximo = 0;
+};
+
+// Percentil p (0..100) de una lista ordenada, interpolando entre vecinos
+inline double percentilOrdenado(const std::vector<long long>& ordenados, double p) {
+    if (ordenados.empty()) {
+        return 0;
+    }
+    double pos = (p / 100.0) * static_cast<double>(ordenados.size() - 1);
+    size_t i = static_cast<size_t>(pos);
+    if (i + 1 >= ordenados.size()) {
+        return static_cast<double>(ordenados.back());
+    }
+    double fraccion = pos - static_cast<double>(i);
+    return static_cast<double>(ordenados[i]) * (1.0 - fraccion) + static_cast<double>(ordenados[i + 1]) * fraccion;
+}
+
+inline EstadisticasTiempo calcularEstadisticas(std::vector<long long> tiempos) {
+    EstadisticasTiempo e;
+    e.muestras = tiempos.size();
+    if (tiempos.empty()) {
+        return e;
+    }
+    std::sort(tiempos.begin(), tiempos.end());
+    double suma = 0;
+    for (long long t : tiempos) {
+        suma += static_cast<double>(t);
+    }
+    e.media = suma / static_cast<double>(tiempos.size());
+    double suma_cuadrados = 0;
+    for (long long t : tiempos) {
+        double d = static_cast<double>(t) - e.media;
+        suma_cuadrados += d * d;
+    }
+    e.desviacion = tiempos.size() > 1 ? std::sqrt(suma_cuadrados / static_cast<double>(tiempos.size() - 1)) : 0;
+    e.mediana = percentilOrdenado(tiempos, 50);
+    e.p95 = percentilOrdenado(tiempos, 95);
+    e.p99 = percentilOrdenado(tiempos, 99);
+    e.minimo = static_cast<double>(tiempos.front());
+    e.maximo = static_cast<double>(tiempos.back());
+    return e;
+}
+
+// Resultado de una configuracion (proceso, archivo, N, threads) del benchmark
+struct ResultadoBenchmark {
+    std::string proceso;        // "base" u "optimizado"
+    std::string archivo;
+    uint64_t tam_archivo = 0;
+    int N = 0;
+    unsigned int hilos = 0;     // 0 = segun los CPUs
+    std::string backend_es;
+    bool errores = false;       // Alguna repeticion fallo la verificacion
+    EstadisticasTiempo tiempos;
+    double mb_por_segundo = 0;  // N * tamaño / mediana, en MB (10^6 bytes) por segundo
+};
+
+// "256K", "4M", "1G" o un numero sin sufijo (MiB). Devuelve false si no es valido.
+inline bool parsearTamBytes(const std::string& texto, uint64_t& bytes) {
+    if (texto.empty()) {
+        return false;
+    }
+    size_t pos = 0;
+    unsigned long long valor = 0;
+    try {
+        valor = std::stoull(texto, &pos);
+    } catch (...) {
+        return false;
+    }
+    std::string sufijo = texto.substr(pos);
+    uint64_t unidad = 1024 * 1024;
+    if (sufijo == "K" || sufijo == "k") {
+        unidad = 1024;
+    } else if (sufijo == "G" || sufijo == "g") {
+        unidad = 1024ULL * 1024 * 1024;
+    } else if (!sufijo.empty() && sufijo != "M" && sufijo != "m") {
+        return false;
+    }
+    bytes = static_cast<uint64_t>(valor) * unidad;
+    return valor > 0;
+}
+
+// Lista separada por comas; cada elemento se interpreta con 'parsear'
+template <class T, class F>
+bool parsearLista(const std::string& texto, std::vector<T>& valores, F parsear) {
+    valores.clear();
+    std::stringstream ss(texto);
+    std::string elemento;
+    while (std::getline(ss, elemento, ',')) {
+        T valor;
+        if (!parsear(elemento, valor)) {
+            return false;
+        }
+        valores.push_back(valor);
+    }
+    return !valores.empty();
+}
+
+// Genera un texto pseudoaleatorio reproducible (letras, digitos, signos,
+// espacios y saltos de linea) del tamaño pedido, parecido a original.txt
+inline bool generarCorpusSintetico(const std::string& ruta, uint64_t tam, uint64_t semilla = 1) {
+    static const char alfabeto[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 .,;:!?-";
+    const size_t tam_alfabeto = sizeof(alfabeto) - 1;
+    std::ofstream ofs(ruta, std::ios::binary);
+    if (!ofs.is_open()) {
+        return false;
+    }
+    std::vector<char> buffer(1024 * 1024);
+    uint64_t estado = semilla * 0x9E3779B97F4A7C15ULL + 1;
+    uint64_t escritos = 0;
+    size_t columna = 0;
+    while (escritos < tam) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(buffer.size(), tam - escritos));
+        for (size_t i = 0; i < n; ++i) {
+            // xorshift64
+            estado ^= estado << 13;
+            estado ^= estado >> 7;
+            estado ^= estado << 17;
+            if (++columna >= 80) {
+                buffer[i] = '\n';
+                columna = 0;
+            } else {
+                buffer[i] = alfabeto[(estado >> 32) % tam_alfabeto];
+            }
+        }
+        ofs.write(buffer.data(), static_cast<std::streamsize>(n));
+        escritos += n;
+    }
+    return static_cast<bool>(ofs);
+}
+
+// Saca de la cache de paginas los datos de la siguiente repeticion para medir
+// en frio. Con permisos de root se vacia toda la cache (drop_caches); si no,
+// se pide al kernel que descarte las paginas de cada archivo indicado.
+// Devuelve el mecanismo usado, o nullptr si no se pudo.
+inline const char* vaciarCachePaginas(const std::vector<std::string>& archivos) {
+#if defined(__linux__)
+    ::sync();
+    {
+        std::ofstream drop("/proc/sys/vm/drop_caches");
+        if (drop.is_open()) {
+            drop << "3" << std::endl;
+            if (drop) {
+                return "drop_caches";
+            }
+        }
+    }
+#endif
+#if defined(__unix__) && !defined(__APPLE__)
+    bool alguno = false;
+    for (const std::string& ruta : archivos) {
+        int fd = ::open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        ::fdatasync(fd);
+        alguno |= ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        ::close(fd);
+    }
+    return alguno ? "fadvise" : nullptr;
+#else
+    (void)archivos;
+    return nullptr;
+#endif
+}
+
+// Descarta todo lo que se escriba en std::cout mientras existe (los procesos
+// medidos imprimen sus tiempos por archivo, que el benchmark no necesita)
+class SilenciarSalida {
+public:
+    SilenciarSalida() : anterior(std::cout.rdbuf(&nulo)) {}
+    ~SilenciarSalida() { std::cout.rdbuf(anterior); }
+
+    SilenciarSalida(const SilenciarSalida&) = delete;
+    SilenciarSalida& operator=(const SilenciarSalida&) = delete;
+
+private:
+    class BufferNulo : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+    BufferNulo nulo;
+    std::streambuf* anterior;
+};
+
+inline std::string escaparJSON(const std::string& texto) {
+    std::string r;
+    for (char c : texto) {
+        switch (c) {
+            case '"': r += "\\\""; break;
+            case '\\': r += "\\\\"; break;
+            case '\n': r += "\\n"; break;
+            case '\t': r += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char esc[8];
+                    std::snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    r += esc;
+                } else {
+                    r += c;
+                }
+        }
+    }
+    return r;
+}
+
+// Fecha y hora local en formato ISO 8601 (para fechar los informes)
+inline std::string fechaISO8601() {
+    std::time_t ahora = std::time(nullptr);
+    std::tm local{};
+#if defined(_WIN32)
+    localtime_s(&local, &ahora);
+#else
+    localtime_r(&ahora, &local);
+#endif
+    char texto[32];
+    std::strftime(texto, sizeof(texto), "%Y-%m-%dT%H:%M:%S", &local);
+    return texto;
+}
+
+// Informe JSON: los metadatos de la ejecucion y un objeto por configuracion
+inline bool escribirJSONBenchmark(const std::string& ruta, const std::vector<std::pair<std::string, std::string>>& metadatos,
+                                  const std::vector<ResultadoBenchmark>& resultados) {
+    std::ofstream ofs(ruta);
+    if (!ofs.is_open()) {
+        return false;
+    }
+    ofs << std::fixed << std::setprecision(1);
+    ofs << "{\n";
+    for (const auto& m : metadatos) {
+        ofs << "  \"" << escaparJSON(m.first) << "\": \"" << escaparJSON(m.second) << "\",\n";
+    }
+    ofs << "  \"resultados\": [";
+    for (size_t i = 0; i < resultados.size(); ++i) {
+        const ResultadoBenchmark& r = resultados[i];
+        const EstadisticasTiempo& t = r.tiempos;
+        ofs << (i == 0 ? "\n" : ",\n")
+            << "    {\"proceso\": \"" << escaparJSON(r.proceso) << "\", \"archivo\": \"" << escaparJSON(r.archivo) << "\""
+            << ", \"tam_archivo\": " << r.tam_archivo << ", \"n\": " << r.N << ", \"hilos\": " << r.hilos
+            << ", \"backend_es\": \"" << escaparJSON(r.backend_es) << "\", \"errores\": " << (r.errores ? "true" : "false")
+            << ", \"muestras\": " << t.muestras
+            << ", \"media_us\": " << t.media << ", \"mediana_us\": " << t.mediana
+            << ", \"p95_us\": " << t.p95 << ", \"p99_us\": " << t.p99 << ", \"desviacion_us\": " << t.desviacion
+            << ", \"min_us\": " << t.minimo << ", \"max_us\": " << t.maximo
+            << ", \"mb_por_s\": " << r.mb_por_segundo << "}";
+    }
+    ofs << "\n  ]\n}\n";
+    return static_cast<bool>(ofs);
+}
+
+// Informe CSV: una fila por configuracion, con cabecera
+inline bool escribirCSVBenchmark(const std::string& ruta, const std::vector<ResultadoBenchmark>& resultados) {
+    std::ofstream ofs(ruta);
+    if (!ofs.is_open()) {
+        return false;
+    }
+    ofs << std::fixed << std::setprecision(1);
+    ofs << "proceso,archivo,tam_archivo,n,hilos,backend_es,errores,muestras,media_us,mediana_us,p95_us,p99_us,desviacion_us,min_us,max_us,mb_por_s\n";
+    for (const ResultadoBenchmark& r : resultados) {
+        const EstadisticasTiempo& t = r.tiempos;
+        ofs << r.proceso << ',' << '"' << r.archivo << '"' << ',' << r.tam_archivo << ',' << r.N << ',' << r.hilos << ','
+            << r.backend_es << ',' << (r.errores ? 1 : 0) << ',' << t.muestras << ',' << t.media << ',' << t.mediana << ','
+            << t.p95 << ',' << t.p99 << ',' << t.desviacion << ',' << t.minimo << ',' << t.maximo << ',' << r.mb_por_segundo << '\n';
+    }
+    return static_cast<bool>(ofs);
+}
+
+#endif // BENCHMARK_H
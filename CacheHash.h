@@ -0,0 +1,216 @@
+#ifndef CACHE_HASH_H
+#define CACHE_HASH_H
+
+// Cache persistente de hashes y deduplicacion por contenido del modo por
+// directorios. El hash de un archivo de entrada se guarda con la clave
+// (dispositivo, inodo, tamaño, fecha de modificacion): mientras el archivo no
+// cambie, la siguiente ejecucion no lo vuelve a leer para hashearlo. Con el
+// hash de cada entrada, los archivos de contenido identico se cifran una sola
+// vez y el .enc de los demas se enlaza (enlace duro o reflink) al del primero.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+#include "EntradaSalida.h"
+
+// Identidad de una version concreta de un archivo
+struct ClaveArchivo {
+    uint64_t dispositivo = 0;
+    uint64_t inodo = 0;
+    uint64_t tam = 0;
+    int64_t mtime_ns = 0;
+
+    bool operator==(const ClaveArchivo& o) const {
+        return dispositivo == o.dispositivo && inodo == o.inodo && tam == o.tam && mtime_ns == o.mtime_ns;
+    }
+};
+
+struct HashClaveArchivo {
+    size_t operator()(const ClaveArchivo& c) const {
+        uint64_t h = c.dispositivo * 0x9E3779B97F4A7C15ULL;
+        h ^= c.inodo + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        h ^= c.tam + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        h ^= static_cast<uint64_t>(c.mtime_ns) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+// Clave del archivo tal como esta ahora. En Windows no hay inodo en stat, asi
+// que se usa un hash de la ruta (la cache sigue funcionando, pero dos enlaces
+// duros al mismo archivo cuentan como archivos distintos).
+inline bool claveDeArchivo(const std::string& ruta, ClaveArchivo& clave) {
+#if defined(_WIN32)
+    struct _stat64 st;
+    if (_stat64(ruta.c_str(), &st) != 0) {
+        return false;
+    }
+    clave.dispositivo = static_cast<uint64_t>(st.st_dev);
+    clave.inodo = std::hash<std::string>()(std::filesystem::absolute(ruta).string());
+    clave.tam = static_cast<uint64_t>(st.st_size);
+    clave.mtime_ns = static_cast<int64_t>(st.st_mtime) * 1000000000LL;
+#else
+    struct stat st;
+    if (::stat(ruta.c_str(), &st) != 0) {
+        return false;
+    }
+    clave.dispositivo = static_cast<uint64_t>(st.st_dev);
+    clave.inodo = static_cast<uint64_t>(st.st_ino);
+    clave.tam = static_cast<uint64_t>(st.st_size);
+#if defined(__APPLE__)
+    clave.mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    clave.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
+
+// Tabla clave -> SHA-256 en hexadecimal, compartida por los threads del lote.
+// En disco es un archivo de texto con una entrada por linea:
+//   dispositivo inodo tamaño mtime_ns hash
+class CacheHashes {
+public:
+    // Un archivo que no existe es una cache vacia; las lineas mal formadas se ignoran
+    bool cargar(const std::string& ruta, std::string& error) {
+        std::ifstream ifs(ruta);
+        if (!ifs.is_open()) {
+            std::error_code ec;
+            if (std::filesystem::exists(ruta, ec)) {
+                error = "no se pudo leer la cache de hashes: " + ruta;
+                return false;
+            }
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        std::string linea;
+        while (std::getline(ifs, linea)) {
+            if (linea.empty() || linea[0] == '#') {
+                continue;
+            }
+            std::istringstream campos(linea);
+            ClaveArchivo clave;
+            std::string hash;
+            if (campos >> clave.dispositivo >> clave.inodo >> clave.tam >> clave.mtime_ns >> hash && hash.size() == 64) {
+                entradas[clave] = hash;
+            }
+        }
+        return true;
+    }
+
+    // Se escribe en un temporal y se renombra, para no dejar una cache a medias
+    bool guardar(const std::string& ruta, std::string& error) const {
+        const std::string temporal = ruta + ".tmp";
+        {
+            std::ofstream ofs(temporal);
+            if (!ofs.is_open()) {
+                error = "no se pudo crear " + temporal;
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            ofs << "# cache de hashes: dispositivo inodo tam mtime_ns sha256\n";
+            for (const auto& e : entradas) {
+                ofs << e.first.dispositivo << ' ' << e.first.inodo << ' ' << e.first.tam << ' ' << e.first.mtime_ns << ' ' << e.second << '\n';
+            }
+            if (!ofs) {
+                error = "fallo la escritura de " + temporal;
+                return false;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(temporal, ruta, ec);
+        if (ec) {
+            error = "no se pudo reemplazar " + ruta + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    bool buscar(const ClaveArchivo& clave, std::string& hash) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto it = entradas.find(clave);
+            if (it != entradas.end()) {
+                hash = it->second;
+                aciertos_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        fallos_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void anotar(const ClaveArchivo& clave, const std::string& hash) {
+        std::lock_guard<std::mutex> lock(mtx);
+        entradas[clave] = hash;
+    }
+
+    size_t aciertos() const { return aciertos_.load(); }
+    size_t fallos() const { return fallos_.load(); }
+
+private:
+    mutable std::mutex mtx;
+    std::unordered_map<ClaveArchivo, std::string, HashClaveArchivo> entradas;
+    std::atomic<size_t> aciertos_{0};
+    std::atomic<size_t> fallos_{0};
+};
+
+// Como se materializa el .enc de un archivo duplicado
+enum class ModoDeduplicacion {
+    Ninguno,    // Cada archivo se cifra aunque haya otro identico
+    Enlace,     // Enlace duro al .enc del primero (reflink o copia si no se puede)
+    Reflink     // Reflink (copia en el kernel o por bloques si no se puede)
+};
+
+enum class MetodoEnlace {
+    EnlaceDuro,
+    Reflink,
+    CopiaNucleo,    // copy_file_range o sendfile
+    CopiaBuffer
+};
+
+inline const char* nombreMetodoEnlace(MetodoEnlace metodo) {
+    switch (metodo) {
+        case MetodoEnlace::EnlaceDuro: return "enlace duro";
+        case MetodoEnlace::Reflink: return "reflink";
+        case MetodoEnlace::CopiaNucleo: return "copia en el kernel";
+        default: return "copia";
+    }
+}
+
+// Hace que 'destino' tenga el contenido de 'origen' por el medio mas barato
+// que permitan el modo y el sistema de archivos. Devuelve false si ni la copia
+// por bloques funciona.
+inline bool enlazarDuplicado(const std::string& origen, const std::string& destino, ModoDeduplicacion modo, MetodoEnlace& metodo) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::remove(destino, ec);
+    if (modo == ModoDeduplicacion::Enlace) {
+        fs::create_hard_link(origen, destino, ec);
+        if (!ec) {
+            metodo = MetodoEnlace::EnlaceDuro;
+            return true;
+        }
+    }
+    MetodoCopia copia = MetodoCopia::Buffer;
+    if (copiarArchivoEnNucleo(origen, destino, copia)) {
+        metodo = copia == MetodoCopia::Reflink ? MetodoEnlace::Reflink : MetodoEnlace::CopiaNucleo;
+        return true;
+    }
+    ec.clear();
+    fs::copy_file(origen, destino, fs::copy_options::overwrite_existing, ec);
+    metodo = MetodoEnlace::CopiaBuffer;
+    return !ec;
+}
+
+#endif // CACHE_HASH_H
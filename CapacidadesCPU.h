@@ -0,0 +1,95 @@
+#ifndef CAPACIDADES_CPU_H
+#define CAPACIDADES_CPU_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// Permite compilar una funcion concreta con un conjunto de instrucciones
+// extendido sin exigirlo al resto del programa (se elige en tiempo de ejecucion)
+#if defined(__GNUC__) || defined(__clang__)
+#define SO_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SO_TARGET(isa)
+#endif
+
+// Extensiones del procesador relevantes para los kernels acelerados
+struct CapacidadesCPU {
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool avx2 = false;
+    bool avx512f = false;
+    bool avx512bw = false;
+    bool sha = false;
+    bool aesni = false;
+};
+
+inline void ejecutarCpuid(uint32_t hoja, uint32_t subhoja, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(hoja), static_cast<int>(subhoja));
+    for (int i = 0; i < 4; i++) {
+        regs[i] = static_cast<uint32_t>(r[i]);
+    }
+#else
+    __cpuid_count(hoja, subhoja, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Lee XCR0 para saber que registros extendidos guarda el sistema operativo
+inline uint64_t leerXCR0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#endif
+}
+
+inline CapacidadesCPU detectarCapacidadesCPU() {
+    CapacidadesCPU caps;
+    uint32_t r[4];
+
+    ejecutarCpuid(0, 0, r);
+    uint32_t max_hoja = r[0];
+    if (max_hoja < 1) {
+        return caps;
+    }
+
+    ejecutarCpuid(1, 0, r);
+    caps.sse2 = (r[3] >> 26) & 1;
+    caps.ssse3 = (r[2] >> 9) & 1;
+    caps.sse41 = (r[2] >> 19) & 1;
+    caps.aesni = (r[2] >> 25) & 1;
+    bool osxsave = (r[2] >> 27) & 1;
+    bool avx = (r[2] >> 28) & 1;
+
+    // AVX y AVX-512 solo son usables si el SO guarda los registros YMM/ZMM
+    uint64_t xcr0 = osxsave ? leerXCR0() : 0;
+    bool os_ymm = (xcr0 & 0x6) == 0x6;
+    bool os_zmm = (xcr0 & 0xe6) == 0xe6;
+
+    if (max_hoja >= 7) {
+        ejecutarCpuid(7, 0, r);
+        caps.avx2 = avx && os_ymm && ((r[1] >> 5) & 1);
+        caps.avx512f = os_zmm && ((r[1] >> 16) & 1);
+        caps.avx512bw = caps.avx512f && ((r[1] >> 30) & 1);
+        caps.sha = (r[1] >> 29) & 1;
+    }
+
+    return caps;
+}
+
+// Capacidades detectadas una unica vez por proceso
+inline const CapacidadesCPU& capacidadesCPU() {
+    static const CapacidadesCPU caps = detectarCapacidadesCPU();
+    return caps;
+}
+
+#endif // CAPACIDADES_CPU_H
@@ -0,0 +1,466 @@
+#ifndef CIFRADO_H
+#define CIFRADO_H
+
+// Cifrado del proyecto: desplazamiento Cesar de 3 posiciones para letras
+// mayusculas y minusculas, y espejo para digitos ('0' <-> '9'). El resto de
+// bytes no se modifica. Descifrar equivale a desplazar 26 - 3 = 23 posiciones.
+//
+// Para cualquier desplazamiento la transformacion es una tabla de 256 bytes
+// que se genera en tiempo de compilacion (CifradoCesar<Desplazamiento>), asi
+// que cifrar no depende de ramas ni de los datos de entrada.
+
+#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+#include "CapacidadesCPU.h"
+
+const int DESPLAZAMIENTO_CIFRADO = 3;
+const int DESPLAZAMIENTO_DESCIFRADO = 26 - DESPLAZAMIENTO_CIFRADO;
+
+// Definicion del cifrado caracter a caracter: desplaza las letras
+// 'desplazamiento' posiciones (0..25) y refleja los digitos. Es la referencia
+// con la que se generan y se verifican las tablas.
+constexpr char desplazarCaracter(char c, int desplazamiento) {
+    if (c >= 'A' && c <= 'Z') {
+        return static_cast<char>('A' + (c - 'A' + desplazamiento) % 26);
+    } else if (c >= 'a' && c <= 'z') {
+        return static_cast<char>('a' + (c - 'a' + desplazamiento) % 26);
+    } else if (c >= '0' && c <= '9') {
+        return static_cast<char>('9' - (c - '0')); // Simétrico
+    }
+    return c; // Otros caracteres sin cambios
+}
+
+// Solo cambian los bytes 0x30-0x7F (digitos y letras): con el nibble alto
+// entre 3 y 7. Para la busqueda con pshufb se guarda, para cada una de esas
+// filas, la diferencia entre el byte traducido y el original.
+const int PRIMERA_FILA_NIBBLE = 3;
+const int NUM_FILAS_NIBBLE = 5;
+
+struct TablaTraduccion {
+    uint8_t byte[256];                      // Traduccion completa
+    int desplazamiento;                     // Parametro de los kernels por rangos
+    uint8_t delta[NUM_FILAS_NIBBLE][16];    // byte[16h + l] - (16h + l)
+};
+
+constexpr TablaTraduccion generarTablaTraduccion(int desplazamiento) {
+    TablaTraduccion t{};
+    t.desplazamiento = desplazamiento;
+    for (int i = 0; i < 256; i++) {
+        t.byte[i] = static_cast<uint8_t>(desplazarCaracter(static_cast<char>(i), desplazamiento));
+    }
+    for (int f = 0; f < NUM_FILAS_NIBBLE; f++) {
+        for (int l = 0; l < 16; l++) {
+            int i = (PRIMERA_FILA_NIBBLE + f) * 16 + l;
+            t.delta[f][l] = static_cast<uint8_t>(t.byte[i] - i);
+        }
+    }
+    return t;
+}
+
+// Comprueba que la tabla no toca bytes fuera de las filas de nibbles
+constexpr bool tablaCabeEnFilasNibble(const TablaTraduccion& t) {
+    for (int i = 0; i < 256; i++) {
+        int fila = i >> 4;
+        bool en_filas = fila >= PRIMERA_FILA_NIBBLE && fila < PRIMERA_FILA_NIBBLE + NUM_FILAS_NIBBLE;
+        if (!en_filas && t.byte[i] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Kernel que traduce 'size' bytes de 'origen' a 'destino' segun una tabla.
+// Origen y destino pueden ser el mismo buffer (cifrado en el lugar) o zonas
+// sin solapamiento (por ejemplo, de un archivo mapeado a otro).
+typedef void (*KernelCifrado)(const char* origen, char* destino, size_t size, const TablaTraduccion& tabla);
+
+// Busqueda en tabla desenrollada: 8 bytes por iteracion
+inline void aplicarTablaEscalar(const char* origen, char* destino, size_t size, const TablaTraduccion& tabla) {
+    const uint8_t* t = tabla.byte;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(origen);
+    uint8_t* q = reinterpret_cast<uint8_t*>(destino);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint8_t b0 = t[p[i]], b1 = t[p[i + 1]], b2 = t[p[i + 2]], b3 = t[p[i + 3]];
+        uint8_t b4 = t[p[i + 4]], b5 = t[p[i + 5]], b6 = t[p[i + 6]], b7 = t[p[i + 7]];
+        q[i] = b0; q[i + 1] = b1; q[i + 2] = b2; q[i + 3] = b3;
+        q[i + 4] = b4; q[i + 5] = b5; q[i + 6] = b6; q[i + 7] = b7;
+    }
+    for (; i < size; ++i) {
+        q[i] = t[p[i]];
+    }
+}
+
+// --- Kernels SIMD ---
+// Para cada rango [lo, lo + n) se calcula t = x - lo como byte sin signo; el
+// byte pertenece al rango si min(t, n - 1) == t. Las letras se desplazan con
+// r = t + d (0..50) y se reducen modulo 26 con min(r, r - 26): si r < 26 la
+// resta da la vuelta y el minimo es r. Los digitos se reflejan con '9' - t.
+
+SO_TARGET("sse2")
+static inline __m128i desplazarRangoSSE2(__m128i x, __m128i resultado, char lo, __m128i d) {
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8(lo));
+    __m128i en_rango = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(25)), t);
+    __m128i r = _mm_add_epi8(t, d);
+    r = _mm_min_epu8(r, _mm_sub_epi8(r, _mm_set1_epi8(26)));
+    r = _mm_add_epi8(r, _mm_set1_epi8(lo));
+    return _mm_or_si128(_mm_and_si128(en_rango, r), _mm_andnot_si128(en_rango, resultado));
+}
+
+SO_TARGET("sse2")
+static inline __m128i desplazarVectorSSE2(__m128i x, __m128i d) {
+    __m128i resultado = desplazarRangoSSE2(x, x, 'A', d);
+    resultado = desplazarRangoSSE2(x, resultado, 'a', d);
+
+    __m128i t = _mm_sub_epi8(x, _mm_set1_epi8('0'));
+    __m128i es_digito = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(9)), t);
+    __m128i espejo = _mm_sub_epi8(_mm_set1_epi8('9'), t);
+    return _mm_or_si128(_mm_and_si128(es_digito, espejo), _mm_andnot_si128(es_digito, resultado));
+}
+
+SO_TARGET("sse2")
+inline void desplazarChunkSSE2(const char* origen, char* destino, size_t size, const TablaTraduccion& tabla) {
+    const __m128i d = _mm_set1_epi8(static_cast<char>(tabla.desplazamiento));
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(origen + i));
+        _mm_storeu_si128((__m128i*)(destino + i), desplazarVectorSSE2(x, d));
+    }
+    aplicarTablaEscalar(origen + i, destino + i, size - i, tabla);
+}
+
+SO_TARGET("avx2")
+static inline __m256i desplazarRangoAVX2(__m256i x, __m256i resultado, char lo, __m256i d) {
+    __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8(lo));
+    __m256i en_rango = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(25)), t);
+    __m256i r = _mm256_add_epi8(t, d);
+    r = _mm256_min_epu8(r, _mm256_sub_epi8(r, _mm256_set1_epi8(26)));
+    r = _mm256_add_epi8(r, _mm256_set1_epi8(lo));
+    return _mm256_blendv_epi8(resultado, r, en_rango);
+}
+
+SO_TARGET("avx2")
+static inline __m256i desplazarVectorAVX2(__m256i x, __m256i d) {
+    __m256i resultado = desplazarRangoAVX2(x, x, 'A', d);
+    resultado = desplazarRangoAVX2(x, resultado, 'a', d);
+
+    __m256i t = _mm256_sub_epi8(x, _mm256_set1_epi8('0'));
+    __m256i es_digito = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(9)), t);
+    return _mm256_blendv_epi8(resultado, _mm256_sub_epi8(_mm256_set1_epi8('9'), t), es_digito);
+}
+
+SO_TARGET("avx2")
+inline void desplazarChunkAVX2(const char* origen, char* destino, size_t size, const TablaTraduccion& tabla) {
+    const __m256i d = _mm256_set1_epi8(static_cast<char>(tabla.desplazamiento));
+    size_t i = 0;
+    // Dos vectores por iteracion para ocultar la latencia de los blends
+    for (; i + 64 <= size; i += 64) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)(origen + i));
+        __m256i x1 = _mm256_loadu_si256((const __m256i*)(origen + i + 32));
+        _mm256_storeu_si256((__m256i*)(destino + i), desplazarVectorAVX2(x0, d));
+        _mm256_storeu_si256((__m256i*)(destino + i + 32), desplazarVectorAVX2(x1, d));
+    }
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(origen + i));
+        _mm256_storeu_si256((__m256i*)(destino + i), desplazarVectorAVX2(x, d));
+    }
+    aplicarTablaEscalar(origen + i, destino + i, size - i, tabla);
+}
+
+SO_TARGET("avx512f,avx512bw")
+static inline __m512i desplazarVectorAVX512(__m512i x, __m512i d) {
+    const __m512i veinticinco = _mm512_set1_epi8(25);
+    const __m512i veintiseis = _mm512_set1_epi8(26);
+
+    __m512i t = _mm512_sub_epi8(x, _mm512_set1_epi8('A'));
+    __m512i r = _mm512_add_epi8(t, d);
+    r = _mm512_add_epi8(_mm512_min_epu8(r, _mm512_sub_epi8(r, veintiseis)), _mm512_set1_epi8('A'));
+    __m512i resultado = _mm512_mask_mov_epi8(x, _mm512_cmple_epu8_mask(t, veinticinco), r);
+
+    t = _mm512_sub_epi8(x, _mm512_set1_epi8('a'));
+    r = _mm512_add_epi8(t, d);
+    r = _mm512_add_epi8(_mm512_min_epu8(r, _mm512_sub_epi8(r, veintiseis)), _mm512_set1_epi8('a'));
+    resultado = _mm512_mask_mov_epi8(resultado, _mm512_cmple_epu8_mask(t, veinticinco), r);
+
+    t = _mm512_sub_epi8(x, _mm512_set1_epi8('0'));
+    return _mm512_mask_mov_epi8(resultado, _mm512_cmple_epu8_mask(t, _mm512_set1_epi8(9)),
+                                _mm512_sub_epi8(_mm512_set1_epi8('9'), t));
+}
+
+SO_TARGET("avx512f,avx512bw")
+inline void desplazarChunkAVX512(const char* origen, char* destino, size_t size, const TablaTraduccion& tabla) {
+    const __m512i d = _mm512_set1_epi8(static_cast<char>(tabla.desplazamiento));
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m512i x = _mm512_loadu_si512((const void*)(origen + i));
+        _mm512_storeu_si512((void*)(destino + i), desplazarVectorAVX512(x, d));
+    }
+    // Resto con carga y escritura enmascaradas, sin bucle escalar
+    if (i < size) {
+        __mmask64 mascara = (1ULL << (size - i)) - 1;
+        __m512i x = _mm512_maskz_loadu_epi8(mascara, origen + i);
+        _mm512_mask_storeu_epi8(destino + i, mascara, desplazarVectorAVX512(x, d));
+    }
+}
+
+// --- Kernels por busqueda de nibbles (pshufb) ---
+// El nibble bajo de cada byte indexa, con pshufb, la fila de diferencias del
+// nibble alto correspondiente; cada fila solo se aplica a los bytes cuyo
+// nibble alto coincide. Funciona con cualquier tabla que cumpla
+// tablaCabeEnFilasNibble, sin comparaciones de rango.
+
+SO_TARGET("ssse3")
+inline void aplicarNibblesSSSE3(const char* origen, char* destino, size_t size, const TablaTraduccion& tabla) {
+    __m128i filas[NUM_FILAS_NIBBLE];
+    for (int f = 0; f < NUM_FILAS_NIBBLE; f++) {
+        filas[f] = _mm_loadu_si128((const __m128i*)tabla.delta[f]);
+    }
+    const __m128i mascara_nibble = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(origen + i));
+        __m128i bajo = _mm_and_si128(x, mascara_nibble);
+        __m128i alto = _mm_and_si128(_mm_srli_epi16(x, 4), mascara_nibble);
+        __m128i delta = _mm_setzero_si128();
+        for (int f = 0; f < NUM_FILAS_NIBBLE; f++) {
+            __m128i en_fila = _mm_cmpeq_epi8(alto, _mm_set1_epi8(static_cast<char>(PRIMERA_FILA_NIBBLE + f)));
+            delta = _mm_or_si128(delta, _mm_and_si128(en_fila, _mm_shuffle_epi8(filas[f], bajo)));
+        }
+        _mm_storeu_si128((__m128i*)(destino + i), _mm_add_epi8(x, delta));
+    }
+    aplicarTablaEscalar(origen + i, destino + i, size - i, tabla);
+}
+
+SO_TARGET("avx2")
+inline void aplicarNibblesAVX2(const char* origen, char* destino, size_t size, const TablaTraduccion& tabla) {
+    __m256i filas[NUM_FILAS_NIBBLE];
+    for (int f = 0; f < NUM_FILAS_NIBBLE; f++) {
+        filas[f] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tabla.delta[f]));
+    }
+    const __m256i mascara_nibble = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(origen + i));
+        __m256i bajo = _mm256_and_si256(x, mascara_nibble);
+        __m256i alto = _mm256_and_si256(_mm256_srli_epi16(x, 4), mascara_nibble);
+        __m256i delta = _mm256_setzero_si256();
+        for (int f = 0; f < NUM_FILAS_NIBBLE; f++) {
+            __m256i en_fila = _mm256_cmpeq_epi8(alto, _mm256_set1_epi8(static_cast<char>(PRIMERA_FILA_NIBBLE + f)));
+            delta = _mm256_or_si256(delta, _mm256_and_si256(en_fila, _mm256_shuffle_epi8(filas[f], bajo)));
+        }
+        _mm256_storeu_si256((__m256i*)(destino + i), _mm256_add_epi8(x, delta));
+    }
+    aplicarTablaEscalar(origen + i, destino + i, size - i, tabla);
+}
+
+// --- Seleccion en tiempo de ejecucion ---
+
+enum class BackendCifrado {
+    Escalar,        // Tabla de 256 bytes desenrollada
+    SSE2,           // Comparacion de rangos
+    SSSE3,          // Busqueda de nibbles con pshufb
+    AVX2,           // Comparacion de rangos
+    AVX2Nibbles,    // Busqueda de nibbles con vpshufb
+    AVX512          // Comparacion de rangos con mascaras
+};
+
+inline bool backendCifradoDisponible(BackendCifrado backend) {
+    const CapacidadesCPU& caps = capacidadesCPU();
+    switch (backend) {
+        case BackendCifrado::Escalar:     return true;
+        case BackendCifrado::SSE2:        return caps.sse2;
+        case BackendCifrado::SSSE3:       return caps.ssse3;
+        case BackendCifrado::AVX2:        return caps.avx2;
+        case BackendCifrado::AVX2Nibbles: return caps.avx2;
+        case BackendCifrado::AVX512:      return caps.avx512bw;
+    }
+    return false;
+}
+
+inline const char* nombreBackendCifrado(BackendCifrado backend) {
+    switch (backend) {
+        case BackendCifrado::Escalar:     return "tabla escalar";
+        case BackendCifrado::SSE2:        return "SSE2";
+        case BackendCifrado::SSSE3:       return "SSSE3 pshufb";
+        case BackendCifrado::AVX2:        return "AVX2";
+        case BackendCifrado::AVX2Nibbles: return "AVX2 pshufb";
+        case BackendCifrado::AVX512:      return "AVX-512BW";
+    }
+    return "desconocido";
+}
+
+inline KernelCifrado kernelCifrado(BackendCifrado backend) {
+    if (!backendCifradoDisponible(backend)) {
+        return aplicarTablaEscalar;
+    }
+    switch (backend) {
+        case BackendCifrado::Escalar:     return aplicarTablaEscalar;
+        case BackendCifrado::SSE2:        return desplazarChunkSSE2;
+        case BackendCifrado::SSSE3:       return aplicarNibblesSSSE3;
+        case BackendCifrado::AVX2:        return desplazarChunkAVX2;
+        case BackendCifrado::AVX2Nibbles: return aplicarNibblesAVX2;
+        case BackendCifrado::AVX512:      return desplazarChunkAVX512;
+    }
+    return aplicarTablaEscalar;
+}
+
+// Backend elegido una sola vez segun cpuid. Las variantes pshufb quedan como
+// alternativa: en las CPUs medidas la comparacion de rangos es mas rapida
+inline BackendCifrado backendCifradoActivo() {
+    static const BackendCifrado elegido = []() {
+        if (backendCifradoDisponible(BackendCifrado::AVX512)) return BackendCifrado::AVX512;
+        if (backendCifradoDisponible(BackendCifrado::AVX2)) return BackendCifrado::AVX2;
+        if (backendCifradoDisponible(BackendCifrado::SSE2)) return BackendCifrado::SSE2;
+        return BackendCifrado::Escalar;
+    }();
+    return elegido;
+}
+
+inline KernelCifrado kernelCifradoActivo() {
+    static const KernelCifrado kernel = kernelCifrado(backendCifradoActivo());
+    return kernel;
+}
+
+// Motor de cifrado para un desplazamiento fijo: las tablas de cifrado y
+// descifrado se generan en compilacion y los kernels solo las recorren
+template <int Desplazamiento>
+struct CifradoCesar {
+    static_assert(Desplazamiento >= 0 && Desplazamiento < 26, "El desplazamiento debe estar entre 0 y 25");
+
+    static constexpr TablaTraduccion cifrado = generarTablaTraduccion(Desplazamiento);
+    static constexpr TablaTraduccion descifrado = generarTablaTraduccion((26 - Desplazamiento) % 26);
+
+    static_assert(tablaCabeEnFilasNibble(cifrado) && tablaCabeEnFilasNibble(descifrado),
+                  "La tabla modifica bytes fuera de las filas de nibbles");
+
+    static char cifrarCaracter(char c) { return static_cast<char>(cifrado.byte[static_cast<uint8_t>(c)]); }
+    static char descifrarCaracter(char c) { return static_cast<char>(descifrado.byte[static_cast<uint8_t>(c)]); }
+
+    static void cifrar(char* buffer, size_t size) { kernelCifradoActivo()(buffer, buffer, size, cifrado); }
+    static void descifrar(char* buffer, size_t size) { kernelCifradoActivo()(buffer, buffer, size, descifrado); }
+
+    // Variantes fuera del lugar, p. ej. de un archivo mapeado a otro
+    static void cifrar(const char* origen, char* destino, size_t size) { kernelCifradoActivo()(origen, destino, size, cifrado); }
+    static void descifrar(const char* origen, char* destino, size_t size) { kernelCifradoActivo()(origen, destino, size, descifrado); }
+};
+
+typedef CifradoCesar<DESPLAZAMIENTO_CIFRADO> CifradoProyecto;
+
+// Cifrado de un caracter por busqueda en la tabla
+inline char cifrarCaracter(char c) {
+    return CifradoProyecto::cifrarCaracter(c);
+}
+
+inline char descifrarCaracter(char c) {
+    return CifradoProyecto::descifrarCaracter(c);
+}
+
+// Función para detectar capacidades SIMD del procesador
+inline bool tieneCapacidadesSIMD() {
+    return backendCifradoActivo() != BackendCifrado::Escalar;
+}
+
+// Cifrado SIMD con el mejor backend disponible
+inline void cifrarChunkSIMD(char* buffer, size_t size) {
+    CifradoProyecto::cifrar(buffer, size);
+}
+
+inline void descifrarChunkSIMD(char* buffer, size_t size) {
+    CifradoProyecto::descifrar(buffer, size);
+}
+
+// Cifrado de un bloque; sin SIMD se usa la tabla desenrollada
+inline void cifrarChunkOptimizado(char* buffer, size_t size) {
+    CifradoProyecto::cifrar(buffer, size);
+}
+
+inline void descifrarChunkOptimizado(char* buffer, size_t size) {
+    CifradoProyecto::descifrar(buffer, size);
+}
+
+// Compara un kernel con desplazarCaracter para una tabla dada, en cada
+// alineacion y longitud pedida, en el lugar y fuera del lugar, y comprueba
+// que no escribe fuera del rango
+inline bool verificarKernelConTabla(KernelCifrado kernel, const TablaTraduccion& tabla,
+                                    size_t max_len, size_t paso_largo, std::string& detalle) {
+    const size_t MARGEN = 64;
+    std::string original(max_len + 2 * MARGEN, '\0');
+    std::string esperado(original.size(), '\0');
+    for (size_t i = 0; i < original.size(); i++) {
+        original[i] = static_cast<char>((i * 7 + i / 256) & 0xff);   // Recorre los 256 valores
+        esperado[i] = desplazarCaracter(original[i], tabla.desplazamiento);
+    }
+
+    std::string buffer;
+    for (size_t offset = 0; offset < MARGEN; offset++) {
+        for (size_t len = 0; len <= max_len; len += (len < 300 ? 1 : paso_largo)) {
+            // En el lugar con la alineacion 'offset'; fuera del lugar desde el
+            // original desplazado un byte para que origen y destino no coincidan
+            for (int fuera_de_lugar = 0; fuera_de_lugar < 2; fuera_de_lugar++) {
+                buffer = original;
+                size_t desfase = fuera_de_lugar ? 1 : 0;
+                if (fuera_de_lugar) {
+                    kernel(&original[offset + desfase], &buffer[offset], len, tabla);
+                } else {
+                    kernel(&buffer[offset], &buffer[offset], len, tabla);
+                }
+                for (size_t i = 0; i < buffer.size(); i++) {
+                    bool dentro = (i >= offset && i < offset + len);
+                    char correcto = dentro ? esperado[i + desfase] : original[i];
+                    if (buffer[i] != correcto) {
+                        detalle = "byte " + std::to_string(static_cast<unsigned char>(original[i + desfase])) +
+                                  " incorrecto con desplazamiento " + std::to_string(tabla.desplazamiento) +
+                                  ", offset " + std::to_string(offset) + ", longitud " + std::to_string(len) +
+                                  (fuera_de_lugar ? " (fuera del lugar)" : " (en el lugar)");
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Prueba exhaustiva de todos los backends disponibles: los 256 valores de
+// byte en todas las alineaciones y longitudes hasta varios vectores para la
+// clave del proyecto, y un barrido mas corto para el resto de claves
+inline bool verificarKernelsCifrado(std::string& detalle) {
+    const BackendCifrado backends[] = {
+        BackendCifrado::Escalar, BackendCifrado::SSE2, BackendCifrado::SSSE3,
+        BackendCifrado::AVX2, BackendCifrado::AVX2Nibbles, BackendCifrado::AVX512
+    };
+
+    // Las tablas generadas deben coincidir con la definicion del cifrado
+    for (int c = 0; c < 256; c++) {
+        char ch = static_cast<char>(c);
+        if (cifrarCaracter(ch) != desplazarCaracter(ch, DESPLAZAMIENTO_CIFRADO) ||
+            descifrarCaracter(cifrarCaracter(ch)) != ch) {
+            detalle = "tabla de cifrado incorrecta para el byte " + std::to_string(c);
+            return false;
+        }
+    }
+
+    for (BackendCifrado backend : backends) {
+        if (!backendCifradoDisponible(backend)) {
+            continue;
+        }
+        KernelCifrado kernel = kernelCifrado(backend);
+        for (int clave = 0; clave < 26; clave++) {
+            TablaTraduccion tabla = generarTablaTraduccion(clave);
+            bool completa = (clave == DESPLAZAMIENTO_CIFRADO || clave == DESPLAZAMIENTO_DESCIFRADO);
+            size_t max_len = completa ? 3 * 256 + 67 : 100;
+            if (!verificarKernelConTabla(kernel, tabla, max_len, 37, detalle)) {
+                detalle = std::string("backend ") + nombreBackendCifrado(backend) + ": " + detalle;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#endif // CIFRADO_H
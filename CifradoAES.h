@@ -0,0 +1,327 @@
+#ifndef CIFRADO_AES_H
+#define CIFRADO_AES_H
+
+// AES-128 y AES-256 en modo CTR con las instrucciones AES-NI. El flujo de
+// clave del bloque k es AES(IV + k), con el IV como entero de 128 bits big
+// endian (como en NIST SP 800-38A), asi que cualquier posicion del archivo se
+// cifra sin conocer las anteriores: los rangos, los bloques de io_uring y los
+// segmentos reanudados se procesan de forma independiente. Cifrar y descifrar
+// son la misma operacion.
+//
+// Se cifran 8 contadores a la vez: aesenc tiene latencia de varios ciclos pero
+// se puede emitir uno por ciclo, y con 8 bloques independientes en vuelo la
+// unidad AES no se queda esperando.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <immintrin.h>
+
+#include "CapacidadesCPU.h"
+
+const size_t TAM_BLOQUE_AES = 16;
+const int MAX_RONDAS_AES = 14;
+
+struct ClaveExpandidaAES {
+    __m128i ronda[MAX_RONDAS_AES + 1];
+    int rondas = 0;     // 10 (AES-128) o 14 (AES-256)
+};
+
+inline bool aesNIDisponible() {
+    return capacidadesCPU().aesni && capacidadesCPU().ssse3;
+}
+
+// --- Expansion de la clave ---
+// aeskeygenassist necesita la constante de ronda como inmediato, de ahi las plantillas
+
+SO_TARGET("aes,sse2")
+static inline __m128i mezclarPalabrasClaveAES(__m128i clave, __m128i generado) {
+    clave = _mm_xor_si128(clave, _mm_slli_si128(clave, 4));
+    clave = _mm_xor_si128(clave, _mm_slli_si128(clave, 4));
+    clave = _mm_xor_si128(clave, _mm_slli_si128(clave, 4));
+    return _mm_xor_si128(clave, generado);
+}
+
+template <int Rcon>
+SO_TARGET("aes,sse2")
+static inline __m128i pasoClaveAES(__m128i clave) {
+    return mezclarPalabrasClaveAES(clave, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(clave, Rcon), 0xff));
+}
+
+// Un paso de AES-256: la primera mitad usa RotWord, SubWord y Rcon sobre la
+// segunda mitad anterior; la segunda, solo SubWord sobre la primera nueva
+template <int Rcon>
+SO_TARGET("aes,sse2")
+static inline void pasoClaveAES256(__m128i& a, __m128i& b) {
+    a = mezclarPalabrasClaveAES(a, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(b, Rcon), 0xff));
+    b = mezclarPalabrasClaveAES(b, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(a, 0), 0xaa));
+}
+
+SO_TARGET("aes,sse2")
+inline void expandirClaveAES128(const uint8_t clave[16], ClaveExpandidaAES& e) {
+    __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(clave));
+    e.rondas = 10;
+    e.ronda[0] = k;
+    k = pasoClaveAES<0x01>(k); e.ronda[1] = k;
+    k = pasoClaveAES<0x02>(k); e.ronda[2] = k;
+    k = pasoClaveAES<0x04>(k); e.ronda[3] = k;
+    k = pasoClaveAES<0x08>(k); e.ronda[4] = k;
+    k = pasoClaveAES<0x10>(k); e.ronda[5] = k;
+    k = pasoClaveAES<0x20>(k); e.ronda[6] = k;
+    k = pasoClaveAES<0x40>(k); e.ronda[7] = k;
+    k = pasoClaveAES<0x80>(k); e.ronda[8] = k;
+    k = pasoClaveAES<0x1b>(k); e.ronda[9] = k;
+    k = pasoClaveAES<0x36>(k); e.ronda[10] = k;
+}
+
+SO_TARGET("aes,sse2")
+inline void expandirClaveAES256(const uint8_t clave[32], ClaveExpandidaAES& e) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(clave));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(clave + 16));
+    e.rondas = 14;
+    e.ronda[0] = a;
+    e.ronda[1] = b;
+    pasoClaveAES256<0x01>(a, b); e.ronda[2] = a; e.ronda[3] = b;
+    pasoClaveAES256<0x02>(a, b); e.ronda[4] = a; e.ronda[5] = b;
+    pasoClaveAES256<0x04>(a, b); e.ronda[6] = a; e.ronda[7] = b;
+    pasoClaveAES256<0x08>(a, b); e.ronda[8] = a; e.ronda[9] = b;
+    pasoClaveAES256<0x10>(a, b); e.ronda[10] = a; e.ronda[11] = b;
+    pasoClaveAES256<0x20>(a, b); e.ronda[12] = a; e.ronda[13] = b;
+    // La ultima ronda solo necesita la primera mitad
+    a = mezclarPalabrasClaveAES(a, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(b, 0x40), 0xff));
+    e.ronda[14] = a;
+}
+
+// --- Modo CTR ---
+
+// Contador IV + k como bloque de 16 bytes big endian
+SO_TARGET("ssse3")
+static inline __m128i contadorAES(uint64_t iv_alto, uint64_t iv_bajo, uint64_t k) {
+    const __m128i invertir = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    uint64_t bajo = iv_bajo + k;
+    uint64_t alto = iv_alto + (bajo < iv_bajo ? 1 : 0);
+    return _mm_shuffle_epi8(_mm_set_epi64x(static_cast<long long>(alto), static_cast<long long>(bajo)), invertir);
+}
+
+SO_TARGET("aes,sse2")
+static inline __m128i cifrarBloqueAES(const ClaveExpandidaAES& e, __m128i x) {
+    x = _mm_xor_si128(x, e.ronda[0]);
+    for (int r = 1; r < e.rondas; r++) {
+        x = _mm_aesenc_si128(x, e.ronda[r]);
+    }
+    return _mm_aesenclast_si128(x, e.ronda[e.rondas]);
+}
+
+// Aplica el flujo de clave a 'size' bytes que empiezan en el byte 'posicion'
+// del archivo. Origen y destino pueden ser el mismo buffer. Con el numero de
+// rondas como constante los bucles se desenrollan y las subclaves y los 8
+// bloques en vuelo se quedan en registros.
+template <int Rondas>
+SO_TARGET("aes,ssse3")
+inline void transformarAESCTRRondas(const ClaveExpandidaAES& e, uint64_t iv_alto, uint64_t iv_bajo,
+                                    const char* origen, char* destino, size_t size, uint64_t posicion) {
+    __m128i k[Rondas + 1];
+    for (int r = 0; r <= Rondas; r++) {
+        k[r] = e.ronda[r];
+    }
+    uint64_t bloque = posicion / TAM_BLOQUE_AES;
+    size_t salto = static_cast<size_t>(posicion % TAM_BLOQUE_AES);
+    size_t i = 0;
+
+    // Bloque inicial a medias (la posicion no es multiplo de 16)
+    if (salto != 0 && size > 0) {
+        alignas(16) uint8_t flujo[TAM_BLOQUE_AES];
+        _mm_store_si128(reinterpret_cast<__m128i*>(flujo), cifrarBloqueAES(e, contadorAES(iv_alto, iv_bajo, bloque)));
+        size_t n = TAM_BLOQUE_AES - salto < size ? TAM_BLOQUE_AES - salto : size;
+        for (; i < n; i++) {
+            destino[i] = static_cast<char>(origen[i] ^ flujo[salto + i]);
+        }
+        bloque++;
+    }
+
+    for (; i + 8 * TAM_BLOQUE_AES <= size; i += 8 * TAM_BLOQUE_AES, bloque += 8) {
+        __m128i x0 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque), k[0]);
+        __m128i x1 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque + 1), k[0]);
+        __m128i x2 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque + 2), k[0]);
+        __m128i x3 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque + 3), k[0]);
+        __m128i x4 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque + 4), k[0]);
+        __m128i x5 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque + 5), k[0]);
+        __m128i x6 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque + 6), k[0]);
+        __m128i x7 = _mm_xor_si128(contadorAES(iv_alto, iv_bajo, bloque + 7), k[0]);
+        for (int r = 1; r < Rondas; r++) {
+            x0 = _mm_aesenc_si128(x0, k[r]);
+            x1 = _mm_aesenc_si128(x1, k[r]);
+            x2 = _mm_aesenc_si128(x2, k[r]);
+            x3 = _mm_aesenc_si128(x3, k[r]);
+            x4 = _mm_aesenc_si128(x4, k[r]);
+            x5 = _mm_aesenc_si128(x5, k[r]);
+            x6 = _mm_aesenc_si128(x6, k[r]);
+            x7 = _mm_aesenc_si128(x7, k[r]);
+        }
+        const __m128i* p = reinterpret_cast<const __m128i*>(origen + i);
+        __m128i* q = reinterpret_cast<__m128i*>(destino + i);
+        _mm_storeu_si128(q + 0, _mm_xor_si128(_mm_loadu_si128(p + 0), _mm_aesenclast_si128(x0, k[Rondas])));
+        _mm_storeu_si128(q + 1, _mm_xor_si128(_mm_loadu_si128(p + 1), _mm_aesenclast_si128(x1, k[Rondas])));
+        _mm_storeu_si128(q + 2, _mm_xor_si128(_mm_loadu_si128(p + 2), _mm_aesenclast_si128(x2, k[Rondas])));
+        _mm_storeu_si128(q + 3, _mm_xor_si128(_mm_loadu_si128(p + 3), _mm_aesenclast_si128(x3, k[Rondas])));
+        _mm_storeu_si128(q + 4, _mm_xor_si128(_mm_loadu_si128(p + 4), _mm_aesenclast_si128(x4, k[Rondas])));
+        _mm_storeu_si128(q + 5, _mm_xor_si128(_mm_loadu_si128(p + 5), _mm_aesenclast_si128(x5, k[Rondas])));
+        _mm_storeu_si128(q + 6, _mm_xor_si128(_mm_loadu_si128(p + 6), _mm_aesenclast_si128(x6, k[Rondas])));
+        _mm_storeu_si128(q + 7, _mm_xor_si128(_mm_loadu_si128(p + 7), _mm_aesenclast_si128(x7, k[Rondas])));
+    }
+    for (; i + TAM_BLOQUE_AES <= size; i += TAM_BLOQUE_AES, bloque++) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(origen + i));
+        __m128i flujo = cifrarBloqueAES(e, contadorAES(iv_alto, iv_bajo, bloque));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destino + i), _mm_xor_si128(p, flujo));
+    }
+    if (i < size) {
+        alignas(16) uint8_t flujo[TAM_BLOQUE_AES];
+        _mm_store_si128(reinterpret_cast<__m128i*>(flujo), cifrarBloqueAES(e, contadorAES(iv_alto, iv_bajo, bloque)));
+        for (size_t j = 0; i < size; i++, j++) {
+            destino[i] = static_cast<char>(origen[i] ^ flujo[j]);
+        }
+    }
+}
+
+inline void transformarAESCTR(const ClaveExpandidaAES& e, uint64_t iv_alto, uint64_t iv_bajo,
+                              const char* origen, char* destino, size_t size, uint64_t posicion) {
+    if (e.rondas == 14) {
+        transformarAESCTRRondas<14>(e, iv_alto, iv_bajo, origen, destino, size, posicion);
+    } else {
+        transformarAESCTRRondas<10>(e, iv_alto, iv_bajo, origen, destino, size, posicion);
+    }
+}
+
+// Lee 8 bytes big endian (mitades del IV)
+inline uint64_t leerBE64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+// "2b7e15..." -> bytes. Devuelve false si la longitud o algun digito no es valido.
+inline bool parsearHexadecimal(const std::string& texto, std::string& bytes) {
+    if (texto.size() % 2 != 0) {
+        return false;
+    }
+    auto valor = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    bytes.clear();
+    for (size_t i = 0; i < texto.size(); i += 2) {
+        int alto = valor(texto[i]);
+        int bajo = valor(texto[i + 1]);
+        if (alto < 0 || bajo < 0) {
+            return false;
+        }
+        bytes += static_cast<char>(alto * 16 + bajo);
+    }
+    return true;
+}
+
+// Vectores F.5.1 y F.5.5 de NIST SP 800-38A, y equivalencia entre cifrar de
+// una vez y cifrar a trozos desde posiciones arbitrarias (con el contador
+// cruzando el limite de 64 bits)
+inline bool verificarAESCTR(std::string& detalle) {
+    if (!aesNIDisponible()) {
+        return true;
+    }
+    std::string iv, texto, clave128, clave256, esperado128, esperado256, iv_acarreo, acarreo128, acarreo256;
+    parsearHexadecimal("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", iv);
+    parsearHexadecimal("6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+                       "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710", texto);
+    parsearHexadecimal("2b7e151628aed2a6abf7158809cf4f3c", clave128);
+    parsearHexadecimal("603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", clave256);
+    parsearHexadecimal("874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff"
+                       "5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee", esperado128);
+    parsearHexadecimal("601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cacaf5c5"
+                       "2b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd08457941a6", esperado256);
+    // Flujo de 192 bytes (12 bloques) con la mitad baja del contador en
+    // ...fffc: del bloque 3 al 4 hay acarreo a la mitad alta. Calculado con
+    // openssl enc -aes-{128,256}-ctr sobre ceros, que suma en los 128 bits
+    parsearHexadecimal("0001020304050607fffffffffffffffc", iv_acarreo);
+    parsearHexadecimal("4bfcc500bdf5d19be2e2e57adf55c347df6fa6f12aeda9965f57c8087f725506eb18472ff22c12c638c5b2e7282d0d20"
+                       "3d88a68db0f3e3c66e7fd8c1b1cb797a2a8891d239949bea3ea4f6c17f7ea9570ad276b9a4cf0b15e9b3a8f57bfabc49"
+                       "d0529436f20db338316ed93dcef1ca20c92b925929d0641c7d1521396759f348c81aa6bfaf3a3f69d6f25194ea1f6385"
+                       "6234a22d72d019ac7c48593f78af569db35be0d1650a1ad673291ab652692446ff4373f13421b2683b406e814e85e446", acarreo128);
+    parsearHexadecimal("f7d9e6e461a8d094131a95b1265d24523711b4d059ce12ff3a0e40e8e9710ebb8a2ac2ffbba5b148dc6f6cba14f281a7"
+                       "b1013833f607a3258d3d3be88f80c38104228c9aba53e373a21c97ba6fe1887d5b2563b79bc120adf268b0b7efd06b2b"
+                       "70f89a5055872b6a8a3d06564d3373e99e481914c9fdf59488fa1e6c898203413aa0cbe8f485027d7c66a5246badb8f8"
+                       "41a5820f98c9f31b78452388c8ca2ab0a5917ee8626a7a692f414b761a42f3c101134ce8a07c1d139b42da404f2bcb34", acarreo256);
+    const uint8_t* v = reinterpret_cast<const uint8_t*>(iv.data());
+    const uint64_t iv_alto = leerBE64(v);
+    const uint64_t iv_bajo = leerBE64(v + 8);
+
+    for (int variante = 0; variante < 2; variante++) {
+        ClaveExpandidaAES e;
+        if (variante == 0) {
+            expandirClaveAES128(reinterpret_cast<const uint8_t*>(clave128.data()), e);
+        } else {
+            expandirClaveAES256(reinterpret_cast<const uint8_t*>(clave256.data()), e);
+        }
+        const std::string& esperado = variante == 0 ? esperado128 : esperado256;
+        const char* nombre = variante == 0 ? "AES-128-CTR" : "AES-256-CTR";
+        std::string salida(texto.size(), '\0');
+        transformarAESCTR(e, iv_alto, iv_bajo, texto.data(), &salida[0], texto.size(), 0);
+        if (salida != esperado) {
+            detalle = std::string(nombre) + ": no coincide con el vector de SP 800-38A";
+            return false;
+        }
+
+        // Acarreo entre las dos mitades del contador: entero (cae dentro de un
+        // grupo de 8 bloques) y a trozos que empiezan o acaban junto a el
+        const uint8_t* va = reinterpret_cast<const uint8_t*>(iv_acarreo.data());
+        const std::string& acarreo = variante == 0 ? acarreo128 : acarreo256;
+        const size_t cortes_acarreo[] = {0, 5, 50, 64, 71, 128, 150, 192};
+        const size_t num_cortes_acarreo = sizeof(cortes_acarreo) / sizeof(cortes_acarreo[0]);
+        for (size_t a = 0; a + 1 < num_cortes_acarreo; a++) {
+            std::string flujo(acarreo.size(), '\0');
+            transformarAESCTR(e, leerBE64(va), leerBE64(va + 8), &flujo[0], &flujo[0], cortes_acarreo[a], 0);
+            for (size_t b = a; b + 1 < num_cortes_acarreo; b++) {
+                size_t desde = cortes_acarreo[b];
+                transformarAESCTR(e, leerBE64(va), leerBE64(va + 8), &flujo[desde], &flujo[desde], cortes_acarreo[b + 1] - desde, desde);
+            }
+            if (flujo != acarreo) {
+                detalle = std::string(nombre) + ": el acarreo del contador no coincide con openssl (cortes desde " +
+                          std::to_string(cortes_acarreo[a]) + ")";
+                return false;
+            }
+        }
+
+        // Mas de 8 bloques y cortes en posiciones sin alinear
+        std::string largo(1000, '\0');
+        for (size_t i = 0; i < largo.size(); i++) {
+            largo[i] = static_cast<char>(i * 31 + 7);
+        }
+        std::string entero(largo.size(), '\0');
+        transformarAESCTR(e, iv_alto, iv_bajo, largo.data(), &entero[0], largo.size(), 0);
+        const size_t cortes[] = {0, 1, 15, 16, 17, 100, 128, 129, 300, 777, 999, 1000};
+        for (size_t a = 0; a + 1 < sizeof(cortes) / sizeof(cortes[0]); a++) {
+            std::string trozos = largo;
+            transformarAESCTR(e, iv_alto, iv_bajo, &trozos[0], &trozos[0], cortes[a], 0);
+            for (size_t b = a; b + 1 < sizeof(cortes) / sizeof(cortes[0]); b++) {
+                size_t desde = cortes[b];
+                size_t hasta = cortes[b + 1];
+                transformarAESCTR(e, iv_alto, iv_bajo, &trozos[desde], &trozos[desde], hasta - desde, desde);
+            }
+            if (trozos != entero) {
+                detalle = std::string(nombre) + ": el cifrado a trozos desde la posicion " + std::to_string(cortes[a]) + " no coincide";
+                return false;
+            }
+        }
+        transformarAESCTR(e, iv_alto, iv_bajo, &entero[0], &entero[0], entero.size(), 0);
+        if (entero != largo) {
+            detalle = std::string(nombre) + ": descifrar no devuelve el original";
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // CIFRADO_AES_H
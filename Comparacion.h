@@ -0,0 +1,216 @@
+#ifndef COMPARACION_H
+#define COMPARACION_H
+
+// Comparacion de archivos por bloques: primero los tamaños (sin leer nada),
+// despues bloques grandes con un kernel SIMD que devuelve el primer byte
+// distinto. Con archivos grandes mapeados, los rangos se comparan en paralelo.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <immintrin.h>
+
+#include "CapacidadesCPU.h"
+#include "EntradaSalida.h"
+#include "PoolBuffers.h"
+#include "PoolHilos.h"
+
+// Devuelven el indice del primer byte distinto de a y b, o n si son iguales
+typedef size_t (*KernelComparacion)(const uint8_t* a, const uint8_t* b, size_t n);
+
+inline size_t primeraDiferenciaEscalar(const uint8_t* a, const uint8_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        if (x != y) {
+            break;
+        }
+    }
+    while (i < n && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+inline size_t primeraDiferenciaSSE2(const uint8_t* a, const uint8_t* b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        unsigned int iguales = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+        if (iguales != 0xFFFF) {
+            return i + static_cast<size_t>(__builtin_ctz(~iguales));
+        }
+    }
+    return i + primeraDiferenciaEscalar(a + i, b + i, n - i);
+}
+
+SO_TARGET("avx2")
+inline size_t primeraDiferenciaAVX2(const uint8_t* a, const uint8_t* b, size_t n) {
+    size_t i = 0;
+    // 64 bytes por iteracion; solo se localiza el byte cuando algo difiere
+    for (; i + 64 <= n; i += 64) {
+        __m256i e0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                       _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i e1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i + 32)),
+                                       _mm256_loadu_si256((const __m256i*)(b + i + 32)));
+        if (static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(e0, e1))) != 0xFFFFFFFFu) {
+            uint64_t iguales = static_cast<uint32_t>(_mm256_movemask_epi8(e0)) |
+                               (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(e1))) << 32);
+            return i + static_cast<size_t>(__builtin_ctzll(~iguales));
+        }
+    }
+    return i + primeraDiferenciaSSE2(a + i, b + i, n - i);
+}
+
+inline KernelComparacion kernelComparacionActivo() {
+    static const KernelComparacion kernel = capacidadesCPU().avx2 ? primeraDiferenciaAVX2 : primeraDiferenciaSSE2;
+    return kernel;
+}
+
+struct ResultadoComparacion {
+    bool error = false;             // No se pudo abrir o leer alguno de los archivos
+    bool iguales = false;
+    int64_t tam1 = 0;
+    int64_t tam2 = 0;
+    int64_t primer_distinto = -1;   // Offset del primer byte distinto (-1 si iguales o si solo difiere el tamaño)
+};
+
+// Bloque de lectura del camino con flujos
+const size_t TAM_BLOQUE_COMPARACION = 1024 * 1024;
+// Rangos comparados en paralelo cuando los archivos estan mapeados
+const size_t TAM_RANGO_COMPARACION = 16 * 1024 * 1024;
+
+// Compara dos zonas de memoria del mismo tamaño, por rangos en el pool si es
+// grande. Devuelve el primer offset distinto o -1.
+inline int64_t compararMemoria(const uint8_t* a, const uint8_t* b, size_t tam, PoolHilos* pool) {
+    KernelComparacion kernel = kernelComparacionActivo();
+    if (pool == nullptr || pool->numHilos() < 2 || tam < 4 * TAM_RANGO_COMPARACION) {
+        size_t pos = kernel(a, b, tam);
+        return pos == tam ? -1 : static_cast<int64_t>(pos);
+    }
+    // Cada rango se salta si ya se encontro una diferencia antes de su inicio
+    std::atomic<size_t> primera(tam);
+    GrupoTareas rangos(*pool);
+    for (size_t inicio = 0; inicio < tam; inicio += TAM_RANGO_COMPARACION) {
+        size_t n = std::min(TAM_RANGO_COMPARACION, tam - inicio);
+        rangos.lanzar([&primera, kernel, a, b, inicio, n]() {
+            if (primera.load(std::memory_order_relaxed) < inicio) {
+                return;
+            }
+            size_t pos = kernel(a + inicio, b + inicio, n);
+            if (pos == n) {
+                return;
+            }
+            size_t actual = primera.load(std::memory_order_relaxed);
+            while (inicio + pos < actual && !primera.compare_exchange_weak(actual, inicio + pos)) {
+            }
+        });
+    }
+    rangos.esperar();
+    size_t pos = primera.load();
+    return pos == tam ? -1 : static_cast<int64_t>(pos);
+}
+
+inline ResultadoComparacion compararArchivosPorBloques(const std::string& archivo1, const std::string& archivo2,
+                                                       BackendES es, PoolHilos* pool = nullptr) {
+    ResultadoComparacion resultado;
+    resultado.tam1 = tamArchivo(archivo1);
+    resultado.tam2 = tamArchivo(archivo2);
+    if (resultado.tam1 < 0 || resultado.tam2 < 0) {
+        resultado.error = true;
+        return resultado;
+    }
+    // Tamaños distintos: no hace falta leer ningun byte
+    if (resultado.tam1 != resultado.tam2) {
+        return resultado;
+    }
+
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        ArchivoMapeado f1;
+        ArchivoMapeado f2;
+        if (!f1.abrirLectura(archivo1) || !f2.abrirLectura(archivo2) || f1.tam() != f2.tam()) {
+            resultado.error = true;
+            return resultado;
+        }
+        resultado.primer_distinto = compararMemoria(reinterpret_cast<const uint8_t*>(f1.datos()),
+                                                    reinterpret_cast<const uint8_t*>(f2.datos()), f1.tam(), pool);
+        resultado.iguales = (resultado.primer_distinto < 0);
+        return resultado;
+    }
+#else
+    (void)es;
+#endif
+
+    std::ifstream f1(archivo1, std::ios::binary);
+    std::ifstream f2(archivo2, std::ios::binary);
+    if (!f1.is_open() || !f2.is_open()) {
+        resultado.error = true;
+        return resultado;
+    }
+    KernelComparacion kernel = kernelComparacionActivo();
+    BufferPrestado b1(TAM_BLOQUE_COMPARACION);
+    BufferPrestado b2(TAM_BLOQUE_COMPARACION);
+    int64_t offset = 0;
+    while (offset < resultado.tam1) {
+        f1.read(b1.data(), b1.size());
+        f2.read(b2.data(), b2.size());
+        std::streamsize n1 = f1.gcount();
+        std::streamsize n2 = f2.gcount();
+        if (n1 <= 0 || n1 != n2) {
+            resultado.error = true;     // El archivo cambio durante la comparacion
+            return resultado;
+        }
+        size_t n = static_cast<size_t>(n1);
+        size_t pos = kernel(reinterpret_cast<const uint8_t*>(b1.data()), reinterpret_cast<const uint8_t*>(b2.data()), n);
+        if (pos != n) {
+            resultado.primer_distinto = offset + static_cast<int64_t>(pos);
+            return resultado;
+        }
+        offset += n1;
+    }
+    resultado.iguales = true;
+    return resultado;
+}
+
+// Compara cada kernel con la version escalar en todas las posiciones de la
+// primera diferencia y con distintos desalineamientos
+inline bool verificarKernelsComparacion(std::string& detalle) {
+    std::vector<uint8_t> a(300), b;
+    for (size_t i = 0; i < a.size(); i++) {
+        a[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    std::vector<std::pair<const char*, KernelComparacion>> kernels = {{"SSE2", primeraDiferenciaSSE2}};
+    if (capacidadesCPU().avx2) {
+        kernels.push_back({"AVX2", primeraDiferenciaAVX2});
+    }
+    for (const auto& k : kernels) {
+        for (size_t offset = 0; offset < 4; offset++) {
+            for (size_t len = 0; len + offset <= a.size(); len += (len < 140 ? 1 : 13)) {
+                for (size_t diff = 0; diff <= len; diff++) {
+                    b = a;
+                    if (diff < len) {
+                        b[offset + diff] ^= 0x80;
+                    }
+                    size_t esperado = primeraDiferenciaEscalar(&a[offset], &b[offset], len);
+                    size_t obtenido = k.second(&a[offset], &b[offset], len);
+                    if (esperado != diff || obtenido != esperado) {
+                        detalle = std::string("kernel ") + k.first + " con longitud " + std::to_string(len) +
+                                  ": esperado " + std::to_string(diff) + ", obtenido " + std::to_string(obtenido);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif // COMPARACION_H
@@ -0,0 +1,447 @@
+#ifndef COMPRESION_LZ_H
+#define COMPRESION_LZ_H
+
+// Compresion LZ rapida, sin dependencias, con el formato de bloque de LZ4:
+// cada secuencia es un token (4 bits de longitud de literales y 4 de longitud
+// de coincidencia), los literales, el desplazamiento de 16 bits (little
+// endian) y las extensiones de longitud en bytes de 255. La busqueda es voraz
+// con una tabla hash de 4 bytes, y avanza mas deprisa en zonas sin
+// coincidencias para no perder tiempo en datos incompresibles.
+//
+// Un marco es una cabecera ("SOLZ" y el tamaño de bloque) seguida de bloques
+// independientes, cada uno con su propia cabecera:
+//   uint32 tamaño original, uint32 tamaño guardado (bit alto: sin comprimir)
+// y un bloque final con ambos a cero. Como ningun bloque depende del anterior,
+// se pueden descomprimir en paralelo tras recorrer las cabeceras.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "PoolHilos.h"
+
+const char MAGICO_MARCO_LZ[4] = {'S', 'O', 'L', 'Z'};
+const size_t TAM_CABECERA_MARCO_LZ = 8;
+const size_t TAM_CABECERA_BLOQUE_LZ = 8;
+const size_t TAM_BLOQUE_LZ = 1024 * 1024;           // Texto plano por bloque
+const size_t TAM_BLOQUE_LZ_MAXIMO = 64 * 1024 * 1024;  // Lo mayor que se acepta al leer un marco
+const uint32_t BLOQUE_LZ_SIN_COMPRIMIR = 0x80000000u;
+
+// Espacio maximo que puede ocupar un bloque comprimido de 'n' bytes
+inline size_t cotaComprimidoLZ(size_t n) {
+    return n + n / 255 + 16;
+}
+
+namespace detalle_lz {
+
+const size_t COINCIDENCIA_MINIMA = 4;
+const size_t ULTIMOS_LITERALES = 5;     // El bloque siempre termina en literales
+const size_t LIMITE_COINCIDENCIA = 12;  // Ninguna coincidencia empieza en los ultimos 12 bytes
+const int BITS_HASH = 12;
+const size_t DISTANCIA_MAXIMA = 65535;
+
+inline uint32_t leer32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash4(uint32_t secuencia) {
+    return (secuencia * 2654435761u) >> (32 - BITS_HASH);
+}
+
+// Longitud en la codificacion LZ4: los 4 bits del token y, si no alcanzan, bytes de 255
+inline bool escribirLongitud(uint8_t*& op, const uint8_t* fin, size_t resto) {
+    while (resto >= 255) {
+        if (op >= fin) {
+            return false;
+        }
+        *op++ = 255;
+        resto -= 255;
+    }
+    if (op >= fin) {
+        return false;
+    }
+    *op++ = static_cast<uint8_t>(resto);
+    return true;
+}
+
+inline bool escribirSecuencia(uint8_t*& op, const uint8_t* fin, const uint8_t* literales, size_t num_literales,
+                              size_t desplazamiento, size_t longitud) {
+    if (op >= fin) {
+        return false;
+    }
+    uint8_t* token = op++;
+    size_t extra_coincidencia = longitud >= COINCIDENCIA_MINIMA ? longitud - COINCIDENCIA_MINIMA : 0;
+    *token = static_cast<uint8_t>(((num_literales >= 15 ? 15 : num_literales) << 4) |
+                                  (longitud == 0 ? 0 : (extra_coincidencia >= 15 ? 15 : extra_coincidencia)));
+    if (num_literales >= 15 && !escribirLongitud(op, fin, num_literales - 15)) {
+        return false;
+    }
+    if (static_cast<size_t>(fin - op) < num_literales) {
+        return false;
+    }
+    std::memcpy(op, literales, num_literales);
+    op += num_literales;
+    if (longitud == 0) {
+        return true;    // Ultima secuencia: solo literales
+    }
+    if (fin - op < 2) {
+        return false;
+    }
+    *op++ = static_cast<uint8_t>(desplazamiento & 0xFF);
+    *op++ = static_cast<uint8_t>(desplazamiento >> 8);
+    return extra_coincidencia < 15 || escribirLongitud(op, fin, extra_coincidencia - 15);
+}
+
+inline bool leerLongitud(const uint8_t*& ip, const uint8_t* fin, size_t& longitud) {
+    uint8_t b;
+    do {
+        if (ip >= fin) {
+            return false;
+        }
+        b = *ip++;
+        longitud += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace detalle_lz
+
+// Comprime 'n' bytes (como mucho 2 GiB) en 'destino'. Devuelve el tamaño
+// comprimido, o 0 si no cabe en 'capacidad' (el llamador lo guarda sin comprimir).
+inline size_t comprimirBloqueLZ(const uint8_t* origen, size_t n, uint8_t* destino, size_t capacidad) {
+    using namespace detalle_lz;
+    uint8_t* op = destino;
+    const uint8_t* fin_destino = destino + capacidad;
+    size_t ancla = 0;
+
+    if (n > LIMITE_COINCIDENCIA) {
+        int32_t tabla[1 << BITS_HASH];
+        std::memset(tabla, 0xFF, sizeof(tabla));   // -1: sin posicion
+        const size_t limite = n - LIMITE_COINCIDENCIA;
+        const size_t fin_coincidencia = n - ULTIMOS_LITERALES;
+        size_t ip = 0;
+        while (ip <= limite) {
+            uint32_t secuencia = leer32(origen + ip);
+            uint32_t h = hash4(secuencia);
+            int32_t candidato = tabla[h];
+            tabla[h] = static_cast<int32_t>(ip);
+            if (candidato < 0 || ip - static_cast<size_t>(candidato) > DISTANCIA_MAXIMA ||
+                leer32(origen + candidato) != secuencia) {
+                ip += 1 + ((ip - ancla) >> 6);     // Sin coincidencias: saltar cada vez mas
+                continue;
+            }
+            size_t referencia = static_cast<size_t>(candidato);
+            // Extender hacia atras sobre los literales pendientes
+            while (ip > ancla && referencia > 0 && origen[ip - 1] == origen[referencia - 1]) {
+                --ip;
+                --referencia;
+            }
+            size_t longitud = COINCIDENCIA_MINIMA;
+            while (ip + longitud < fin_coincidencia && origen[referencia + longitud] == origen[ip + longitud]) {
+                ++longitud;
+            }
+            if (!escribirSecuencia(op, fin_destino, origen + ancla, ip - ancla, ip - referencia, longitud)) {
+                return 0;
+            }
+            ip += longitud;
+            ancla = ip;
+            if (ip <= limite) {
+                tabla[hash4(leer32(origen + ip - 2))] = static_cast<int32_t>(ip - 2);
+            }
+        }
+    }
+    if (!escribirSecuencia(op, fin_destino, origen + ancla, n - ancla, 0, 0)) {
+        return 0;
+    }
+    return static_cast<size_t>(op - destino);
+}
+
+// Descomprime un bloque que debe dar exactamente 'tam_original' bytes.
+// Comprueba todos los limites: un bloque corrupto devuelve false, nunca
+// lee ni escribe fuera de los buffers.
+inline bool descomprimirBloqueLZ(const uint8_t* origen, size_t n, uint8_t* destino, size_t tam_original) {
+    using namespace detalle_lz;
+    const uint8_t* ip = origen;
+    const uint8_t* fin = origen + n;
+    size_t op = 0;
+    while (true) {
+        if (ip >= fin) {
+            return false;
+        }
+        uint8_t token = *ip++;
+        size_t literales = token >> 4;
+        if (literales == 15 && !leerLongitud(ip, fin, literales)) {
+            return false;
+        }
+        if (static_cast<size_t>(fin - ip) < literales || tam_original - op < literales) {
+            return false;
+        }
+        std::memcpy(destino + op, ip, literales);
+        ip += literales;
+        op += literales;
+        if (ip == fin) {
+            return op == tam_original;
+        }
+        if (fin - ip < 2) {
+            return false;
+        }
+        size_t desplazamiento = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        size_t longitud = token & 15;
+        if (longitud == 15 && !leerLongitud(ip, fin, longitud)) {
+            return false;
+        }
+        longitud += COINCIDENCIA_MINIMA;
+        if (desplazamiento == 0 || desplazamiento > op || tam_original - op < longitud) {
+            return false;
+        }
+        uint8_t* d = destino + op;
+        const uint8_t* s = d - desplazamiento;
+        if (desplazamiento >= longitud) {
+            std::memcpy(d, s, longitud);
+        } else {
+            for (size_t i = 0; i < longitud; ++i) {   // Solapada: repite el patron
+                d[i] = s[i];
+            }
+        }
+        op += longitud;
+    }
+}
+
+inline void escribirLE32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+inline uint32_t leerLE32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void escribirCabeceraMarcoLZ(uint8_t* p) {
+    std::memcpy(p, MAGICO_MARCO_LZ, 4);
+    escribirLE32(p + 4, static_cast<uint32_t>(TAM_BLOQUE_LZ));
+}
+
+inline bool esCabeceraMarcoLZ(const uint8_t* p) {
+    return std::memcmp(p, MAGICO_MARCO_LZ, 4) == 0 && leerLE32(p + 4) > 0 && leerLE32(p + 4) <= TAM_BLOQUE_LZ_MAXIMO;
+}
+
+// Bloque completo (cabecera + datos) de 'n' bytes de texto plano en 'destino',
+// que debe tener TAM_CABECERA_BLOQUE_LZ + cotaComprimidoLZ(n) bytes. Devuelve
+// los bytes escritos. Si comprimir no ahorra nada, el bloque va tal cual.
+inline size_t comprimirBloqueConCabeceraLZ(const uint8_t* origen, size_t n, uint8_t* destino) {
+    uint8_t* datos = destino + TAM_CABECERA_BLOQUE_LZ;
+    size_t comprimido = comprimirBloqueLZ(origen, n, datos, n > 0 ? n - 1 : 0);
+    uint32_t guardado = static_cast<uint32_t>(comprimido);
+    if (comprimido == 0) {
+        std::memcpy(datos, origen, n);
+        comprimido = n;
+        guardado = static_cast<uint32_t>(n) | BLOQUE_LZ_SIN_COMPRIMIR;
+    }
+    escribirLE32(destino, static_cast<uint32_t>(n));
+    escribirLE32(destino + 4, guardado);
+    return TAM_CABECERA_BLOQUE_LZ + comprimido;
+}
+
+// Cabecera de bloque: tamaños original y guardado. El bloque final tiene ambos a cero.
+struct CabeceraBloqueLZ {
+    uint32_t tam_original = 0;
+    uint32_t tam_guardado = 0;
+    bool sin_comprimir = false;
+};
+
+inline bool leerCabeceraBloqueLZ(const uint8_t* p, size_t tam_bloque_marco, CabeceraBloqueLZ& c) {
+    c.tam_original = leerLE32(p);
+    uint32_t guardado = leerLE32(p + 4);
+    c.sin_comprimir = (guardado & BLOQUE_LZ_SIN_COMPRIMIR) != 0;
+    c.tam_guardado = guardado & ~BLOQUE_LZ_SIN_COMPRIMIR;
+    if (c.tam_original > tam_bloque_marco || c.tam_guardado > cotaComprimidoLZ(tam_bloque_marco)) {
+        return false;
+    }
+    return !c.sin_comprimir || c.tam_guardado == c.tam_original;
+}
+
+inline bool descomprimirDatosBloqueLZ(const CabeceraBloqueLZ& c, const uint8_t* datos, uint8_t* destino) {
+    if (c.sin_comprimir) {
+        std::memcpy(destino, datos, c.tam_original);
+        return true;
+    }
+    return descomprimirBloqueLZ(datos, c.tam_guardado, destino, c.tam_original);
+}
+
+// Marco completo en memoria
+inline void comprimirMarcoLZ(const uint8_t* datos, size_t n, std::vector<uint8_t>& marco) {
+    size_t num_bloques = (n + TAM_BLOQUE_LZ - 1) / TAM_BLOQUE_LZ;
+    marco.resize(TAM_CABECERA_MARCO_LZ + num_bloques * (TAM_CABECERA_BLOQUE_LZ + cotaComprimidoLZ(TAM_BLOQUE_LZ)) + TAM_CABECERA_BLOQUE_LZ);
+    escribirCabeceraMarcoLZ(marco.data());
+    size_t pos = TAM_CABECERA_MARCO_LZ;
+    for (size_t inicio = 0; inicio < n; inicio += TAM_BLOQUE_LZ) {
+        size_t len = n - inicio < TAM_BLOQUE_LZ ? n - inicio : TAM_BLOQUE_LZ;
+        pos += comprimirBloqueConCabeceraLZ(datos + inicio, len, marco.data() + pos);
+    }
+    std::memset(marco.data() + pos, 0, TAM_CABECERA_BLOQUE_LZ);
+    marco.resize(pos + TAM_CABECERA_BLOQUE_LZ);
+}
+
+// Bloque de un marco ya localizado: sus datos empiezan en 'origen' y su texto
+// plano va en 'destino'
+struct BloqueMarcoLZ {
+    CabeceraBloqueLZ cabecera;
+    size_t origen;
+    size_t destino;
+};
+
+// Descomprime 'num' bloques desde 'datos' hacia 'salida', en paralelo en el
+// pool (o en este thread si no hay pool)
+inline bool descomprimirBloquesLZ(const BloqueMarcoLZ* bloques, size_t num, const uint8_t* datos, uint8_t* salida, PoolHilos* pool) {
+    std::atomic<bool> correcto(true);
+    auto descomprimir = [&](const BloqueMarcoLZ& b) {
+        if (!descomprimirDatosBloqueLZ(b.cabecera, datos + b.origen, salida + b.destino)) {
+            correcto = false;
+        }
+    };
+    if (pool != nullptr && num > 1) {
+        GrupoTareas tareas(*pool);
+        for (size_t k = 0; k < num; ++k) {
+            const BloqueMarcoLZ& b = bloques[k];
+            tareas.lanzar([&descomprimir, &b]() { descomprimir(b); });
+        }
+        tareas.esperar();
+    } else {
+        for (size_t k = 0; k < num; ++k) {
+            descomprimir(bloques[k]);
+        }
+    }
+    return correcto.load();
+}
+
+// Descomprime un marco en memoria. Primero recorre las cabeceras para saber
+// donde empieza cada bloque y cuanto ocupa el resultado; despues descomprime
+// los bloques en paralelo.
+inline bool descomprimirMarcoLZ(const uint8_t* marco, size_t n, std::vector<uint8_t>& salida, PoolHilos* pool = nullptr) {
+    if (n < TAM_CABECERA_MARCO_LZ || !esCabeceraMarcoLZ(marco)) {
+        return false;
+    }
+    const size_t tam_bloque_marco = leerLE32(marco + 4);
+    std::vector<BloqueMarcoLZ> bloques;
+    size_t pos = TAM_CABECERA_MARCO_LZ;
+    size_t total = 0;
+    while (true) {
+        BloqueMarcoLZ b;
+        if (n - pos < TAM_CABECERA_BLOQUE_LZ || !leerCabeceraBloqueLZ(marco + pos, tam_bloque_marco, b.cabecera)) {
+            return false;
+        }
+        pos += TAM_CABECERA_BLOQUE_LZ;
+        if (b.cabecera.tam_original == 0) {
+            break;      // Bloque final
+        }
+        if (n - pos < b.cabecera.tam_guardado) {
+            return false;
+        }
+        b.origen = pos;
+        b.destino = total;
+        bloques.push_back(b);
+        pos += b.cabecera.tam_guardado;
+        total += b.cabecera.tam_original;
+    }
+    if (pos != n) {
+        return false;
+    }
+    salida.resize(total);
+    return descomprimirBloquesLZ(bloques.data(), bloques.size(), marco, salida.data(), pool);
+}
+
+// Bytes de texto plano comprimidos y bytes escritos durante la ejecucion (para el informe)
+struct EstadisticasCompresionLZ {
+    std::atomic<uint64_t> entrada{0};
+    std::atomic<uint64_t> salida{0};
+};
+
+inline EstadisticasCompresionLZ& estadisticasCompresionLZ() {
+    static EstadisticasCompresionLZ estadisticas;
+    return estadisticas;
+}
+
+// Ida y vuelta con datos de distinto tipo (texto repetitivo, aleatorio,
+// patrones solapados, vacio), con y sin pool, y rechazo de marcos corruptos
+inline bool verificarCompresionLZ(std::string& detalle) {
+    std::vector<std::vector<uint8_t>> casos;
+    casos.push_back({});
+    casos.push_back({'a'});
+    casos.push_back(std::vector<uint8_t>(100000, 'x'));
+    {
+        std::string texto;
+        while (texto.size() < 2 * TAM_BLOQUE_LZ + 12345) {
+            texto += "El veloz murcielago hindu comia feliz cardillo y kiwi " + std::to_string(texto.size() % 977) + "\n";
+        }
+        casos.push_back(std::vector<uint8_t>(texto.begin(), texto.end()));
+    }
+    {
+        std::vector<uint8_t> aleatorio(300000);
+        uint32_t estado = 2463534242u;
+        for (uint8_t& b : aleatorio) {
+            estado ^= estado << 13;
+            estado ^= estado >> 17;
+            estado ^= estado << 5;
+            b = static_cast<uint8_t>(estado);
+        }
+        // Una zona repetida lejos (mas alla de la ventana de 64 KiB) y otra cerca
+        std::memcpy(aleatorio.data() + 200000, aleatorio.data() + 10, 5000);
+        std::memmove(aleatorio.data() + 250000, aleatorio.data() + 249000, 3000);
+        casos.push_back(aleatorio);
+    }
+    for (size_t n = 1; n < 40; ++n) {
+        std::vector<uint8_t> corto(n);
+        for (size_t i = 0; i < n; ++i) {
+            corto[i] = static_cast<uint8_t>("abcab"[i % 5]);
+        }
+        casos.push_back(corto);
+    }
+
+    PoolHilos pool(2);
+    for (size_t c = 0; c < casos.size(); ++c) {
+        const std::vector<uint8_t>& datos = casos[c];
+        std::vector<uint8_t> marco;
+        comprimirMarcoLZ(datos.data(), datos.size(), marco);
+        for (int con_pool = 0; con_pool < 2; ++con_pool) {
+            std::vector<uint8_t> vuelta;
+            if (!descomprimirMarcoLZ(marco.data(), marco.size(), vuelta, con_pool ? &pool : nullptr) || vuelta != datos) {
+                detalle = "ida y vuelta incorrecta en el caso " + std::to_string(c);
+                return false;
+            }
+        }
+        // Cualquier corte del marco debe rechazarse sin salirse de los buffers
+        if (marco.size() > TAM_CABECERA_MARCO_LZ + TAM_CABECERA_BLOQUE_LZ) {
+            std::vector<uint8_t> vuelta;
+            if (descomprimirMarcoLZ(marco.data(), marco.size() - 1, vuelta)) {
+                detalle = "se acepto un marco truncado en el caso " + std::to_string(c);
+                return false;
+            }
+        }
+    }
+    // El texto repetitivo debe comprimirse bastante
+    std::vector<uint8_t> marco;
+    comprimirMarcoLZ(casos[3].data(), casos[3].size(), marco);
+    if (marco.size() * 4 > casos[3].size()) {
+        detalle = "el texto de prueba apenas se comprime (" + std::to_string(marco.size()) + " de " + std::to_string(casos[3].size()) + " bytes)";
+        return false;
+    }
+    // Bytes alterados dentro de los datos comprimidos: error o resultado, pero sin fallos de memoria
+    for (size_t i = TAM_CABECERA_MARCO_LZ + TAM_CABECERA_BLOQUE_LZ; i < marco.size(); i += 997) {
+        std::vector<uint8_t> alterado = marco;
+        alterado[i] ^= 0x5A;
+        std::vector<uint8_t> vuelta;
+        descomprimirMarcoLZ(alterado.data(), alterado.size(), vuelta);
+    }
+    return true;
+}
+
+#endif // COMPRESION_LZ_H
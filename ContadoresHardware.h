@@ -0,0 +1,175 @@
+#ifndef CONTADORES_HARDWARE_H
+#define CONTADORES_HARDWARE_H
+
+// Contadores de hardware por thread (perf_event_open, solo Linux): ciclos,
+// instrucciones, fallos de la cache de ultimo nivel y fallos de prediccion de
+// saltos. Se abren como un grupo por thread la primera vez que ese thread los
+// lee, de modo que los cuatro valores de una lectura son coherentes entre si.
+// Si el kernel no los permite (perf_event_paranoid, maquina virtual sin PMU,
+// seccomp...) lectura() devuelve valida = false y el programa sigue midiendo
+// solo el tiempo.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SO_TIENE_PERF_EVENT 1
+#else
+#define SO_TIENE_PERF_EVENT 0
+#endif
+
+struct LecturaContadores {
+    bool valida = false;
+    uint64_t ciclos = 0;
+    uint64_t instrucciones = 0;
+    uint64_t fallos_llc = 0;        // 0 si el procesador no ofrece el evento
+    uint64_t fallos_rama = 0;
+
+    LecturaContadores operator-(const LecturaContadores& inicio) const {
+        LecturaContadores d;
+        d.valida = valida && inicio.valida;
+        d.ciclos = ciclos - inicio.ciclos;
+        d.instrucciones = instrucciones - inicio.instrucciones;
+        d.fallos_llc = fallos_llc - inicio.fallos_llc;
+        d.fallos_rama = fallos_rama - inicio.fallos_rama;
+        return d;
+    }
+};
+
+#if SO_TIENE_PERF_EVENT
+
+// Grupo de contadores del thread que lo crea (solo cuenta en modo usuario, lo
+// que basta con perf_event_paranoid <= 2)
+class ContadoresHilo {
+public:
+    ContadoresHilo() {
+        // El lider del grupo son los ciclos; sin ellos no hay nada que medir
+        lider = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (lider < 0) {
+            error = errno;
+            return;
+        }
+        fds[1] = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, lider);
+        fds[2] = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, lider);
+        fds[3] = abrir(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, lider);
+        fds[0] = lider;
+        // Posicion de cada contador abierto dentro de la lectura del grupo
+        int posicion = 0;
+        for (int k = 0; k < 4; ++k) {
+            indice[k] = fds[k] >= 0 ? posicion++ : -1;
+        }
+        num_abiertos = posicion;
+        ::ioctl(lider, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(lider, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    ~ContadoresHilo() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+
+    ContadoresHilo(const ContadoresHilo&) = delete;
+    ContadoresHilo& operator=(const ContadoresHilo&) = delete;
+
+    bool disponible() const { return lider >= 0; }
+    int errorApertura() const { return error; }
+
+    LecturaContadores leer() const {
+        LecturaContadores l;
+        if (lider < 0) {
+            return l;
+        }
+        // PERF_FORMAT_GROUP: numero de contadores seguido de sus valores
+        uint64_t datos[1 + 4];
+        ssize_t leidos = ::read(lider, datos, sizeof(datos));
+        if (leidos < static_cast<ssize_t>(sizeof(uint64_t)) || static_cast<int>(datos[0]) != num_abiertos) {
+            return l;
+        }
+        uint64_t* valores[4] = {&l.ciclos, &l.instrucciones, &l.fallos_llc, &l.fallos_rama};
+        for (int k = 0; k < 4; ++k) {
+            if (indice[k] >= 0) {
+                *valores[k] = datos[1 + indice[k]];
+            }
+        }
+        l.valida = true;
+        return l;
+    }
+
+private:
+    static int abrir(uint32_t tipo, uint64_t config, int grupo) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = tipo;
+        attr.config = config;
+        attr.disabled = (grupo < 0) ? 1 : 0;   // El grupo entero se activa desde el lider
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        return static_cast<int>(::syscall(__NR_perf_event_open, &attr, 0, -1, grupo, 0));
+    }
+
+    int lider = -1;
+    int fds[4] = {-1, -1, -1, -1};
+    int indice[4] = {-1, -1, -1, -1};
+    int num_abiertos = 0;
+    int error = 0;
+};
+
+// Contadores del thread actual (se abren en la primera llamada de cada thread)
+inline LecturaContadores leerContadoresHilo() {
+    thread_local ContadoresHilo contadores;
+    return contadores.leer();
+}
+
+// Prueba una vez si el kernel deja abrir los contadores; si no, explica por que
+inline bool contadoresHardwareDisponibles(std::string* motivo = nullptr) {
+    static const int error = []() {
+        ContadoresHilo prueba;
+        return prueba.disponible() ? 0 : prueba.errorApertura();
+    }();
+    if (error != 0 && motivo != nullptr) {
+        switch (error) {
+            case EACCES:
+            case EPERM:
+                *motivo = "sin permiso (ver /proc/sys/kernel/perf_event_paranoid)";
+                break;
+            case ENOENT:
+            case EOPNOTSUPP:
+                *motivo = "el procesador o la maquina virtual no exponen contadores";
+                break;
+            case ENOSYS:
+                *motivo = "el kernel no soporta perf_event_open";
+                break;
+            default:
+                *motivo = std::strerror(error);
+        }
+    }
+    return error == 0;
+}
+
+#else
+
+inline LecturaContadores leerContadoresHilo() {
+    return LecturaContadores();
+}
+
+inline bool contadoresHardwareDisponibles(std::string* motivo = nullptr) {
+    if (motivo != nullptr) {
+        *motivo = "solo disponible en Linux";
+    }
+    return false;
+}
+
+#endif // SO_TIENE_PERF_EVENT
+
+#endif // CONTADORES_HARDWARE_H
@@ -0,0 +1,188 @@
+#ifndef DIARIO_LOTE_H
+#define DIARIO_LOTE_H
+
+// Diario de un lote por directorios, para reanudar una ejecucion interrumpida.
+// Es un archivo de texto al que solo se añaden lineas, tras una cabecera:
+//   # config <configuracion>
+//   P dispositivo inodo tam mtime_ns cifrado_hasta ruta
+//   C dispositivo inodo tam mtime_ns sha256 tam_enc mtime_enc_ns ruta
+// P anota hasta que byte esta cifrado (y sincronizado en disco) el .enc de un
+// archivo grande; C, que el archivo quedo cifrado y verificado. La ruta es la
+// relativa dentro del directorio de salida y ocupa el resto de la linea. Al
+// abrir el diario se compacta: se reescribe con el ultimo estado de cada ruta.
+// La cabecera describe como se escribieron los .enc (compresion, motor de
+// cifrado, huella de la clave e IV); si no coincide con la de la ejecucion
+// actual, las entradas no sirven para reanudar y el diario empieza de cero.
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include "CacheHash.h"
+
+struct EntradaDiario {
+    ClaveArchivo clave;             // Version de la entrada a la que se refiere
+    bool completo = false;
+    uint64_t cifrado_hasta = 0;     // Solo en las entradas parciales
+    std::string hash;               // Solo en las completas
+    uint64_t tam_enc = 0;
+    int64_t mtime_enc_ns = 0;
+};
+
+class DiarioLote {
+public:
+    DiarioLote() = default;
+    ~DiarioLote() { cerrar(); }
+
+    DiarioLote(const DiarioLote&) = delete;
+    DiarioLote& operator=(const DiarioLote&) = delete;
+
+    // Lee el diario (si existe), lo compacta y lo deja abierto para añadir.
+    // Si se escribio con otra 'configuracion', se descartan sus entradas.
+    bool abrir(const std::string& ruta, const std::string& configuracion, std::string& error) {
+        cerrar();
+        entradas.clear();
+        descartado = false;
+        std::ifstream ifs(ruta);
+        std::string linea;
+        bool cabecera_valida = false;
+        if (ifs.is_open() && std::getline(ifs, linea)) {
+            cabecera_valida = linea == PREFIJO_CABECERA + configuracion;
+            descartado = !cabecera_valida;
+        }
+        while (cabecera_valida && std::getline(ifs, linea)) {
+            std::string relativa;
+            EntradaDiario e;
+            if (parsearLinea(linea, relativa, e)) {
+                entradas[relativa] = e;
+            }
+        }
+        ifs.close();
+
+        const std::string temporal = ruta + ".tmp";
+        std::FILE* f = std::fopen(temporal.c_str(), "w");
+        if (f == nullptr) {
+            error = "no se pudo crear " + temporal;
+            return false;
+        }
+        std::fputs((PREFIJO_CABECERA + configuracion + "\n").c_str(), f);
+        for (const auto& e : entradas) {
+            std::fputs(formatearLinea(e.first, e.second).c_str(), f);
+        }
+        bool escrito = std::fflush(f) == 0;
+        escrito = std::fclose(f) == 0 && escrito;
+        std::error_code ec;
+        if (escrito) {
+            std::filesystem::rename(temporal, ruta, ec);
+        }
+        if (!escrito || ec) {
+            error = "no se pudo compactar el diario " + ruta;
+            return false;
+        }
+        archivo = std::fopen(ruta.c_str(), "a");
+        if (archivo == nullptr) {
+            error = "no se pudo abrir el diario " + ruta;
+            return false;
+        }
+        return true;
+    }
+
+    // Estado anotado de 'relativa' al abrir el diario (nullptr si no hay)
+    const EntradaDiario* buscar(const std::string& relativa) const {
+        auto it = entradas.find(relativa);
+        return it == entradas.end() ? nullptr : &it->second;
+    }
+
+    size_t numEntradas() const { return entradas.size(); }
+
+    // true si al abrir habia un diario de otra configuracion (o sin cabecera)
+    bool descartadoPorConfiguracion() const { return descartado; }
+
+    // El llamador ya sincronizo el .enc hasta 'cifrado_hasta'
+    void anotarParcial(const std::string& relativa, const ClaveArchivo& clave, uint64_t cifrado_hasta) {
+        EntradaDiario e;
+        e.clave = clave;
+        e.cifrado_hasta = cifrado_hasta;
+        anotar(relativa, e);
+    }
+
+    void anotarCompleto(const std::string& relativa, const ClaveArchivo& clave, const std::string& hash, const ClaveArchivo& enc) {
+        EntradaDiario e;
+        e.clave = clave;
+        e.completo = true;
+        e.hash = hash;
+        e.tam_enc = enc.tam;
+        e.mtime_enc_ns = enc.mtime_ns;
+        anotar(relativa, e);
+    }
+
+private:
+    static constexpr const char* PREFIJO_CABECERA = "# config ";
+
+    void anotar(const std::string& relativa, const EntradaDiario& e) {
+        if (relativa.find('\n') != std::string::npos) {
+            return;     // No cabe en una linea: ese archivo simplemente no se reanuda
+        }
+        std::string linea = formatearLinea(relativa, e);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (archivo != nullptr) {
+            // Una linea por escritura y vaciada enseguida: si el proceso muere,
+            // como mucho queda cortada la ultima, que al leer se descarta
+            std::fputs(linea.c_str(), archivo);
+            std::fflush(archivo);
+        }
+    }
+
+    static std::string formatearLinea(const std::string& relativa, const EntradaDiario& e) {
+        std::ostringstream ss;
+        ss << (e.completo ? 'C' : 'P') << ' ' << e.clave.dispositivo << ' ' << e.clave.inodo << ' '
+           << e.clave.tam << ' ' << e.clave.mtime_ns << ' ';
+        if (e.completo) {
+            ss << e.hash << ' ' << e.tam_enc << ' ' << e.mtime_enc_ns;
+        } else {
+            ss << e.cifrado_hasta;
+        }
+        ss << ' ' << relativa << '\n';
+        return ss.str();
+    }
+
+    static bool parsearLinea(const std::string& linea, std::string& relativa, EntradaDiario& e) {
+        std::istringstream ss(linea);
+        char tipo = 0;
+        if (!(ss >> tipo >> e.clave.dispositivo >> e.clave.inodo >> e.clave.tam >> e.clave.mtime_ns)) {
+            return false;
+        }
+        if (tipo == 'C') {
+            e.completo = true;
+            if (!(ss >> e.hash >> e.tam_enc >> e.mtime_enc_ns) || e.hash.size() != 64) {
+                return false;
+            }
+        } else if (tipo != 'P' || !(ss >> e.cifrado_hasta)) {
+            return false;
+        }
+        if (ss.get() != ' ' || !std::getline(ss, relativa) || relativa.empty()) {
+            return false;
+        }
+        return true;
+    }
+
+    void cerrar() {
+        if (archivo != nullptr) {
+            std::fclose(archivo);
+            archivo = nullptr;
+        }
+    }
+
+    std::map<std::string, EntradaDiario> entradas;
+    bool descartado = false;
+    std::mutex mtx;
+    std::FILE* archivo = nullptr;
+};
+
+#endif // DIARIO_LOTE_H
@@ -0,0 +1,374 @@
+#ifndef ENTRADA_SALIDA_H
+#define ENTRADA_SALIDA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SO_TIENE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define SO_TIENE_MMAP 0
+#endif
+
+// io_uring solo existe en Linux; se comprueba ademas en tiempo de ejecucion
+// porque el kernel o un filtro seccomp pueden no permitirlo
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SO_TIENE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#ifndef SO_TIENE_IO_URING
+#define SO_TIENE_IO_URING 0
+#endif
+
+#if defined(__linux__)
+#include <linux/fs.h>       // FICLONE
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+// Forma de leer y escribir los archivos en las etapas de copia, cifrado y hash
+enum class BackendES {
+    Flujo,      // std::ifstream/std::ofstream por bloques (portable)
+    Mmap,       // Archivos mapeados en memoria: los kernels trabajan sobre las paginas
+    IoUring     // Lecturas y escrituras asincronas de todo el lote en un anillo io_uring
+};
+
+// true si el kernel acepta crear un anillo io_uring (se prueba una sola vez)
+inline bool ioUringDisponible() {
+#if SO_TIENE_IO_URING
+    static const bool disponible = []() {
+        struct io_uring_params params = {};
+        int fd = static_cast<int>(::syscall(__NR_io_uring_setup, 4, &params));
+        if (fd < 0) {
+            return false;
+        }
+        ::close(fd);
+        return true;
+    }();
+    return disponible;
+#else
+    return false;
+#endif
+}
+
+inline bool backendESDisponible(BackendES backend) {
+    switch (backend) {
+        case BackendES::Mmap: return SO_TIENE_MMAP;
+        case BackendES::IoUring: return ioUringDisponible();
+        default: return true;
+    }
+}
+
+inline const char* nombreBackendES(BackendES backend) {
+    switch (backend) {
+        case BackendES::Mmap: return "mmap";
+        case BackendES::IoUring: return "io_uring";
+        default: return "flujo";
+    }
+}
+
+// Mmap si el sistema lo soporta; si no, flujos
+inline BackendES backendESPorDefecto() {
+    return backendESDisponible(BackendES::Mmap) ? BackendES::Mmap : BackendES::Flujo;
+}
+
+// Tamaño de un archivo en bytes, o -1 si no existe o no se puede consultar
+inline int64_t tamArchivo(const std::string& ruta) {
+    std::error_code ec;
+    auto tam = std::filesystem::file_size(ruta, ec);
+    return ec ? -1 : static_cast<int64_t>(tam);
+}
+
+// Mecanismo con el que se hizo una copia, del mas barato al mas caro
+enum class MetodoCopia {
+    Reflink,        // FICLONE: los dos archivos comparten los bloques (btrfs, XFS); solo metadatos
+    CopyFileRange,  // El kernel copia los datos sin pasarlos por espacio de usuario
+    Sendfile,       // Igual, con la llamada mas antigua (cuando copy_file_range no esta)
+    Buffer          // Lectura y escritura por bloques desde el programa
+};
+
+inline const char* nombreMetodoCopia(MetodoCopia metodo) {
+    switch (metodo) {
+        case MetodoCopia::Reflink: return "reflink";
+        case MetodoCopia::CopyFileRange: return "copy_file_range";
+        case MetodoCopia::Sendfile: return "sendfile";
+        default: return "buffer";
+    }
+}
+
+// Copias hechas con cada mecanismo durante la ejecucion (para el informe)
+inline std::atomic<unsigned int>& usosMetodoCopia(MetodoCopia metodo) {
+    static std::atomic<unsigned int> usos[4];
+    return usos[static_cast<int>(metodo)];
+}
+
+inline void registrarMetodoCopia(MetodoCopia metodo) {
+    usosMetodoCopia(metodo).fetch_add(1, std::memory_order_relaxed);
+}
+
+// "reflink x10" o "copy_file_range x8, buffer x2"; vacio si no hubo copias
+inline std::string describirMetodosCopia() {
+    std::string texto;
+    for (MetodoCopia metodo : {MetodoCopia::Reflink, MetodoCopia::CopyFileRange, MetodoCopia::Sendfile, MetodoCopia::Buffer}) {
+        unsigned int usos = usosMetodoCopia(metodo).load();
+        if (usos > 0) {
+            texto += (texto.empty() ? "" : ", ") + std::string(nombreMetodoCopia(metodo)) + " x" + std::to_string(usos);
+        }
+    }
+    return texto;
+}
+
+// Copia 'origen' en 'destino' dentro del kernel probando FICLONE, despues
+// copy_file_range y por ultimo sendfile. Devuelve false si ninguno sirve (otro
+// sistema de archivos, kernel antiguo, no es Linux...) y la copia debe hacerse
+// por el camino con buffers; 'destino' puede haber quedado creado y vacio.
+inline bool copiarArchivoEnNucleo(const std::string& origen, const std::string& destino, MetodoCopia& metodo) {
+#if defined(__linux__)
+    int fd_origen = ::open(origen.c_str(), O_RDONLY);
+    if (fd_origen < 0) {
+        return false;
+    }
+    struct stat st;
+    int fd_destino = ::fstat(fd_origen, &st) == 0 ? ::open(destino.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (fd_destino < 0) {
+        ::close(fd_origen);
+        return false;
+    }
+    const size_t tam = static_cast<size_t>(st.st_size);
+
+    bool copiado = false;
+    if (::ioctl(fd_destino, FICLONE, fd_origen) == 0) {
+        metodo = MetodoCopia::Reflink;
+        copiado = true;
+    }
+    if (!copiado) {
+        // Con offsets explicitos: un intento fallido no mueve las posiciones
+        loff_t off_origen = 0;
+        loff_t off_destino = 0;
+        while (static_cast<size_t>(off_origen) < tam) {
+            ssize_t r = ::copy_file_range(fd_origen, &off_origen, fd_destino, &off_destino, tam - static_cast<size_t>(off_origen), 0);
+            if (r <= 0) {
+                break;
+            }
+        }
+        if (static_cast<size_t>(off_origen) == tam) {
+            metodo = MetodoCopia::CopyFileRange;
+            copiado = true;
+        }
+    }
+    if (!copiado && ::ftruncate(fd_destino, 0) == 0 && ::lseek(fd_destino, 0, SEEK_SET) == 0) {
+        off_t offset = 0;
+        while (static_cast<size_t>(offset) < tam) {
+            ssize_t r = ::sendfile(fd_destino, fd_origen, &offset, tam - static_cast<size_t>(offset));
+            if (r <= 0) {
+                break;
+            }
+        }
+        if (static_cast<size_t>(offset) == tam) {
+            metodo = MetodoCopia::Sendfile;
+            copiado = true;
+        }
+    }
+    ::close(fd_origen);
+    if (::close(fd_destino) != 0) {
+        copiado = false;
+    }
+    return copiado;
+#else
+    (void)origen; (void)destino; (void)metodo;
+    return false;
+#endif
+}
+
+#if SO_TIENE_MMAP
+
+// Archivo completo mapeado en memoria. Se libera (munmap + close) al destruirse.
+// Un archivo vacio queda abierto pero sin mapear: datos() es nullptr y tam() 0.
+class ArchivoMapeado {
+public:
+    ArchivoMapeado() = default;
+    ~ArchivoMapeado() { cerrar(); }
+
+    ArchivoMapeado(const ArchivoMapeado&) = delete;
+    ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+
+    // Mapea 'ruta' en solo lectura con aviso de acceso secuencial
+    bool abrirLectura(const std::string& ruta) {
+        cerrar();
+        fd = ::open(ruta.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            cerrar();
+            return false;
+        }
+        return mapear(static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE);
+    }
+
+    // Crea (o trunca) 'ruta' con el tamaño final y la mapea en lectura/escritura;
+    // lo escrito en datos() llega al archivo sin pasar por buffers intermedios
+    bool crearEscritura(const std::string& ruta, size_t tam_archivo) {
+        cerrar();
+        fd = ::open(ruta.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        if (::ftruncate(fd, static_cast<off_t>(tam_archivo)) != 0) {
+            cerrar();
+            return false;
+        }
+        return mapear(tam_archivo, PROT_READ | PROT_WRITE, MAP_SHARED);
+    }
+
+    void cerrar() {
+        if (mapa != nullptr) {
+            ::munmap(mapa, tam_mapa);
+            mapa = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        tam_mapa = 0;
+    }
+
+    char* datos() { return static_cast<char*>(mapa); }
+    const char* datos() const { return static_cast<const char*>(mapa); }
+    size_t tam() const { return tam_mapa; }
+
+private:
+    bool mapear(size_t tam_archivo, int proteccion, int flags) {
+        tam_mapa = tam_archivo;
+        if (tam_archivo == 0) {
+            return true; // mmap no admite longitud cero
+        }
+        void* p = ::mmap(nullptr, tam_archivo, proteccion, flags, fd, 0);
+        if (p == MAP_FAILED) {
+            cerrar();
+            return false;
+        }
+        mapa = p;
+        ::madvise(mapa, tam_mapa, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    int fd = -1;
+    void* mapa = nullptr;
+    size_t tam_mapa = 0;
+};
+
+// Descriptor con lecturas y escrituras posicionales (pread/pwrite): varios
+// threads pueden trabajar a la vez sobre rangos distintos del mismo archivo
+// sin compartir un puntero de posicion.
+class ArchivoPosicional {
+public:
+    ArchivoPosicional() = default;
+    ~ArchivoPosicional() { cerrar(); }
+
+    ArchivoPosicional(const ArchivoPosicional&) = delete;
+    ArchivoPosicional& operator=(const ArchivoPosicional&) = delete;
+
+    bool abrirLectura(const std::string& ruta) {
+        cerrar();
+        fd = ::open(ruta.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            cerrar();
+            return false;
+        }
+        tam_archivo = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    // Crea (o trunca) 'ruta' ya con su tamaño final, para escribir rangos en cualquier orden
+    bool crearEscritura(const std::string& ruta, size_t tam) {
+        cerrar();
+        fd = ::open(ruta.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(tam)) != 0) {
+            cerrar();
+            return false;
+        }
+        tam_archivo = tam;
+        return true;
+    }
+
+    // Abre 'ruta' para escribir sin truncarla (la crea si no existe) y la deja
+    // con 'tam' bytes; lo ya escrito antes de 'tam' se conserva
+    bool abrirEscrituraExistente(const std::string& ruta, size_t tam) {
+        cerrar();
+        fd = ::open(ruta.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(tam)) != 0) {
+            cerrar();
+            return false;
+        }
+        tam_archivo = tam;
+        return true;
+    }
+
+    // Lleva a disco los datos escritos hasta ahora
+    bool sincronizar() const {
+#if defined(__APPLE__)
+        return ::fsync(fd) == 0;
+#else
+        return ::fdatasync(fd) == 0;
+#endif
+    }
+
+    // Lee exactamente 'n' bytes desde 'offset' (reintenta lecturas parciales)
+    bool leerEn(char* destino, size_t n, size_t offset) const {
+        while (n > 0) {
+            ssize_t r = ::pread(fd, destino, n, static_cast<off_t>(offset));
+            if (r <= 0) {
+                return false;
+            }
+            destino += r;
+            offset += static_cast<size_t>(r);
+            n -= static_cast<size_t>(r);
+        }
+        return true;
+    }
+
+    bool escribirEn(const char* origen, size_t n, size_t offset) const {
+        while (n > 0) {
+            ssize_t r = ::pwrite(fd, origen, n, static_cast<off_t>(offset));
+            if (r <= 0) {
+                return false;
+            }
+            origen += r;
+            offset += static_cast<size_t>(r);
+            n -= static_cast<size_t>(r);
+        }
+        return true;
+    }
+
+    void cerrar() {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        tam_archivo = 0;
+    }
+
+    size_t tam() const { return tam_archivo; }
+
+private:
+    int fd = -1;
+    size_t tam_archivo = 0;
+};
+
+#endif // SO_TIENE_MMAP
+
+#endif // ENTRADA_SALIDA_H
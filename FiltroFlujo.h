@@ -0,0 +1,253 @@
+#ifndef FILTRO_FLUJO_H
+#define FILTRO_FLUJO_H
+
+// Filtro de flujo (p. ej. entrada estandar -> salida estandar) en tres etapas
+// que se solapan: un thread lee, el thread que llama procesa (cifrado, hash) y
+// otro thread escribe. Estan unidos por un anillo de buffers reutilizables que
+// pasan de "libres" a "leidos" a "procesados" y vuelven a "libres", asi que la
+// memoria es fija (num_buffers * tam_buffer) sea cual sea la longitud del flujo.
+
+#include <cerrno>
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Cola de indices de buffer entre dos etapas del filtro
+class ColaIndices {
+public:
+    static constexpr size_t FIN = std::numeric_limits<size_t>::max();   // Fin del flujo o abandono
+
+    void poner(size_t indice) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            indices.push_back(indice);
+        }
+        cv.notify_one();
+    }
+
+    size_t sacar() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]() { return !indices.empty(); });
+        size_t indice = indices.front();
+        indices.pop_front();
+        return indice;
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<size_t> indices;
+};
+
+// Entrada y salida estandar en modo binario (en Windows convertirian los saltos de linea)
+inline void prepararFlujosBinarios() {
+#if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
+
+// Una lectura del descriptor: bytes leidos, 0 al final del flujo o -1 si hay error
+inline long long leerDescriptor(int fd, char* destino, size_t n) {
+#if defined(_WIN32)
+    return _read(fd, destino, static_cast<unsigned int>(n));
+#else
+    while (true) {
+        ssize_t r = ::read(fd, destino, n);
+        if (r >= 0 || errno != EINTR) {
+            return r;
+        }
+    }
+#endif
+}
+
+// Escribe los n bytes completos (reintenta escrituras parciales)
+inline bool escribirDescriptor(int fd, const char* origen, size_t n) {
+    while (n > 0) {
+#if defined(_WIN32)
+        int r = _write(fd, origen, static_cast<unsigned int>(n));
+#else
+        ssize_t r = ::write(fd, origen, n);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (r <= 0) {
+            return false;
+        }
+        origen += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Copia fd_entrada en fd_salida pasando cada bloque por 'procesar' (en el
+// lugar). Cada bloque es lo que devuelve una lectura, asi que un flujo lento
+// no espera a llenar el buffer. Devuelve false y describe el fallo en 'error'.
+inline bool filtrarFlujo(int fd_entrada, int fd_salida, const std::function<void(char*, size_t)>& procesar,
+                         uint64_t& bytes, std::string& error, size_t num_buffers = 4, size_t tam_buffer = 1024 * 1024) {
+    bytes = 0;
+    error.clear();
+    if (num_buffers < 2) {
+        num_buffers = 2;
+    }
+    std::vector<std::vector<char>> buffers(num_buffers, std::vector<char>(tam_buffer));
+    std::vector<size_t> longitudes(num_buffers, 0);
+    ColaIndices libres;
+    ColaIndices leidos;
+    ColaIndices procesados;
+    for (size_t b = 0; b < num_buffers; ++b) {
+        libres.poner(b);
+    }
+
+    std::string error_lectura;
+    std::thread lector([&]() {
+        while (true) {
+            size_t b = libres.sacar();
+            if (b == ColaIndices::FIN) {
+                break;      // El escritor abandono
+            }
+            long long n = leerDescriptor(fd_entrada, buffers[b].data(), tam_buffer);
+            if (n <= 0) {
+                if (n < 0) {
+                    error_lectura = std::string("fallo la lectura de la entrada: ") + std::strerror(errno);
+                }
+                break;
+            }
+            longitudes[b] = static_cast<size_t>(n);
+            leidos.poner(b);
+        }
+        leidos.poner(ColaIndices::FIN);
+    });
+
+    std::string error_escritura;
+    std::thread escritor([&]() {
+        while (true) {
+            size_t b = procesados.sacar();
+            if (b == ColaIndices::FIN) {
+                break;
+            }
+            if (!escribirDescriptor(fd_salida, buffers[b].data(), longitudes[b])) {
+                error_escritura = std::string("fallo la escritura de la salida: ") + std::strerror(errno);
+                libres.poner(ColaIndices::FIN);     // Que el lector deje de leer
+                // Se siguen sacando bloques hasta el FIN para no dejar al calculo a medias
+                while (procesados.sacar() != ColaIndices::FIN) {
+                }
+                break;
+            }
+            bytes += longitudes[b];
+            libres.poner(b);
+        }
+    });
+
+    // Etapa de calculo en el thread actual
+    while (true) {
+        size_t b = leidos.sacar();
+        if (b == ColaIndices::FIN) {
+            break;
+        }
+        procesar(buffers[b].data(), longitudes[b]);
+        procesados.poner(b);
+    }
+    procesados.poner(ColaIndices::FIN);
+
+    escritor.join();
+    lector.join();
+    error = !error_lectura.empty() ? error_lectura : error_escritura;
+    return error.empty();
+}
+
+// Pasa datos pseudoaleatorios por dos pipes y el filtro (con buffers pequeños
+// para que el anillo dé la vuelta muchas veces) y compara con la referencia
+inline bool verificarFiltroFlujo(std::string& detalle) {
+#if defined(_WIN32)
+    (void)detalle;
+    return true;
+#else
+    int entrada[2];
+    int salida[2];
+    if (::pipe(entrada) != 0) {
+        detalle = "no se pudo crear el pipe";
+        return false;
+    }
+    if (::pipe(salida) != 0) {
+        ::close(entrada[0]);
+        ::close(entrada[1]);
+        detalle = "no se pudo crear el pipe";
+        return false;
+    }
+    std::vector<char> datos(300 * 1000 + 7);
+    uint32_t estado = 12345;
+    for (char& c : datos) {
+        estado = estado * 1103515245u + 12345u;
+        c = static_cast<char>(estado >> 24);
+    }
+    // Escritor con trozos de longitud variable, como un productor real
+    std::thread productor([&]() {
+        size_t pos = 0;
+        size_t trozo = 1;
+        while (pos < datos.size()) {
+            size_t n = std::min(trozo, datos.size() - pos);
+            if (!escribirDescriptor(entrada[1], datos.data() + pos, n)) {
+                break;
+            }
+            pos += n;
+            trozo = trozo * 3 % 9973 + 1;
+        }
+        ::close(entrada[1]);
+    });
+    std::vector<char> recibidos;
+    std::thread consumidor([&]() {
+        char buffer[4096];
+        long long n;
+        while ((n = leerDescriptor(salida[0], buffer, sizeof(buffer))) > 0) {
+            recibidos.insert(recibidos.end(), buffer, buffer + n);
+        }
+        ::close(salida[0]);
+    });
+
+    uint64_t bytes = 0;
+    bool ok = filtrarFlujo(entrada[0], salida[1], [](char* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            p[i] = static_cast<char>(p[i] ^ 0x5A);
+        }
+    }, bytes, detalle, 3, 4096);
+    ::close(entrada[0]);
+    ::close(salida[1]);
+    productor.join();
+    consumidor.join();
+    if (!ok) {
+        return false;
+    }
+    if (bytes != datos.size() || recibidos.size() != datos.size()) {
+        detalle = "longitud de salida incorrecta";
+        return false;
+    }
+    for (size_t i = 0; i < datos.size(); ++i) {
+        if (recibidos[i] != static_cast<char>(datos[i] ^ 0x5A)) {
+            detalle = "byte " + std::to_string(i) + " distinto";
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+#endif // FILTRO_FLUJO_H
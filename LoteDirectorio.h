@@ -0,0 +1,188 @@
+#ifndef LOTE_DIRECTORIO_H
+#define LOTE_DIRECTORIO_H
+
+// Modo por directorios: se recorren uno o varios arboles de entrada y cada
+// archivo regular se cifra en el directorio de salida, con la misma ruta
+// relativa (ruta.enc y ruta.sha). Los archivos se reparten de mayor a menor
+// (LPT, "longest processing time first"): cada thread libre toma el archivo
+// pendiente mas grande, asi un archivo enorme nunca queda para el final
+// alargando el lote mientras los demas threads ya no tienen trabajo.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+struct ArchivoLote {
+    std::filesystem::path entrada;
+    std::filesystem::path relativa;     // Ruta dentro del directorio de salida (sin extension añadida)
+    uint64_t tam = 0;
+};
+
+// true si 'ruta' esta dentro de 'directorio' (ambas ya normalizadas)
+inline bool estaDentroDe(const std::filesystem::path& ruta, const std::filesystem::path& directorio) {
+    auto r = ruta.begin();
+    for (auto d = directorio.begin(); d != directorio.end(); ++d, ++r) {
+        if (r == ruta.end() || *r != *d) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ruta absoluta y normalizada, sin separador final ("a/data/" y "a/data/."
+// acaban en "data"), exista o no todavia
+inline std::filesystem::path normalizarRutaLote(const std::string& ruta, std::error_code& ec) {
+    namespace fs = std::filesystem;
+    fs::path normalizada = fs::weakly_canonical(fs::absolute(ruta, ec), ec).lexically_normal();
+    if (!normalizada.has_filename() && normalizada.has_relative_path()) {
+        normalizada = normalizada.parent_path();
+    }
+    return normalizada;
+}
+
+// Lista los archivos regulares de los directorios de entrada. Con varias
+// raices, cada una conserva su nombre como primer componente de la ruta
+// relativa; si dos raices darian el mismo nombre (a/data y b/data) o una no
+// tiene nombre ("/"), se rechaza el lote en lugar de mezclar sus salidas. Se
+// omite el directorio de salida si esta dentro de una entrada (no se vuelven
+// a cifrar los resultados).
+inline bool recorrerDirectorios(const std::vector<std::string>& raices, const std::string& salida,
+                                std::vector<ArchivoLote>& archivos, std::string& error) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path salida_absoluta = normalizarRutaLote(salida, ec);
+    std::vector<std::pair<fs::path, std::string>> prefijos;
+    for (const std::string& raiz_texto : raices) {
+        fs::path raiz = normalizarRutaLote(raiz_texto, ec);
+        if (ec || !fs::is_directory(raiz, ec)) {
+            error = "no es un directorio: " + raiz_texto;
+            return false;
+        }
+        if (estaDentroDe(raiz, salida_absoluta)) {
+            error = "el directorio de salida no puede ser ni contener la entrada " + raiz_texto;
+            return false;
+        }
+        fs::path prefijo;
+        if (raices.size() > 1) {
+            prefijo = raiz.filename();
+            if (prefijo.empty()) {
+                error = "con varias entradas cada una necesita un nombre propio: " + raiz_texto;
+                return false;
+            }
+            for (const auto& anterior : prefijos) {
+                if (anterior.first == prefijo) {
+                    error = "las entradas " + anterior.second + " y " + raiz_texto + " se guardarian en el mismo directorio '" +
+                            prefijo.string() + "' de la salida";
+                    return false;
+                }
+            }
+            prefijos.emplace_back(prefijo, raiz_texto);
+        }
+        fs::recursive_directory_iterator it(raiz, fs::directory_options::skip_permission_denied, ec);
+        if (ec) {
+            error = "no se pudo recorrer " + raiz_texto + ": " + ec.message();
+            return false;
+        }
+        for (; it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (ec) {
+                error = "error recorriendo " + raiz_texto + ": " + ec.message();
+                return false;
+            }
+            if (estaDentroDe(it->path(), salida_absoluta)) {
+                if (it->is_directory(ec)) {
+                    it.disable_recursion_pending();
+                }
+                continue;
+            }
+            if (!it->is_regular_file(ec)) {
+                continue;
+            }
+            ArchivoLote archivo;
+            archivo.entrada = it->path();
+            archivo.relativa = prefijo / it->path().lexically_relative(raiz);
+            archivo.tam = it->file_size(ec);
+            if (ec) {
+                archivo.tam = 0;
+                ec.clear();
+            }
+            archivos.push_back(archivo);
+        }
+    }
+    return true;
+}
+
+// Orden LPT: de mayor a menor tamaño (a igual tamaño, por ruta para que el
+// orden sea reproducible)
+inline void ordenarMayorPrimero(std::vector<ArchivoLote>& archivos) {
+    std::sort(archivos.begin(), archivos.end(), [](const ArchivoLote& a, const ArchivoLote& b) {
+        return a.tam != b.tam ? a.tam > b.tam : a.relativa < b.relativa;
+    });
+}
+
+// Progreso del lote, compartido por los threads. Se imprime como mucho una
+// vez por intervalo para no convertir la consola en el cuello de botella.
+class ProgresoLote {
+public:
+    ProgresoLote(size_t total_archivos, uint64_t total_bytes, std::chrono::milliseconds intervalo = std::chrono::milliseconds(1000))
+        : total_archivos(total_archivos), total_bytes(total_bytes), intervalo(intervalo),
+          inicio(std::chrono::steady_clock::now()), ultimo_informe(inicio) {}
+
+    void archivoTerminado(uint64_t bytes, bool con_error) {
+        archivos_hechos.fetch_add(1, std::memory_order_relaxed);
+        bytes_hechos.fetch_add(bytes, std::memory_order_relaxed);
+        if (con_error) {
+            errores.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto ahora = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mtx);
+        if (ahora - ultimo_informe >= intervalo) {
+            ultimo_informe = ahora;
+            informar(std::cout, ahora);
+        }
+    }
+
+    // Linea de progreso: archivos, porcentaje de bytes y MB/s desde el inicio
+    void informar(std::ostream& os, std::chrono::steady_clock::time_point ahora) const {
+        double segundos = std::chrono::duration<double>(ahora - inicio).count();
+        uint64_t bytes = bytes_hechos.load();
+        std::ios::fmtflags flags = os.flags();
+        os << std::setfill(' ') << "[" << std::setw(static_cast<int>(std::to_string(total_archivos).size())) << archivos_hechos.load()
+           << "/" << total_archivos << "] " << std::fixed << std::setprecision(1)
+           << (total_bytes > 0 ? 100.0 * static_cast<double>(bytes) / static_cast<double>(total_bytes) : 100.0) << " %  "
+           << (segundos > 0 ? static_cast<double>(bytes) / 1e6 / segundos : 0.0) << " MB/s";
+        if (errores.load() > 0) {
+            os << "  (" << errores.load() << " con errores)";
+        }
+        os << std::endl;
+        os.flags(flags);
+    }
+
+    size_t archivosHechos() const { return archivos_hechos.load(); }
+    uint64_t bytesHechos() const { return bytes_hechos.load(); }
+    size_t numErrores() const { return errores.load(); }
+    double segundos() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count(); }
+
+private:
+    const size_t total_archivos;
+    const uint64_t total_bytes;
+    const std::chrono::milliseconds intervalo;
+    const std::chrono::steady_clock::time_point inicio;
+
+    std::atomic<size_t> archivos_hechos{0};
+    std::atomic<uint64_t> bytes_hechos{0};
+    std::atomic<size_t> errores{0};
+
+    std::mutex mtx;                                     // Protege 'ultimo_informe' y la impresion
+    std::chrono::steady_clock::time_point ultimo_informe;
+};
+
+#endif // LOTE_DIRECTORIO_H
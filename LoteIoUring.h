@@ -0,0 +1,408 @@
+#ifndef LOTE_IO_URING_H
+#define LOTE_IO_URING_H
+
+// Backend io_uring para las etapas de copia y cifrado de un lote de archivos.
+// Un unico thread mantiene muchas lecturas y escrituras en vuelo a la vez,
+// de todos los archivos del lote, sobre un conjunto fijo de buffers
+// registrados en el kernel. Cada buffer recorre su bloque por etapas:
+//
+//   leer bloque -> [transformar -> escribir en la salida k] para cada salida
+//
+// Por ejemplo, copia + cifrado: leer del original, escribir tal cual en la
+// copia, cifrar en el lugar y escribir en el .enc. Cuando el buffer termina
+// su ultima escritura se reutiliza para el siguiente bloque pendiente.
+//
+// Se usan las llamadas al sistema directamente (sin liburing).
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EntradaSalida.h"
+#include "PoolBuffers.h"
+
+// Transformacion en el lugar de un bloque antes de escribirlo (nullptr = copia);
+// 'posicion' es el byte del archivo en el que empieza el bloque
+typedef void (*TransformacionBloque)(char* buffer, size_t size, uint64_t posicion);
+
+struct SalidaLote {
+    std::string ruta;
+    TransformacionBloque transformar = nullptr;
+};
+
+struct TrabajoLote {
+    std::string entrada;
+    std::vector<SalidaLote> salidas;
+};
+
+#if SO_TIENE_IO_URING
+
+#include <sys/uio.h>
+
+// Anillo io_uring minimo: cola de envio, cola de completados y buffers fijos
+class AnilloIoUring {
+public:
+    AnilloIoUring() = default;
+    ~AnilloIoUring() { cerrar(); }
+
+    AnilloIoUring(const AnilloIoUring&) = delete;
+    AnilloIoUring& operator=(const AnilloIoUring&) = delete;
+
+    bool iniciar(unsigned int entradas) {
+        struct io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entradas, &params));
+        if (fd < 0) {
+            return false;
+        }
+
+        tam_sq = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        tam_cq = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool un_solo_mapa = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (un_solo_mapa) {
+            tam_sq = tam_cq = std::max(tam_sq, tam_cq);
+        }
+
+        mapa_sq = ::mmap(nullptr, tam_sq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (mapa_sq == MAP_FAILED) {
+            mapa_sq = nullptr;
+            cerrar();
+            return false;
+        }
+        if (un_solo_mapa) {
+            mapa_cq = mapa_sq;
+        } else {
+            mapa_cq = ::mmap(nullptr, tam_cq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (mapa_cq == MAP_FAILED) {
+                mapa_cq = nullptr;
+                cerrar();
+                return false;
+            }
+        }
+        tam_sqes = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* p = ::mmap(nullptr, tam_sqes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (p == MAP_FAILED) {
+            cerrar();
+            return false;
+        }
+        sqes = static_cast<struct io_uring_sqe*>(p);
+
+        char* sq = static_cast<char*>(mapa_sq);
+        sq_cola = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+        sq_mascara = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+        sq_indices = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(mapa_cq);
+        cq_cabeza = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+        cq_cola = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+        cq_mascara = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Registra los buffers para usar lecturas/escrituras *_FIXED (sin mapear
+    // las paginas en cada operacion). Puede fallar por el limite de memoria
+    // bloqueada; en ese caso se usan las operaciones normales.
+    bool registrarBuffers(const std::vector<struct iovec>& buffers) {
+        fijos = ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+                          buffers.data(), static_cast<unsigned int>(buffers.size())) == 0;
+        return fijos;
+    }
+
+    bool buffersRegistrados() const { return fijos; }
+
+    // Encola una lectura o escritura de 'len' bytes en 'offset'; 'etiqueta' vuelve en el completado
+    void preparar(bool escritura, int fd_archivo, char* buffer, unsigned int indice_buffer,
+                  size_t len, uint64_t offset, uint64_t etiqueta) {
+        unsigned int cola = *sq_cola;
+        unsigned int indice = cola & sq_mascara;
+        struct io_uring_sqe* sqe = &sqes[indice];
+        std::memset(sqe, 0, sizeof(*sqe));
+        if (fijos) {
+            sqe->opcode = escritura ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = static_cast<uint16_t>(indice_buffer);
+        } else {
+            sqe->opcode = escritura ? IORING_OP_WRITE : IORING_OP_READ;
+        }
+        sqe->fd = fd_archivo;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = static_cast<uint32_t>(len);
+        sqe->off = offset;
+        sqe->user_data = etiqueta;
+        sq_indices[indice] = indice;
+        // La entrada debe ser visible para el kernel antes que la nueva cola
+        __atomic_store_n(sq_cola, cola + 1, __ATOMIC_RELEASE);
+        por_enviar++;
+    }
+
+    // Envia lo encolado y espera al menos 'minimo' completados
+    bool enviar(unsigned int minimo) {
+        while (true) {
+            long r = ::syscall(__NR_io_uring_enter, fd, por_enviar, minimo,
+                               minimo > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (r >= 0) {
+                por_enviar -= static_cast<unsigned int>(r);
+                return true;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return false;
+            }
+        }
+    }
+
+    // Recorre los completados disponibles: al_completar(etiqueta, resultado)
+    template <class F>
+    unsigned int cosechar(F&& al_completar) {
+        unsigned int cabeza = *cq_cabeza;
+        unsigned int cola = __atomic_load_n(cq_cola, __ATOMIC_ACQUIRE);
+        unsigned int n = 0;
+        while (cabeza != cola) {
+            const struct io_uring_cqe& cqe = cqes[cabeza & cq_mascara];
+            uint64_t etiqueta = cqe.user_data;
+            int resultado = cqe.res;
+            cabeza++;
+            n++;
+            __atomic_store_n(cq_cabeza, cabeza, __ATOMIC_RELEASE);
+            al_completar(etiqueta, resultado);
+        }
+        return n;
+    }
+
+    void cerrar() {
+        if (sqes != nullptr) {
+            ::munmap(sqes, tam_sqes);
+            sqes = nullptr;
+        }
+        if (mapa_cq != nullptr && mapa_cq != mapa_sq) {
+            ::munmap(mapa_cq, tam_cq);
+        }
+        mapa_cq = nullptr;
+        if (mapa_sq != nullptr) {
+            ::munmap(mapa_sq, tam_sq);
+            mapa_sq = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        fijos = false;
+    }
+
+private:
+    int fd = -1;
+    bool fijos = false;
+    unsigned int por_enviar = 0;
+
+    void* mapa_sq = nullptr;
+    void* mapa_cq = nullptr;
+    size_t tam_sq = 0;
+    size_t tam_cq = 0;
+    size_t tam_sqes = 0;
+
+    struct io_uring_sqe* sqes = nullptr;
+    unsigned int* sq_cola = nullptr;
+    unsigned int sq_mascara = 0;
+    unsigned int* sq_indices = nullptr;
+    unsigned int* cq_cabeza = nullptr;
+    unsigned int* cq_cola = nullptr;
+    unsigned int cq_mascara = 0;
+    struct io_uring_cqe* cqes = nullptr;
+};
+
+// Ejecuta todos los trabajos del lote con 'profundidad' bloques de 'tam_bloque'
+// bytes en vuelo. Devuelve false y describe el primer fallo en 'error'.
+inline bool ejecutarLoteIoUring(const std::vector<TrabajoLote>& trabajos, std::string& error,
+                                unsigned int profundidad = 64, size_t tam_bloque = 256 * 1024) {
+    error.clear();
+    AnilloIoUring anillo;
+    if (!anillo.iniciar(profundidad)) {
+        error = std::string("no se pudo crear el anillo io_uring: ") + std::strerror(errno);
+        return false;
+    }
+
+    // Un solo bloque de memoria alineado para todos los buffers, prestado por
+    // el pool para que los lotes siguientes del mismo thread lo reutilicen
+    BufferPrestado memoria(profundidad * tam_bloque);
+    char* base = memoria.data();
+    std::vector<struct iovec> iovecs(profundidad);
+    for (unsigned int b = 0; b < profundidad; ++b) {
+        iovecs[b].iov_base = base + b * tam_bloque;
+        iovecs[b].iov_len = tam_bloque;
+    }
+    anillo.registrarBuffers(iovecs);
+
+    struct ArchivoEnCurso {
+        int fd_entrada = -1;
+        std::vector<int> fd_salidas;
+        uint64_t tam = 0;
+        uint64_t siguiente = 0;     // Offset del proximo bloque por leer
+        unsigned int en_vuelo = 0;  // Bloques de este archivo aun en algun buffer
+    };
+    struct Bloque {
+        size_t archivo = 0;
+        uint64_t offset = 0;
+        size_t len = 0;
+        size_t hecho = 0;           // Bytes completados de la operacion actual
+        size_t etapa = 0;           // 0 = lectura, k = escritura en la salida k-1
+    };
+
+    std::vector<ArchivoEnCurso> archivos(trabajos.size());
+    std::vector<Bloque> bloques(profundidad);
+    size_t siguiente_archivo = 0;
+    size_t actual = trabajos.size();    // Archivo del que se estan leyendo bloques
+    unsigned int activos = 0;
+
+    auto fallar = [&error](const std::string& mensaje) {
+        if (error.empty()) {
+            error = mensaje;
+        }
+    };
+    auto cerrarArchivo = [&archivos](size_t a) {
+        ArchivoEnCurso& archivo = archivos[a];
+        if (archivo.fd_entrada >= 0) {
+            ::close(archivo.fd_entrada);
+            archivo.fd_entrada = -1;
+        }
+        for (int& fd : archivo.fd_salidas) {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    };
+    // Abre la entrada y crea las salidas ya con su tamaño final
+    auto abrirArchivo = [&](size_t a) -> bool {
+        const TrabajoLote& trabajo = trabajos[a];
+        ArchivoEnCurso& archivo = archivos[a];
+        archivo.fd_entrada = ::open(trabajo.entrada.c_str(), O_RDONLY);
+        struct stat st;
+        if (archivo.fd_entrada < 0 || ::fstat(archivo.fd_entrada, &st) != 0) {
+            fallar("no se pudo abrir " + trabajo.entrada);
+            cerrarArchivo(a);
+            return false;
+        }
+        archivo.tam = static_cast<uint64_t>(st.st_size);
+        for (const SalidaLote& salida : trabajo.salidas) {
+            int fd_salida = ::open(salida.ruta.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            archivo.fd_salidas.push_back(fd_salida);
+            if (fd_salida < 0 || ::ftruncate(fd_salida, static_cast<off_t>(archivo.tam)) != 0) {
+                fallar("no se pudo crear " + salida.ruta);
+                cerrarArchivo(a);
+                return false;
+            }
+        }
+        return true;
+    };
+    // Asigna al buffer b el siguiente bloque pendiente del lote
+    auto tomarBloque = [&](unsigned int b) -> bool {
+        while (actual == trabajos.size() || archivos[actual].siguiente >= archivos[actual].tam) {
+            if (actual != trabajos.size() && archivos[actual].en_vuelo == 0) {
+                cerrarArchivo(actual);
+            }
+            if (siguiente_archivo == trabajos.size()) {
+                return false;
+            }
+            actual = siguiente_archivo++;
+            if (!abrirArchivo(actual)) {
+                actual = trabajos.size();
+            }
+        }
+        ArchivoEnCurso& archivo = archivos[actual];
+        Bloque& bloque = bloques[b];
+        bloque.archivo = actual;
+        bloque.offset = archivo.siguiente;
+        bloque.len = static_cast<size_t>(std::min<uint64_t>(tam_bloque, archivo.tam - archivo.siguiente));
+        bloque.hecho = 0;
+        bloque.etapa = 0;
+        archivo.siguiente += bloque.len;
+        archivo.en_vuelo++;
+        return true;
+    };
+    auto prepararEtapa = [&](unsigned int b) {
+        Bloque& bloque = bloques[b];
+        ArchivoEnCurso& archivo = archivos[bloque.archivo];
+        bool escritura = bloque.etapa > 0;
+        int fd = escritura ? archivo.fd_salidas[bloque.etapa - 1] : archivo.fd_entrada;
+        anillo.preparar(escritura, fd, base + b * tam_bloque + bloque.hecho, b,
+                        bloque.len - bloque.hecho, bloque.offset + bloque.hecho, b);
+    };
+    auto arrancar = [&](unsigned int b) {
+        if (tomarBloque(b)) {
+            prepararEtapa(b);
+            activos++;
+        }
+    };
+
+    for (unsigned int b = 0; b < profundidad; ++b) {
+        arrancar(b);
+    }
+
+    while (activos > 0) {
+        if (!anillo.enviar(1)) {
+            fallar(std::string("io_uring_enter fallo: ") + std::strerror(errno));
+            break;
+        }
+        anillo.cosechar([&](uint64_t etiqueta, int resultado) {
+            unsigned int b = static_cast<unsigned int>(etiqueta);
+            Bloque& bloque = bloques[b];
+            ArchivoEnCurso& archivo = archivos[bloque.archivo];
+            const TrabajoLote& trabajo = trabajos[bloque.archivo];
+
+            bool completo = false;
+            if (resultado <= 0) {
+                // Error o fin de archivo inesperado: el bloque se abandona
+                const std::string& ruta = bloque.etapa == 0 ? trabajo.entrada : trabajo.salidas[bloque.etapa - 1].ruta;
+                fallar("fallo de E/S en " + ruta + ": " + (resultado < 0 ? std::strerror(-resultado) : "fin de archivo inesperado"));
+                completo = true;
+            } else {
+                bloque.hecho += static_cast<size_t>(resultado);
+                if (bloque.hecho < bloque.len) {
+                    prepararEtapa(b);   // Operacion parcial: reenviar el resto
+                    return;
+                }
+                bloque.hecho = 0;
+                bloque.etapa++;
+                if (bloque.etapa <= trabajo.salidas.size()) {
+                    TransformacionBloque transformar = trabajo.salidas[bloque.etapa - 1].transformar;
+                    if (transformar != nullptr) {
+                        transformar(base + b * tam_bloque, bloque.len, bloque.offset);
+                    }
+                    prepararEtapa(b);
+                    return;
+                }
+                completo = true;
+            }
+
+            if (completo) {
+                archivo.en_vuelo--;
+                if (archivo.en_vuelo == 0 && archivo.siguiente >= archivo.tam && bloque.archivo != actual) {
+                    cerrarArchivo(bloque.archivo);
+                }
+                activos--;
+                arrancar(b);
+            }
+        });
+    }
+
+    // Los que quedaron abiertos (el ultimo, o todos si el anillo fallo)
+    for (size_t a = 0; a < archivos.size(); ++a) {
+        cerrarArchivo(a);
+    }
+    return error.empty();
+}
+
+#else
+
+inline bool ejecutarLoteIoUring(const std::vector<TrabajoLote>&, std::string& error,
+                                unsigned int = 64, size_t = 256 * 1024) {
+    error = "io_uring no esta disponible en este sistema";
+    return false;
+}
+
+#endif // SO_TIENE_IO_URING
+
+#endif // LOTE_IO_URING_H
@@ -0,0 +1,426 @@
+#ifndef MANIFIESTO_MERKLE_H
+#define MANIFIESTO_MERKLE_H
+
+// Manifiesto de hash en arbol (Merkle): el archivo se divide en hojas de tamaño
+// fijo, cada hoja se hashea por separado y los hashes se combinan por pares
+// hasta una raiz. Las hojas son independientes, asi que se calculan y se
+// verifican en paralelo, y un fallo de verificacion señala el rango exacto
+// que no coincide en lugar de solo "el archivo es distinto".
+//
+// Formato binario del manifiesto (enteros en little-endian):
+//   0  "SOMK"          firma
+//   4  uint16          version (1)
+//   6  uint16          reservado (0)
+//   8  uint32          bytes por hoja
+//  12  uint32          reservado (0)
+//  16  uint64          tamaño del archivo
+//  24  uint64          numero de hojas
+//  32  uint8[32]       raiz
+//  64  uint8[32] * n   hashes de las hojas, en orden
+//
+// Hoja = SHA-256(0x00 || datos); nodo interno = SHA-256(0x01 || izq || der).
+// El prefijo separa ambos dominios; un nodo sin pareja sube sin cambios.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SHA256.h"
+#include "SHA256Lote.h"
+#include "EntradaSalida.h"
+#include "PoolHilos.h"
+
+// Fuente de SHA256Lote que antepone un byte de dominio a un tramo en memoria
+class FuentePrefijada : public FuenteLote {
+public:
+    FuentePrefijada(uint8_t prefijo, const uint8_t* datos, size_t len)
+        : prefijo(prefijo), datos(datos), len(len), paso(0) {}
+
+    bool siguiente(const uint8_t*& d, size_t& n) override {
+        if (paso == 0) {
+            paso = 1;
+            d = &prefijo;
+            n = 1;
+            return true;
+        }
+        if (paso == 1 && len > 0) {
+            paso = 2;
+            d = datos;
+            n = len;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    uint8_t prefijo;
+    const uint8_t* datos;
+    size_t len;
+    int paso;
+};
+
+class ManifiestoMerkle {
+public:
+    typedef std::array<uint8_t, SHA256::DIGEST_SIZE> Digest;
+
+    static const uint16_t VERSION = 1;
+    static const uint32_t TAM_HOJA_POR_DEFECTO = 1024 * 1024;
+    static const size_t TAM_CABECERA = 64;
+
+    uint32_t tam_hoja = TAM_HOJA_POR_DEFECTO;
+    uint64_t tam_archivo = 0;
+    std::vector<Digest> hojas;
+    Digest raiz{};
+
+    // Hashea las hojas de 'datos' (repartidas en el pool si se pasa uno) y calcula la raiz
+    static ManifiestoMerkle construir(const uint8_t* datos, size_t tam, uint32_t tam_hoja, PoolHilos* pool);
+
+    // Igual para un archivo. Devuelve false si no se pudo leer.
+    static bool construirArchivo(const std::string& ruta, uint32_t tam_hoja, PoolHilos* pool, ManifiestoMerkle& manifiesto);
+
+    // Indices de las hojas de 'datos' que no coinciden con el manifiesto (vacio = integro)
+    std::vector<uint64_t> hojasDistintas(const uint8_t* datos, size_t tam, PoolHilos* pool) const;
+
+    // Verifica un archivo contra el manifiesto y describe en 'detalle' los rangos que fallan
+    bool verificarArchivo(const std::string& ruta, PoolHilos* pool, std::string& detalle) const;
+
+    bool guardar(const std::string& ruta) const;
+    bool cargar(const std::string& ruta);
+
+    std::string raizHex() const { return SHA256::toHex(raiz.data()); }
+
+    // Numero de hojas de un archivo de 'tam' bytes (un archivo vacio tiene una hoja vacia)
+    static uint64_t numHojas(uint64_t tam, uint32_t tam_hoja) {
+        return tam == 0 ? 1 : (tam + tam_hoja - 1) / tam_hoja;
+    }
+
+    static Digest calcularRaiz(std::vector<Digest> nivel);
+
+private:
+    static std::vector<Digest> hashearHojas(const uint8_t* datos, size_t tam, uint32_t tam_hoja, PoolHilos* pool);
+};
+
+// Hojas por tarea del pool: suficientes para llenar los carriles del hash multi-buffer
+static const size_t HOJAS_POR_TAREA_MERKLE = 16;
+
+inline std::vector<ManifiestoMerkle::Digest> ManifiestoMerkle::hashearHojas(const uint8_t* datos, size_t tam, uint32_t tam_hoja, PoolHilos* pool) {
+    size_t n = static_cast<size_t>(numHojas(tam, tam_hoja));
+    std::vector<Digest> resultado(n);
+
+    // Hashea las hojas [primera, fin); con varias hojas del mismo tamaño el lote
+    // multi-buffer rinde mas que un flujo por hoja si la CPU no tiene SHA-NI
+    auto hashearGrupo = [&resultado, datos, tam, tam_hoja](size_t primera, size_t fin) {
+        auto rango = [&](size_t h, const uint8_t*& inicio, size_t& len) {
+            size_t offset = h * static_cast<size_t>(tam_hoja);
+            inicio = datos + offset;
+            len = std::min(static_cast<size_t>(tam_hoja), tam - offset);
+        };
+        if (fin - primera > 1 && SHA256Lote::superaFlujoSimple()) {
+            SHA256Lote().hashear(fin - primera,
+                [&](size_t i) {
+                    const uint8_t* inicio;
+                    size_t len;
+                    rango(primera + i, inicio, len);
+                    return std::unique_ptr<FuenteLote>(new FuentePrefijada(0x00, inicio, len));
+                },
+                [&](size_t i, const uint8_t* d) { std::memcpy(resultado[primera + i].data(), d, SHA256::DIGEST_SIZE); });
+            return;
+        }
+        const uint8_t prefijo = 0x00;
+        for (size_t h = primera; h < fin; ++h) {
+            const uint8_t* inicio;
+            size_t len;
+            rango(h, inicio, len);
+            SHA256 sha256;
+            sha256.update(&prefijo, 1);
+            sha256.update(inicio, len);
+            sha256.finalize(resultado[h].data());
+        }
+    };
+
+    if (pool == nullptr || n <= 1) {
+        hashearGrupo(0, n);
+        return resultado;
+    }
+    GrupoTareas grupo(*pool);
+    for (size_t primera = 0; primera < n; primera += HOJAS_POR_TAREA_MERKLE) {
+        size_t fin = std::min(n, primera + HOJAS_POR_TAREA_MERKLE);
+        grupo.lanzar([&hashearGrupo, primera, fin]() { hashearGrupo(primera, fin); });
+    }
+    grupo.esperar();
+    return resultado;
+}
+
+inline ManifiestoMerkle::Digest ManifiestoMerkle::calcularRaiz(std::vector<Digest> nivel) {
+    const uint8_t prefijo = 0x01;
+    while (nivel.size() > 1) {
+        std::vector<Digest> superior((nivel.size() + 1) / 2);
+        for (size_t i = 0; i + 1 < nivel.size(); i += 2) {
+            SHA256 sha256;
+            sha256.update(&prefijo, 1);
+            sha256.update(nivel[i].data(), SHA256::DIGEST_SIZE);
+            sha256.update(nivel[i + 1].data(), SHA256::DIGEST_SIZE);
+            sha256.finalize(superior[i / 2].data());
+        }
+        if (nivel.size() % 2 == 1) {
+            superior.back() = nivel.back();
+        }
+        nivel.swap(superior);
+    }
+    return nivel.empty() ? Digest{} : nivel[0];
+}
+
+inline ManifiestoMerkle ManifiestoMerkle::construir(const uint8_t* datos, size_t tam, uint32_t tam_hoja, PoolHilos* pool) {
+    ManifiestoMerkle manifiesto;
+    manifiesto.tam_hoja = tam_hoja;
+    manifiesto.tam_archivo = tam;
+    manifiesto.hojas = hashearHojas(datos, tam, tam_hoja, pool);
+    manifiesto.raiz = calcularRaiz(manifiesto.hojas);
+    return manifiesto;
+}
+
+// Contenido completo de un archivo accesible en memoria: mapeado donde se
+// puede, leido en un buffer en los demas sistemas
+class ContenidoArchivo {
+public:
+    bool abrir(const std::string& ruta) {
+#if SO_TIENE_MMAP
+        if (!mapa.abrirLectura(ruta)) {
+            return false;
+        }
+        inicio = reinterpret_cast<const uint8_t*>(mapa.datos());
+        len = mapa.tam();
+        return true;
+#else
+        std::ifstream archivo(ruta, std::ios::binary);
+        if (!archivo.is_open()) {
+            return false;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(archivo), std::istreambuf_iterator<char>());
+        inicio = reinterpret_cast<const uint8_t*>(buffer.data());
+        len = buffer.size();
+        return !archivo.bad();
+#endif
+    }
+
+    const uint8_t* datos() const { return inicio; }
+    size_t tam() const { return len; }
+
+private:
+#if SO_TIENE_MMAP
+    ArchivoMapeado mapa;
+#else
+    std::vector<char> buffer;
+#endif
+    const uint8_t* inicio = nullptr;
+    size_t len = 0;
+};
+
+inline bool ManifiestoMerkle::construirArchivo(const std::string& ruta, uint32_t tam_hoja, PoolHilos* pool, ManifiestoMerkle& manifiesto) {
+    ContenidoArchivo contenido;
+    if (!contenido.abrir(ruta)) {
+        return false;
+    }
+    manifiesto = construir(contenido.datos(), contenido.tam(), tam_hoja, pool);
+    return true;
+}
+
+inline std::vector<uint64_t> ManifiestoMerkle::hojasDistintas(const uint8_t* datos, size_t tam, PoolHilos* pool) const {
+    std::vector<uint64_t> distintas;
+    std::vector<Digest> calculadas = hashearHojas(datos, tam, tam_hoja, pool);
+    for (size_t h = 0; h < calculadas.size(); ++h) {
+        if (h >= hojas.size() || calculadas[h] != hojas[h]) {
+            distintas.push_back(h);
+        }
+    }
+    return distintas;
+}
+
+inline bool ManifiestoMerkle::verificarArchivo(const std::string& ruta, PoolHilos* pool, std::string& detalle) const {
+    ContenidoArchivo contenido;
+    if (!contenido.abrir(ruta)) {
+        detalle = "no se pudo leer " + ruta;
+        return false;
+    }
+    if (contenido.tam() != tam_archivo) {
+        detalle = "el tamaño es " + std::to_string(contenido.tam()) + " bytes y el manifiesto indica " +
+                  std::to_string(tam_archivo);
+        return false;
+    }
+    std::vector<uint64_t> distintas = hojasDistintas(contenido.datos(), contenido.tam(), pool);
+    if (distintas.empty()) {
+        return true;
+    }
+    detalle = std::to_string(distintas.size()) + " hoja(s) distinta(s):";
+    const size_t MAX_MOSTRADAS = 8;
+    for (size_t i = 0; i < distintas.size() && i < MAX_MOSTRADAS; ++i) {
+        uint64_t inicio = distintas[i] * tam_hoja;
+        uint64_t fin = std::min<uint64_t>(tam_archivo, inicio + tam_hoja);
+        detalle += " [" + std::to_string(inicio) + ", " + std::to_string(fin) + ")";
+    }
+    if (distintas.size() > MAX_MOSTRADAS) {
+        detalle += " ...";
+    }
+    return false;
+}
+
+static inline void escribirLE(std::vector<uint8_t>& salida, uint64_t valor, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        salida.push_back(static_cast<uint8_t>(valor >> (8 * i)));
+    }
+}
+
+static inline uint64_t leerLE(const uint8_t* p, int bytes) {
+    uint64_t valor = 0;
+    for (int i = 0; i < bytes; ++i) {
+        valor |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    return valor;
+}
+
+inline bool ManifiestoMerkle::guardar(const std::string& ruta) const {
+    std::vector<uint8_t> salida;
+    salida.reserve(TAM_CABECERA + hojas.size() * SHA256::DIGEST_SIZE);
+    salida.insert(salida.end(), {'S', 'O', 'M', 'K'});
+    escribirLE(salida, VERSION, 2);
+    escribirLE(salida, 0, 2);
+    escribirLE(salida, tam_hoja, 4);
+    escribirLE(salida, 0, 4);
+    escribirLE(salida, tam_archivo, 8);
+    escribirLE(salida, hojas.size(), 8);
+    salida.insert(salida.end(), raiz.begin(), raiz.end());
+    for (const Digest& hoja : hojas) {
+        salida.insert(salida.end(), hoja.begin(), hoja.end());
+    }
+
+    std::ofstream ofs(ruta, std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(salida.data()), static_cast<std::streamsize>(salida.size()));
+    return static_cast<bool>(ofs);
+}
+
+// Rechaza firmas o versiones desconocidas y manifiestos incoherentes
+inline bool ManifiestoMerkle::cargar(const std::string& ruta) {
+    std::ifstream ifs(ruta, std::ios::binary);
+    uint8_t cabecera[TAM_CABECERA];
+    if (!ifs.read(reinterpret_cast<char*>(cabecera), TAM_CABECERA)) {
+        return false;
+    }
+    if (std::memcmp(cabecera, "SOMK", 4) != 0 || leerLE(cabecera + 4, 2) != VERSION) {
+        return false;
+    }
+    uint32_t hoja = static_cast<uint32_t>(leerLE(cabecera + 8, 4));
+    uint64_t tam = leerLE(cabecera + 16, 8);
+    uint64_t n = leerLE(cabecera + 24, 8);
+    if (hoja == 0 || n != numHojas(tam, hoja)) {
+        return false;
+    }
+    // El resto del archivo debe ser exactamente n hashes: una cabecera
+    // corrupta no puede pedir una reserva mayor que el propio manifiesto
+    const std::streamoff inicio_hojas = ifs.tellg();
+    ifs.seekg(0, std::ios::end);
+    const std::streamoff fin = ifs.tellg();
+    ifs.seekg(inicio_hojas);
+    if (inicio_hojas < 0 || fin < inicio_hojas || !ifs ||
+        n != static_cast<uint64_t>(fin - inicio_hojas) / SHA256::DIGEST_SIZE ||
+        static_cast<uint64_t>(fin - inicio_hojas) % SHA256::DIGEST_SIZE != 0) {
+        return false;
+    }
+    std::vector<Digest> leidas(static_cast<size_t>(n));
+    for (Digest& d : leidas) {
+        if (!ifs.read(reinterpret_cast<char*>(d.data()), SHA256::DIGEST_SIZE)) {
+            return false;
+        }
+    }
+    Digest raiz_leida;
+    std::memcpy(raiz_leida.data(), cabecera + 32, SHA256::DIGEST_SIZE);
+    if (calcularRaiz(leidas) != raiz_leida) {
+        return false;
+    }
+    tam_hoja = hoja;
+    tam_archivo = tam;
+    hojas.swap(leidas);
+    raiz = raiz_leida;
+    return true;
+}
+
+// Manifiestos de varios tamaños y con hojas alteradas, en serie y en el pool
+inline bool verificarManifiestoMerkle(std::string& detalle) {
+    std::vector<uint8_t> datos(100000);
+    uint32_t semilla = 0x5EED;
+    for (size_t i = 0; i < datos.size(); i++) {
+        semilla = semilla * 1664525u + 1013904223u;
+        datos[i] = static_cast<uint8_t>(semilla >> 24);
+    }
+
+    PoolHilos pool(3);
+    const uint32_t tam_hoja = 1000;
+    for (size_t tam : {size_t(0), size_t(1), size_t(999), size_t(1000), size_t(1001), size_t(37000), datos.size()}) {
+        ManifiestoMerkle serie = ManifiestoMerkle::construir(datos.data(), tam, tam_hoja, nullptr);
+        ManifiestoMerkle paralelo = ManifiestoMerkle::construir(datos.data(), tam, tam_hoja, &pool);
+        if (serie.raiz != paralelo.raiz || serie.hojas != paralelo.hojas) {
+            detalle = "la raiz en paralelo difiere de la calculada en serie (" + std::to_string(tam) + " bytes)";
+            return false;
+        }
+
+        // Cada hoja debe coincidir con el SHA-256 de (0x00 || datos de la hoja)
+        for (size_t h = 0; h < serie.hojas.size(); ++h) {
+            size_t offset = h * tam_hoja;
+            size_t len = std::min<size_t>(tam_hoja, tam - offset);
+            std::vector<uint8_t> mensaje(1, 0x00);
+            mensaje.insert(mensaje.end(), datos.begin() + offset, datos.begin() + offset + len);
+            ManifiestoMerkle::Digest esperado;
+            SHA256 sha256;
+            sha256.update(mensaje.data(), mensaje.size());
+            sha256.finalize(esperado.data());
+            if (esperado != serie.hojas[h]) {
+                detalle = "hoja " + std::to_string(h) + " incorrecta (" + std::to_string(tam) + " bytes)";
+                return false;
+            }
+        }
+
+        if (tam > 0) {
+            std::vector<uint8_t> alterados(datos.begin(), datos.begin() + tam);
+            alterados[tam / 2] ^= 0x40;
+            std::vector<uint64_t> distintas = serie.hojasDistintas(alterados.data(), tam, &pool);
+            if (distintas.size() != 1 || distintas[0] != (tam / 2) / tam_hoja) {
+                detalle = "no se localizo la hoja alterada (" + std::to_string(tam) + " bytes)";
+                return false;
+            }
+        }
+    }
+
+    // Ida y vuelta por disco, y una cabecera coherente pero con un tamaño
+    // enorme: se rechaza sin intentar reservar sus hojas
+    const std::string ruta = (std::filesystem::temp_directory_path() / "autoprueba_merkle.sha").string();
+    ManifiestoMerkle original = ManifiestoMerkle::construir(datos.data(), datos.size(), tam_hoja, nullptr);
+    ManifiestoMerkle leido;
+    bool correcto = original.guardar(ruta) && leido.cargar(ruta) && leido.raiz == original.raiz;
+    if (!correcto) {
+        detalle = "el manifiesto guardado no se lee igual";
+    } else {
+        std::fstream f(ruta, std::ios::binary | std::ios::in | std::ios::out);
+        uint8_t campos[16];
+        for (int i = 0; i < 8; ++i) {
+            campos[i] = static_cast<uint8_t>((1ULL << 50) >> (8 * i));                  // tam
+            campos[8 + i] = static_cast<uint8_t>(((1ULL << 50) / tam_hoja + 1) >> (8 * i)); // hojas
+        }
+        f.seekp(16);
+        f.write(reinterpret_cast<const char*>(campos), sizeof(campos));
+        f.close();
+        if (leido.cargar(ruta)) {
+            detalle = "se acepto un manifiesto con mas hojas que bytes";
+            correcto = false;
+        }
+    }
+    std::remove(ruta.c_str());
+    return correcto;
+}
+
+#endif // MANIFIESTO_MERKLE_H
@@ -0,0 +1,244 @@
+#ifndef MOTOR_CIFRADO_H
+#define MOTOR_CIFRADO_H
+
+// Motores de cifrado intercambiables. Todas las etapas que cifran o descifran
+// (mapas, flujos, rangos, io_uring, filtro, compresion, segmentos del diario)
+// pasan por el motor activo e indican en que byte del archivo empieza cada
+// bloque: al Cesar no le importa, pero un cifrado por contador como AES-CTR
+// necesita la posicion para poder procesar cada trozo por separado.
+//
+// El registro enumera los motores con su identificador de linea de comandos,
+// el tamaño de clave y si la CPU los soporta; el motor se elige y se crea una
+// sola vez al arrancar, antes de lanzar ningun thread.
+//
+// Un cifrado por contador no puede usar el mismo flujo de clave para dos
+// archivos distintos: en el modo por directorios cada archivo usa el motor
+// que devuelve paraArchivo(ruta relativa), que en AES-CTR combina la mitad
+// alta del IV con el SHA-256 de la ruta. La ruta se conoce tambien al
+// descifrar (--ruta-lote en el modo filtro).
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Cifrado.h"
+#include "CifradoAES.h"
+#include "SHA256.h"
+
+class MotorCifrado {
+public:
+    virtual ~MotorCifrado() = default;
+
+    virtual std::string nombre() const = 0;
+
+    // 'posicion' es el byte del archivo en el que empieza el bloque. Origen y
+    // destino pueden ser el mismo buffer o zonas sin solapamiento.
+    virtual void cifrar(const char* origen, char* destino, size_t size, uint64_t posicion) const = 0;
+    virtual void descifrar(const char* origen, char* destino, size_t size, uint64_t posicion) const = 0;
+
+    // Motor para el archivo 'relativa' del modo por directorios
+    virtual std::unique_ptr<MotorCifrado> paraArchivo(const std::string& relativa) const = 0;
+
+    // true si paraArchivo da un flujo de clave distinto para cada ruta (dos
+    // archivos iguales no comparten .enc)
+    virtual bool dependeDeLaRuta() const { return false; }
+};
+
+// El cifrado del proyecto (Cifrado.h) con el kernel SIMD elegido por cpuid
+class MotorCesar : public MotorCifrado {
+public:
+    std::string nombre() const override {
+        return std::string("Cesar (") + nombreBackendCifrado(backendCifradoActivo()) + ")";
+    }
+    void cifrar(const char* origen, char* destino, size_t size, uint64_t) const override {
+        CifradoProyecto::cifrar(origen, destino, size);
+    }
+    void descifrar(const char* origen, char* destino, size_t size, uint64_t) const override {
+        CifradoProyecto::descifrar(origen, destino, size);
+    }
+    std::unique_ptr<MotorCifrado> paraArchivo(const std::string&) const override {
+        return std::unique_ptr<MotorCifrado>(new MotorCesar());
+    }
+};
+
+class MotorAESCTR : public MotorCifrado {
+public:
+    // 'clave' de 16 o 32 bytes; 'iv', el contador inicial de 16 bytes
+    MotorAESCTR(const uint8_t* clave, size_t tam_clave, const uint8_t iv[16])
+        : iv_alto(leerBE64(iv)), iv_bajo(leerBE64(iv + 8)) {
+        if (tam_clave == 32) {
+            expandirClaveAES256(clave, expandida);
+        } else {
+            expandirClaveAES128(clave, expandida);
+        }
+    }
+
+    std::string nombre() const override {
+        return expandida.rondas == 14 ? "AES-256-CTR (AES-NI, 8 bloques)" : "AES-128-CTR (AES-NI, 8 bloques)";
+    }
+    void cifrar(const char* origen, char* destino, size_t size, uint64_t posicion) const override {
+        transformarAESCTR(expandida, iv_alto, iv_bajo, origen, destino, size, posicion);
+    }
+    void descifrar(const char* origen, char* destino, size_t size, uint64_t posicion) const override {
+        transformarAESCTR(expandida, iv_alto, iv_bajo, origen, destino, size, posicion);
+    }
+
+    // Mitad alta del contador: la del IV XOR los 8 primeros bytes del SHA-256
+    // de la ruta. La mitad baja sigue contando bloques dentro del archivo.
+    std::unique_ptr<MotorCifrado> paraArchivo(const std::string& relativa) const override {
+        SHA256 sha;
+        uint8_t digest[SHA256::DIGEST_SIZE];
+        sha.update(relativa.data(), relativa.size());
+        sha.finalize(digest);
+        return std::unique_ptr<MotorCifrado>(new MotorAESCTR(expandida, iv_alto ^ leerBE64(digest), iv_bajo));
+    }
+    bool dependeDeLaRuta() const override { return true; }
+
+private:
+    MotorAESCTR(const ClaveExpandidaAES& expandida, uint64_t iv_alto, uint64_t iv_bajo)
+        : expandida(expandida), iv_alto(iv_alto), iv_bajo(iv_bajo) {}
+
+    ClaveExpandidaAES expandida;
+    uint64_t iv_alto;
+    uint64_t iv_bajo;
+};
+
+// Entrada del registro de motores
+struct DescripcionMotorCifrado {
+    const char* id;             // Valor de --motor-cifrado
+    size_t tam_clave;           // Bytes de clave (0 = no usa clave)
+    bool (*disponible)();
+    std::unique_ptr<MotorCifrado> (*crear)(const uint8_t* clave, const uint8_t iv[16]);
+};
+
+inline bool siempreDisponible() {
+    return true;
+}
+
+inline const std::vector<DescripcionMotorCifrado>& registroMotoresCifrado() {
+    static const std::vector<DescripcionMotorCifrado> registro = {
+        {"cesar", 0, siempreDisponible,
+         [](const uint8_t*, const uint8_t*) -> std::unique_ptr<MotorCifrado> { return std::make_unique<MotorCesar>(); }},
+        {"aes128-ctr", 16, aesNIDisponible,
+         [](const uint8_t* clave, const uint8_t* iv) -> std::unique_ptr<MotorCifrado> { return std::make_unique<MotorAESCTR>(clave, 16, iv); }},
+        {"aes256-ctr", 32, aesNIDisponible,
+         [](const uint8_t* clave, const uint8_t* iv) -> std::unique_ptr<MotorCifrado> { return std::make_unique<MotorAESCTR>(clave, 32, iv); }},
+    };
+    return registro;
+}
+
+inline const DescripcionMotorCifrado* buscarMotorCifrado(const std::string& id) {
+    for (const DescripcionMotorCifrado& d : registroMotoresCifrado()) {
+        if (id == d.id) {
+            return &d;
+        }
+    }
+    return nullptr;
+}
+
+// Crea el motor 'id' con la clave y el IV en hexadecimal. Los motores con
+// clave exigen el IV: un valor fijo por defecto haria que todas las ordenes
+// con la misma clave repitieran el flujo. Devuelve nullptr y el motivo en
+// 'error' si no se puede.
+inline std::unique_ptr<MotorCifrado> crearMotorCifrado(const std::string& id, const std::string& clave_hex,
+                                                       const std::string& iv_hex, std::string& error) {
+    const DescripcionMotorCifrado* d = buscarMotorCifrado(id);
+    if (d == nullptr) {
+        error = "motor de cifrado desconocido: " + id;
+        return nullptr;
+    }
+    if (!d->disponible()) {
+        error = std::string("el motor ") + d->id + " no esta disponible en esta CPU";
+        return nullptr;
+    }
+    std::string clave;
+    std::string iv(TAM_BLOQUE_AES, '\0');
+    if (d->tam_clave == 0) {
+        if (!clave_hex.empty() || !iv_hex.empty()) {
+            error = std::string("el motor ") + d->id + " no usa clave ni IV";
+            return nullptr;
+        }
+    } else {
+        if (!parsearHexadecimal(clave_hex, clave) || clave.size() != d->tam_clave) {
+            error = std::string("el motor ") + d->id + " necesita una clave de " + std::to_string(d->tam_clave) +
+                    " bytes (" + std::to_string(2 * d->tam_clave) + " digitos hexadecimales)";
+            return nullptr;
+        }
+        if (iv_hex.empty()) {
+            error = std::string("el motor ") + d->id + " necesita --iv con 16 bytes aleatorios en hexadecimal"
+                    " (p. ej. openssl rand -hex 16); hay que dar el mismo al descifrar";
+            return nullptr;
+        }
+        if (!parsearHexadecimal(iv_hex, iv) || iv.size() != TAM_BLOQUE_AES) {
+            error = "el IV debe tener 16 bytes (32 digitos hexadecimales)";
+            return nullptr;
+        }
+    }
+    return d->crear(reinterpret_cast<const uint8_t*>(clave.data()), reinterpret_cast<const uint8_t*>(iv.data()));
+}
+
+inline std::unique_ptr<MotorCifrado>& motorCifradoGlobal() {
+    static std::unique_ptr<MotorCifrado> motor(new MotorCesar());
+    return motor;
+}
+
+// Motor propio del thread actual mientras exista (el del archivo que procesa
+// en el modo por directorios). Las tareas que se lanzan al pool corren en
+// otros threads: deben capturar motorCifradoActivo() al crearse.
+class MotorCifradoEnHilo {
+public:
+    explicit MotorCifradoEnHilo(const MotorCifrado& motor) : anterior(actual()) { actual() = &motor; }
+    ~MotorCifradoEnHilo() { actual() = anterior; }
+
+    MotorCifradoEnHilo(const MotorCifradoEnHilo&) = delete;
+    MotorCifradoEnHilo& operator=(const MotorCifradoEnHilo&) = delete;
+
+    static const MotorCifrado*& actual() {
+        thread_local const MotorCifrado* motor = nullptr;
+        return motor;
+    }
+
+private:
+    const MotorCifrado* anterior;
+};
+
+// Motor que usan todas las etapas: el del thread si lo hay y si no el global
+// (por defecto, el Cesar del proyecto)
+inline const MotorCifrado& motorCifradoActivo() {
+    const MotorCifrado* propio = MotorCifradoEnHilo::actual();
+    return propio != nullptr ? *propio : *motorCifradoGlobal();
+}
+
+// Solo al arrancar: los threads leen el motor sin sincronizacion
+inline void activarMotorCifrado(std::unique_ptr<MotorCifrado> motor) {
+    motorCifradoGlobal() = std::move(motor);
+}
+
+// Transformaciones en el lugar con la firma de TransformacionBloque (LoteIoUring.h)
+inline void cifrarBloqueEnPosicion(char* buffer, size_t size, uint64_t posicion) {
+    motorCifradoActivo().cifrar(buffer, buffer, size, posicion);
+}
+
+inline void descifrarBloqueEnPosicion(char* buffer, size_t size, uint64_t posicion) {
+    motorCifradoActivo().descifrar(buffer, buffer, size, posicion);
+}
+
+// Rendimiento en memoria de un motor (MB/s, 10^6 bytes por segundo): cifra
+// 'buffer' en el lugar durante al menos 'segundos', tras una pasada sin medir
+inline double medirRendimientoMotor(const MotorCifrado& motor, char* buffer, size_t size, double segundos = 0.25) {
+    motor.cifrar(buffer, buffer, size, 0);
+    uint64_t bytes = 0;
+    auto inicio = std::chrono::steady_clock::now();
+    double transcurrido = 0;
+    do {
+        motor.cifrar(buffer, buffer, size, bytes);
+        bytes += size;
+        transcurrido = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    } while (transcurrido < segundos);
+    return static_cast<double>(bytes) / transcurrido / 1e6;
+}
+
+#endif // MOTOR_CIFRADO_H
@@ -0,0 +1,392 @@
+#ifndef OPCIONES_H
+#define OPCIONES_H
+
+#include <cstdint>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "Benchmark.h"
+#include "CacheHash.h"
+#include "EntradaSalida.h"
+#include "MotorCifrado.h"
+#include "Plataforma.h"
+
+// Cuando usar el hash multi-buffer (SHA256Lote) en el proceso optimizado
+enum class ModoHashLote {
+    Auto,       // Solo con muchos archivos y si el lote supera al flujo simple
+    Siempre,
+    Nunca
+};
+
+// Cuando repartir el cifrado de un mismo archivo entre varios threads
+enum class ModoRangos {
+    Auto,       // Solo archivos grandes y menos archivos que threads
+    Siempre,
+    Nunca
+};
+
+// Formato del archivo .sha del proceso optimizado
+enum class FormatoHash {
+    Plano,      // SHA-256 del archivo completo en hexadecimal (formato original)
+    Merkle      // Manifiesto binario con un hash por hoja y la raiz del arbol
+};
+
+// Modo filtro: transformar la entrada estandar hacia la salida estandar
+enum class ModoFiltro {
+    Ninguno,
+    Cifrar,
+    Descifrar
+};
+
+// Configuracion del programa tomada de la linea de comandos
+struct OpcionesPrograma {
+    std::string archivoOriginal = "original.txt";
+    int N = 10;                 // El enunciado indica N = 10 para la entrega
+    bool autoprueba = false;
+    ModoHashLote hashLote = ModoHashLote::Auto;
+    bool fusionado = false;     // Copia + cifrado + hash en una sola lectura
+    BackendES es = backendESPorDefecto();
+    DisposicionHilos afinidad = DisposicionHilos::Ninguna;
+    bool prioridadAlta = true;
+    unsigned int hilos = 0;     // Threads del pool; 0 = segun los CPUs (maximo 8)
+    ModoRangos rangos = ModoRangos::Auto;
+    size_t tamRango = 8 * 1024 * 1024;  // Bytes por rango (multiplo de 64 KiB)
+    FormatoHash formatoHash = FormatoHash::Plano;
+    uint32_t tamHoja = 1024 * 1024;     // Bytes por hoja del manifiesto Merkle
+    bool verificacionEnMemoria = false; // Descifrar, hashear y comparar sin escribir el descifrado
+    bool conservarDescifrado = false;   // En verificacion en memoria, escribir igualmente el descifrado
+    bool copiaEnNucleo = true;          // Copiar con reflink/copy_file_range/sendfile antes que con buffers
+    std::string rutaTraza;              // Traza de Chrome con los tiempos por etapa (vacio = no guardar)
+    bool resumenEtapas = false;         // Mostrar tiempo, bytes y MB/s por etapa al terminar
+    bool contadoresHardware = false;    // Añadir ciclos, instrucciones y fallos de cache/salto por etapa
+    std::string motorCifrado = "cesar"; // Identificador del registro de MotorCifrado.h
+    std::string claveCifrado;           // Clave del motor en hexadecimal (vacio = sin clave)
+    std::string ivCifrado;              // IV de los motores CTR en hexadecimal (obligatorio con ellos)
+
+    // Modo por directorios: si hay entradas, se procesan sus arboles en lugar de N copias
+    std::vector<std::string> directoriosEntrada;
+    std::string directorioSalida = "salida";
+    std::string rutaCacheHash;              // Cache persistente de hashes de las entradas (vacio = sin cache)
+    ModoDeduplicacion deduplicar = ModoDeduplicacion::Ninguno;
+    std::string rutaDiario;                 // Diario para reanudar el lote (vacio = sin diario)
+    bool comprimir = false;                 // Comprimir (LZ por bloques) antes de cifrar
+
+    // Modo filtro (stdin -> stdout): memoria fija de buffersFiltro * tamBufferFiltro
+    ModoFiltro filtro = ModoFiltro::Ninguno;
+    bool hashFlujo = false;                 // SHA-256 del texto plano al terminar, por stderr
+    std::string rutaHashFlujo;              // Ademas, guardarlo en este archivo (formato .sha)
+    size_t buffersFiltro = 4;
+    size_t tamBufferFiltro = 1024 * 1024;
+    std::string rutaLote;                   // Ruta relativa del archivo en el modo por directorios (contador por archivo)
+
+    // Modo --benchmark: cada combinacion de tamaño, N y threads se repite varias veces
+    bool benchmark = false;
+    std::vector<uint64_t> benchTamanos;     // Corpus sinteticos a generar; vacio = archivoOriginal
+    std::vector<int> benchN;                // Vacio = N
+    std::vector<unsigned int> benchHilos;   // Vacio = hilos
+    int calentamiento = 1;                  // Repeticiones previas que no se miden
+    int repeticiones = 5;
+    bool vaciarCache = false;               // Vaciar la cache de paginas antes de cada repeticion
+    bool benchBase = true;                  // Medir tambien el proceso base
+    std::string benchJSON;                  // Rutas de los informes (vacio = no escribir)
+    std::string benchCSV;
+};
+
+inline void mostrarAyuda(const char* programa) {
+    std::cout << "Uso: " << programa << " [opciones]" << std::endl
+              << "  --archivo <ruta>   Archivo original a procesar (por defecto original.txt)" << std::endl
+              << "  -n <N>             Numero de copias a procesar (por defecto 10)" << std::endl
+              << "  --directorio <ruta>" << std::endl
+              << "                     Cifrar y verificar cada archivo del arbol (se puede repetir);" << std::endl
+              << "                     los mas grandes se reparten primero. Con varias, cada una se" << std::endl
+              << "                     guarda bajo su nombre, que no puede repetirse" << std::endl
+              << "  --salida <ruta>    Directorio donde se reflejan los .enc y .sha (por defecto salida)" << std::endl
+              << "  --cache-hash <ruta> Con --directorio, guardar el hash de cada entrada por dispositivo," << std::endl
+              << "                     inodo, tamaño y fecha, y no volver a leer las que no cambien" << std::endl
+              << "  --deduplicar <enlace|reflink>" << std::endl
+              << "                     Con --directorio, cifrar una sola vez los archivos identicos y" << std::endl
+              << "                     enlazar el .enc de los demas al del primero" << std::endl
+              << "  --comprimir        Con --directorio o en modo filtro, comprimir por bloques (formato" << std::endl
+              << "                     LZ4) antes de cifrar; con --descifrar, descomprimir despues" << std::endl
+              << "  --diario <ruta>    Con --directorio, anotar cada archivo terminado y el avance de los" << std::endl
+              << "                     grandes; al repetir la orden se omite lo hecho y se reanuda el resto" << std::endl
+              << "  --cifrar / --descifrar" << std::endl
+              << "                     Filtro: cifrar o descifrar la entrada estandar hacia la salida" << std::endl
+              << "                     estandar sin archivos temporales (p. ej. tar c . | prog --cifrar)" << std::endl
+              << "  --hash-flujo       En modo filtro, mostrar por stderr el SHA-256 del texto plano" << std::endl
+              << "  --hash-flujo-archivo <ruta>" << std::endl
+              << "                     En modo filtro, guardar el SHA-256 del texto plano en <ruta>" << std::endl
+              << "  --buffer-flujo <KiB> Longitud de cada uno de los 4 buffers del filtro (por defecto 1024)" << std::endl
+              << "  --motor-cifrado <cesar|aes128-ctr|aes256-ctr>" << std::endl
+              << "                     Cifrado del proceso optimizado, del lote y del filtro (por defecto" << std::endl
+              << "                     cesar); AES-CTR usa AES-NI y necesita una clave" << std::endl
+              << "  --clave <hex> / --clave-archivo <ruta>" << std::endl
+              << "                     Clave de AES en hexadecimal (32 o 64 digitos), en la orden o en un" << std::endl
+              << "                     archivo (asi no aparece en la lista de procesos)" << std::endl
+              << "  --iv <hex>         Contador inicial de AES-CTR, 32 digitos (obligatorio con AES; p. ej." << std::endl
+              << "                     openssl rand -hex 16). En el modo por directorios cada archivo" << std::endl
+              << "                     combina la mitad alta con el SHA-256 de su ruta relativa" << std::endl
+              << "  --ruta-lote <ruta> En modo filtro con AES-CTR, descifrar (o cifrar) como el archivo" << std::endl
+              << "                     <ruta> del modo por directorios (ruta relativa a --salida, con /" << std::endl
+              << "                     y sin .enc)" << std::endl
+              << "  --hash-lote        Calcular los hashes con SHA-256 multi-buffer" << std::endl
+              << "  --sin-hash-lote    Calcular los hashes archivo por archivo" << std::endl
+              << "  --fusionado        Copiar, cifrar y hashear en una sola lectura del original" << std::endl
+              << "  --es <flujo|mmap|io_uring>" << std::endl
+              << "                     Backend de E/S del proceso optimizado (por defecto mmap si existe);" << std::endl
+              << "                     io_uring copia y cifra todo el lote con E/S asincrona en un thread" << std::endl
+              << "  --sin-copia-nucleo Copiar siempre por bloques en lugar de con reflink," << std::endl
+              << "                     copy_file_range o sendfile" << std::endl
+              << "  --hilos <T>        Threads del pool del proceso optimizado (por defecto segun CPUs, max. 8)" << std::endl
+              << "  --rangos           Cifrar cada archivo repartido por rangos entre los threads" << std::endl
+              << "  --sin-rangos       Cifrar cada archivo entero en un solo thread" << std::endl
+              << "  --tam-rango <MiB>  Longitud de cada rango (por defecto 8 MiB)" << std::endl
+              << "  --verificar-en-memoria" << std::endl
+              << "                     Descifrar cada .enc en memoria, hashearlo y compararlo con el" << std::endl
+              << "                     original en una sola pasada, sin escribir el descifrado" << std::endl
+              << "  --conservar-descifrado" << std::endl
+              << "                     Con --verificar-en-memoria, escribir igualmente el descifrado" << std::endl
+              << "  --manifiesto <plano|merkle>" << std::endl
+              << "                     Formato del .sha: hash del archivo completo (por defecto)" << std::endl
+              << "                     o arbol de hashes por hojas, verificable en paralelo" << std::endl
+              << "  --tam-hoja <KiB>   Longitud de cada hoja del manifiesto Merkle (por defecto 1024 KiB)" << std::endl
+              << "  --afinidad <ninguna|compacta|dispersa>" << std::endl
+              << "                     Fijar cada thread a un CPU: compacta llena los hermanos SMT" << std::endl
+              << "                     de un nucleo antes de pasar al siguiente, dispersa usa" << std::endl
+              << "                     primero un CPU por nucleo fisico (por defecto ninguna)" << std::endl
+              << "  --sin-prioridad    No elevar la prioridad del proceso" << std::endl
+              << "  --etapas           Mostrar al final el tiempo, los bytes y los MB/s de cada etapa" << std::endl
+              << "  --traza <ruta>     Guardar las etapas de cada thread como traza de Chrome (JSON)" << std::endl
+              << "                     para verlas en Perfetto; implica --etapas" << std::endl
+              << "  --contadores       Medir ciclos, instrucciones y fallos de LLC y de salto por etapa" << std::endl
+              << "                     (perf_event_open); muestra IPC y bytes/ciclo. Implica --etapas" << std::endl
+              << "  --benchmark        Repetir los procesos y mostrar estadisticas en lugar de una sola pasada" << std::endl
+              << "  --bench-tam <lista>" << std::endl
+              << "                     Tamaños de corpus sinteticos, p. ej. 256K,4M,64M (por defecto el --archivo)" << std::endl
+              << "  --bench-n <lista>  Valores de N a medir (por defecto -n)" << std::endl
+              << "  --bench-hilos <lista>" << std::endl
+              << "                     Threads del proceso optimizado a medir (por defecto --hilos)" << std::endl
+              << "  --calentamiento <K> Repeticiones sin medir antes de cada configuracion (por defecto 1)" << std::endl
+              << "  --repeticiones <R> Repeticiones medidas por configuracion (por defecto 5)" << std::endl
+              << "  --vaciar-cache     Vaciar la cache de paginas antes de cada repeticion" << std::endl
+              << "  --bench-sin-base   Medir solo el proceso optimizado" << std::endl
+              << "  --bench-json <ruta> / --bench-csv <ruta>" << std::endl
+              << "                     Guardar los resultados del benchmark en JSON o CSV" << std::endl
+              << "  --autoprueba       Verificar los kernels acelerados y salir" << std::endl
+              << "  --ayuda            Mostrar esta ayuda" << std::endl;
+}
+
+// Devuelve false si los argumentos no son validos (ya se informo el error)
+inline bool parsearArgumentos(int argc, char* argv[], OpcionesPrograma& opciones) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool tiene_valor = (i + 1 < argc);
+
+        if (arg == "--autoprueba") {
+            opciones.autoprueba = true;
+        } else if (arg == "--archivo" && tiene_valor) {
+            opciones.archivoOriginal = argv[++i];
+        } else if (arg == "-n" && tiene_valor) {
+            opciones.N = std::atoi(argv[++i]);
+            if (opciones.N <= 0) {
+                std::cout << "Error: N debe ser mayor que cero." << std::endl;
+                return false;
+            }
+        } else if (arg == "--directorio" && tiene_valor) {
+            opciones.directoriosEntrada.push_back(argv[++i]);
+        } else if (arg == "--salida" && tiene_valor) {
+            opciones.directorioSalida = argv[++i];
+        } else if (arg == "--cifrar") {
+            opciones.filtro = ModoFiltro::Cifrar;
+        } else if (arg == "--descifrar") {
+            opciones.filtro = ModoFiltro::Descifrar;
+        } else if (arg == "--hash-flujo") {
+            opciones.hashFlujo = true;
+        } else if (arg == "--hash-flujo-archivo" && tiene_valor) {
+            opciones.rutaHashFlujo = argv[++i];
+        } else if (arg == "--buffer-flujo" && tiene_valor) {
+            int kib = std::atoi(argv[++i]);
+            if (kib <= 0 || kib > 1024 * 1024) {
+                std::cerr << "Error: La longitud del buffer debe estar entre 1 KiB y 1 GiB." << std::endl;
+                return false;
+            }
+            opciones.tamBufferFiltro = static_cast<size_t>(kib) * 1024;
+        } else if (arg == "--cache-hash" && tiene_valor) {
+            opciones.rutaCacheHash = argv[++i];
+        } else if (arg == "--comprimir") {
+            opciones.comprimir = true;
+        } else if (arg == "--diario" && tiene_valor) {
+            opciones.rutaDiario = argv[++i];
+        } else if (arg == "--deduplicar" && tiene_valor) {
+            std::string valor = argv[++i];
+            if (valor == "enlace") {
+                opciones.deduplicar = ModoDeduplicacion::Enlace;
+            } else if (valor == "reflink") {
+                opciones.deduplicar = ModoDeduplicacion::Reflink;
+            } else {
+                std::cout << "Error: Modo de deduplicacion no valido: " << valor << std::endl;
+                return false;
+            }
+        } else if (arg == "--motor-cifrado" && tiene_valor) {
+            opciones.motorCifrado = argv[++i];
+            if (buscarMotorCifrado(opciones.motorCifrado) == nullptr) {
+                std::cout << "Error: Motor de cifrado no valido: " << opciones.motorCifrado << std::endl;
+                return false;
+            }
+        } else if (arg == "--clave" && tiene_valor) {
+            opciones.claveCifrado = argv[++i];
+        } else if (arg == "--clave-archivo" && tiene_valor) {
+            std::ifstream archivo_clave(argv[++i]);
+            if (!(archivo_clave >> opciones.claveCifrado)) {
+                std::cout << "Error: No se pudo leer la clave de " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--iv" && tiene_valor) {
+            opciones.ivCifrado = argv[++i];
+        } else if (arg == "--ruta-lote" && tiene_valor) {
+            opciones.rutaLote = argv[++i];
+        } else if (arg == "--hash-lote") {
+            opciones.hashLote = ModoHashLote::Siempre;
+        } else if (arg == "--sin-hash-lote") {
+            opciones.hashLote = ModoHashLote::Nunca;
+        } else if (arg == "--fusionado") {
+            opciones.fusionado = true;
+        } else if (arg == "--es" && tiene_valor) {
+            std::string valor = argv[++i];
+            if (valor == "flujo") {
+                opciones.es = BackendES::Flujo;
+            } else if (valor == "mmap" && backendESDisponible(BackendES::Mmap)) {
+                opciones.es = BackendES::Mmap;
+            } else if (valor == "io_uring" && backendESDisponible(BackendES::IoUring)) {
+                opciones.es = BackendES::IoUring;
+            } else {
+                std::cout << "Error: Backend de E/S no valido o no disponible: " << valor << std::endl;
+                return false;
+            }
+        } else if (arg == "--sin-copia-nucleo") {
+            opciones.copiaEnNucleo = false;
+        } else if (arg == "--hilos" && tiene_valor) {
+            int valor = std::atoi(argv[++i]);
+            if (valor <= 0) {
+                std::cout << "Error: El numero de threads debe ser mayor que cero." << std::endl;
+                return false;
+            }
+            opciones.hilos = static_cast<unsigned int>(valor);
+        } else if (arg == "--rangos") {
+            opciones.rangos = ModoRangos::Siempre;
+        } else if (arg == "--sin-rangos") {
+            opciones.rangos = ModoRangos::Nunca;
+        } else if (arg == "--tam-rango" && tiene_valor) {
+            int mib = std::atoi(argv[++i]);
+            if (mib <= 0) {
+                std::cout << "Error: La longitud del rango debe ser mayor que cero." << std::endl;
+                return false;
+            }
+            opciones.tamRango = static_cast<size_t>(mib) * 1024 * 1024;
+        } else if (arg == "--verificar-en-memoria") {
+            opciones.verificacionEnMemoria = true;
+        } else if (arg == "--conservar-descifrado") {
+            opciones.conservarDescifrado = true;
+        } else if (arg == "--manifiesto" && tiene_valor) {
+            std::string valor = argv[++i];
+            if (valor == "plano") {
+                opciones.formatoHash = FormatoHash::Plano;
+            } else if (valor == "merkle") {
+                opciones.formatoHash = FormatoHash::Merkle;
+            } else {
+                std::cout << "Error: Formato de manifiesto no valido: " << valor << std::endl;
+                return false;
+            }
+        } else if (arg == "--tam-hoja" && tiene_valor) {
+            int kib = std::atoi(argv[++i]);
+            if (kib <= 0 || kib > 1024 * 1024) {
+                std::cout << "Error: La longitud de hoja debe estar entre 1 KiB y 1 GiB." << std::endl;
+                return false;
+            }
+            opciones.tamHoja = static_cast<uint32_t>(kib) * 1024;
+        } else if (arg == "--afinidad" && tiene_valor) {
+            std::string valor = argv[++i];
+            if (valor == "ninguna") {
+                opciones.afinidad = DisposicionHilos::Ninguna;
+            } else if (valor == "compacta") {
+                opciones.afinidad = DisposicionHilos::Compacta;
+            } else if (valor == "dispersa") {
+                opciones.afinidad = DisposicionHilos::Dispersa;
+            } else {
+                std::cout << "Error: Disposicion de afinidad no valida: " << valor << std::endl;
+                return false;
+            }
+        } else if (arg == "--sin-prioridad") {
+            opciones.prioridadAlta = false;
+        } else if (arg == "--etapas") {
+            opciones.resumenEtapas = true;
+        } else if (arg == "--contadores") {
+            opciones.contadoresHardware = true;
+        } else if (arg == "--traza" && tiene_valor) {
+            opciones.rutaTraza = argv[++i];
+        } else if (arg == "--benchmark") {
+            opciones.benchmark = true;
+        } else if (arg == "--bench-tam" && tiene_valor) {
+            if (!parsearLista(argv[++i], opciones.benchTamanos, parsearTamBytes)) {
+                std::cout << "Error: Lista de tamaños no valida: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if ((arg == "--bench-n" || arg == "--bench-hilos") && tiene_valor) {
+            std::vector<int> valores;
+            bool ok = parsearLista(argv[++i], valores, [](const std::string& texto, int& valor) {
+                valor = std::atoi(texto.c_str());
+                return valor > 0;
+            });
+            if (!ok) {
+                std::cout << "Error: Lista de valores no valida: " << argv[i] << std::endl;
+                return false;
+            }
+            if (arg == "--bench-n") {
+                opciones.benchN = valores;
+            } else {
+                opciones.benchHilos.assign(valores.begin(), valores.end());
+            }
+        } else if (arg == "--calentamiento" && tiene_valor) {
+            opciones.calentamiento = std::atoi(argv[++i]);
+            if (opciones.calentamiento < 0) {
+                std::cout << "Error: El calentamiento no puede ser negativo." << std::endl;
+                return false;
+            }
+        } else if (arg == "--repeticiones" && tiene_valor) {
+            opciones.repeticiones = std::atoi(argv[++i]);
+            if (opciones.repeticiones <= 0) {
+                std::cout << "Error: El numero de repeticiones debe ser mayor que cero." << std::endl;
+                return false;
+            }
+        } else if (arg == "--vaciar-cache") {
+            opciones.vaciarCache = true;
+        } else if (arg == "--bench-sin-base") {
+            opciones.benchBase = false;
+        } else if (arg == "--bench-json" && tiene_valor) {
+            opciones.benchJSON = argv[++i];
+        } else if (arg == "--bench-csv" && tiene_valor) {
+            opciones.benchCSV = argv[++i];
+        } else if (arg == "--ayuda" || arg == "-h") {
+            mostrarAyuda(argv[0]);
+            return false;
+        } else {
+            std::cout << "Error: Argumento no reconocido o sin valor: " << arg << std::endl;
+            mostrarAyuda(argv[0]);
+            return false;
+        }
+    }
+    // El anillo compartido por todo el lote solo cubre el flujo copia -> cifrado
+    // -> descifrado con hash multi-buffer; con estas opciones cada archivo usa
+    // su propio anillo
+    if (opciones.es == BackendES::IoUring && opciones.directoriosEntrada.empty() &&
+        (opciones.fusionado || opciones.verificacionEnMemoria || opciones.formatoHash == FormatoHash::Merkle)) {
+        std::cout << "Aviso: con --fusionado, --verificar-en-memoria o --manifiesto merkle, io_uring no procesa"
+                  << " el lote en un solo anillo: se crea un anillo por archivo" << std::endl;
+    }
+    return true;
+}
+
+#endif // OPCIONES_H
@@ -0,0 +1,245 @@
+#ifndef PLATAFORMA_H
+#define PLATAFORMA_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Como repartir los threads de trabajo entre los CPUs logicos
+enum class DisposicionHilos {
+    Ninguna,    // Sin fijar: decide el planificador del sistema
+    Compacta,   // Llena cada nucleo fisico (sus hermanos SMT) antes de pasar al siguiente
+    Dispersa    // Un thread por nucleo fisico y paquete antes de reutilizar hermanos SMT
+};
+
+inline const char* nombreDisposicion(DisposicionHilos disposicion) {
+    switch (disposicion) {
+        case DisposicionHilos::Compacta: return "compacta";
+        case DisposicionHilos::Dispersa: return "dispersa";
+        default: return "ninguna";
+    }
+}
+
+// Un CPU logico utilizable por el proceso y su posicion en la topologia
+struct CPULogico {
+    int id = 0;
+    int nucleo = 0;     // Identificador del nucleo fisico dentro del paquete
+    int paquete = 0;    // Socket
+};
+
+struct TopologiaCPU {
+    std::vector<CPULogico> cpus;    // Solo los permitidos por la afinidad actual
+    int nucleos_fisicos = 0;
+    int paquetes = 0;
+
+    int hilosPorNucleo() const {
+        return nucleos_fisicos > 0 ? static_cast<int>(cpus.size()) / nucleos_fisicos : 1;
+    }
+};
+
+#if defined(__linux__)
+inline int leerEnteroSysfs(const std::string& ruta, int por_defecto) {
+    std::ifstream f(ruta);
+    int valor;
+    return (f >> valor) ? valor : por_defecto;
+}
+#endif
+
+inline TopologiaCPU detectarTopologiaCPU() {
+    TopologiaCPU topologia;
+
+#if defined(__linux__)
+    cpu_set_t permitidos;
+    CPU_ZERO(&permitidos);
+    if (sched_getaffinity(0, sizeof(permitidos), &permitidos) != 0) {
+        CPU_ZERO(&permitidos);
+        for (unsigned int c = 0; c < std::max(1u, std::thread::hardware_concurrency()); ++c) {
+            CPU_SET(c, &permitidos);
+        }
+    }
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (!CPU_ISSET(c, &permitidos)) {
+            continue;
+        }
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+        CPULogico cpu;
+        cpu.id = c;
+        cpu.nucleo = leerEnteroSysfs(base + "core_id", c);
+        cpu.paquete = leerEnteroSysfs(base + "physical_package_id", 0);
+        topologia.cpus.push_back(cpu);
+    }
+#elif defined(_WIN32)
+    DWORD_PTR mascara_proceso = 0;
+    DWORD_PTR mascara_sistema = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &mascara_proceso, &mascara_sistema);
+
+    // Cada entrada RelationProcessorCore agrupa los CPUs logicos de un nucleo fisico
+    DWORD longitud = 0;
+    GetLogicalProcessorInformation(nullptr, &longitud);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(longitud / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (!info.empty() && GetLogicalProcessorInformation(info.data(), &longitud)) {
+        int nucleo = 0;
+        for (const auto& entrada : info) {
+            if (entrada.Relationship != RelationProcessorCore) {
+                continue;
+            }
+            for (int c = 0; c < static_cast<int>(sizeof(ULONG_PTR) * 8); ++c) {
+                ULONG_PTR bit = static_cast<ULONG_PTR>(1) << c;
+                if ((entrada.ProcessorMask & bit) && (mascara_proceso & bit)) {
+                    CPULogico cpu;
+                    cpu.id = c;
+                    cpu.nucleo = nucleo;
+                    topologia.cpus.push_back(cpu);
+                }
+            }
+            nucleo++;
+        }
+    }
+#endif
+
+    // Sin informacion del sistema: un CPU logico por nucleo
+    if (topologia.cpus.empty()) {
+        unsigned int n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int c = 0; c < n; ++c) {
+            CPULogico cpu;
+            cpu.id = static_cast<int>(c);
+            cpu.nucleo = static_cast<int>(c);
+            topologia.cpus.push_back(cpu);
+        }
+    }
+
+    std::sort(topologia.cpus.begin(), topologia.cpus.end(), [](const CPULogico& a, const CPULogico& b) {
+        if (a.paquete != b.paquete) return a.paquete < b.paquete;
+        if (a.nucleo != b.nucleo) return a.nucleo < b.nucleo;
+        return a.id < b.id;
+    });
+    std::vector<std::pair<int, int>> nucleos;
+    std::vector<int> paquetes;
+    for (const CPULogico& cpu : topologia.cpus) {
+        nucleos.emplace_back(cpu.paquete, cpu.nucleo);
+        paquetes.push_back(cpu.paquete);
+    }
+    std::sort(nucleos.begin(), nucleos.end());
+    std::sort(paquetes.begin(), paquetes.end());
+    topologia.nucleos_fisicos = static_cast<int>(std::unique(nucleos.begin(), nucleos.end()) - nucleos.begin());
+    topologia.paquetes = static_cast<int>(std::unique(paquetes.begin(), paquetes.end()) - paquetes.begin());
+    return topologia;
+}
+
+// Topologia detectada una unica vez por proceso (antes de fijar ningun thread)
+inline const TopologiaCPU& topologiaCPU() {
+    static const TopologiaCPU topologia = detectarTopologiaCPU();
+    return topologia;
+}
+
+inline std::string describirTopologia(const TopologiaCPU& topologia) {
+    std::ostringstream oss;
+    oss << topologia.cpus.size() << " CPUs logicos, " << topologia.nucleos_fisicos << " nucleos fisicos, "
+        << topologia.paquetes << (topologia.paquetes == 1 ? " paquete" : " paquetes")
+        << " (" << topologia.hilosPorNucleo() << " hilos/nucleo)";
+    return oss.str();
+}
+
+// Orden en que se asignan los CPUs logicos a los threads 0, 1, 2...
+inline std::vector<int> ordenCPUs(const TopologiaCPU& topologia, DisposicionHilos disposicion) {
+    std::vector<int> orden;
+    if (disposicion == DisposicionHilos::Compacta) {
+        // La topologia ya esta ordenada por (paquete, nucleo, cpu)
+        for (const CPULogico& cpu : topologia.cpus) {
+            orden.push_back(cpu.id);
+        }
+    } else if (disposicion == DisposicionHilos::Dispersa) {
+        // Ronda r: el r-esimo hermano SMT de cada nucleo, alternando paquetes
+        std::vector<std::vector<std::vector<int>>> por_paquete;
+        int paquete_actual = -1;
+        int nucleo_actual = -1;
+        for (const CPULogico& cpu : topologia.cpus) {
+            if (cpu.paquete != paquete_actual) {
+                por_paquete.emplace_back();
+                paquete_actual = cpu.paquete;
+                nucleo_actual = -1;
+            }
+            if (cpu.nucleo != nucleo_actual) {
+                por_paquete.back().emplace_back();
+                nucleo_actual = cpu.nucleo;
+            }
+            por_paquete.back().back().push_back(cpu.id);
+        }
+        for (size_t ronda = 0; orden.size() < topologia.cpus.size(); ++ronda) {
+            for (size_t n = 0;; ++n) {
+                bool quedan_nucleos = false;
+                for (const auto& nucleos : por_paquete) {
+                    if (n < nucleos.size()) {
+                        quedan_nucleos = true;
+                        if (ronda < nucleos[n].size()) {
+                            orden.push_back(nucleos[n][ronda]);
+                        }
+                    }
+                }
+                if (!quedan_nucleos) {
+                    break;
+                }
+            }
+        }
+    }
+    return orden;
+}
+
+// Fija el thread que llama a un unico CPU logico. Devuelve false si el sistema lo rechaza.
+inline bool fijarHiloActualACPU(int cpu) {
+#if defined(__linux__)
+    cpu_set_t conjunto;
+    CPU_ZERO(&conjunto);
+    CPU_SET(cpu, &conjunto);
+    return pthread_setaffinity_np(pthread_self(), sizeof(conjunto), &conjunto) == 0;
+#elif defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Fija el thread de trabajo numero 'indice' segun la disposicion pedida
+inline void fijarTrabajador(int indice, DisposicionHilos disposicion) {
+    if (disposicion == DisposicionHilos::Ninguna) {
+        return;
+    }
+    static const std::vector<int> compacta = ordenCPUs(topologiaCPU(), DisposicionHilos::Compacta);
+    static const std::vector<int> dispersa = ordenCPUs(topologiaCPU(), DisposicionHilos::Dispersa);
+    const std::vector<int>& orden = (disposicion == DisposicionHilos::Compacta) ? compacta : dispersa;
+    if (!orden.empty()) {
+        fijarHiloActualACPU(orden[static_cast<size_t>(indice) % orden.size()]);
+    }
+}
+
+// Sube la prioridad del proceso. En Linux bajar el nice exige privilegios,
+// asi que un fallo no es un error: el programa sigue con la prioridad normal.
+inline bool elevarPrioridadProceso() {
+#if defined(_WIN32)
+    return SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS) != 0;
+#else
+    return setpriority(PRIO_PROCESS, 0, -10) == 0;
+#endif
+}
+
+#endif // PLATAFORMA_H
@@ -0,0 +1,182 @@
+#ifndef POOL_BUFFERS_H
+#define POOL_BUFFERS_H
+
+// Pool de buffers alineados a pagina que las etapas (copia, cifrado, hash,
+// comparacion, io_uring) piden prestados y devuelven en lugar de reservar un
+// std::vector por llamada. Cada thread tiene su propia reserva de buffers
+// libres: pedir y devolver no toma ningun lock ni llama a malloc, asi que con
+// muchos threads no hay contencion en el asignador. Tras el primer archivo de
+// cada thread el lote funciona sin reservas de memoria para los bloques.
+// Los buffers de 2 MiB o mas se alinean a 2 MiB y se marcan para paginas
+// enormes transparentes (Linux), lo que ahorra fallos de TLB.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+const size_t ALINEACION_PAGINA = 4096;
+const size_t TAM_PAGINA_ENORME = 2 * 1024 * 1024;
+
+// Memoria propia de un buffer alineado (sin copia, solo se mueve)
+class BufferAlineado {
+public:
+    BufferAlineado() = default;
+
+    explicit BufferAlineado(size_t capacidad) {
+        size_t alineacion = capacidad >= TAM_PAGINA_ENORME ? TAM_PAGINA_ENORME : ALINEACION_PAGINA;
+        capacidad = (capacidad + alineacion - 1) / alineacion * alineacion;
+#if defined(_WIN32)
+        datos_ = static_cast<char*>(_aligned_malloc(capacidad, alineacion));
+#else
+        void* memoria = nullptr;
+        if (posix_memalign(&memoria, alineacion, capacidad) == 0) {
+            datos_ = static_cast<char*>(memoria);
+        }
+#if defined(MADV_HUGEPAGE)
+        if (datos_ != nullptr && alineacion == TAM_PAGINA_ENORME) {
+            ::madvise(datos_, capacidad, MADV_HUGEPAGE);
+        }
+#endif
+#endif
+        if (datos_ == nullptr) {
+            throw std::bad_alloc();
+        }
+        capacidad_ = capacidad;
+    }
+
+    ~BufferAlineado() { liberar(); }
+
+    BufferAlineado(BufferAlineado&& otro) noexcept : datos_(otro.datos_), capacidad_(otro.capacidad_) {
+        otro.datos_ = nullptr;
+        otro.capacidad_ = 0;
+    }
+
+    BufferAlineado& operator=(BufferAlineado&& otro) noexcept {
+        if (this != &otro) {
+            liberar();
+            datos_ = otro.datos_;
+            capacidad_ = otro.capacidad_;
+            otro.datos_ = nullptr;
+            otro.capacidad_ = 0;
+        }
+        return *this;
+    }
+
+    BufferAlineado(const BufferAlineado&) = delete;
+    BufferAlineado& operator=(const BufferAlineado&) = delete;
+
+    char* datos() const { return datos_; }
+    size_t capacidad() const { return capacidad_; }
+
+private:
+    void liberar() {
+#if defined(_WIN32)
+        _aligned_free(datos_);
+#else
+        std::free(datos_);
+#endif
+        datos_ = nullptr;
+        capacidad_ = 0;
+    }
+
+    char* datos_ = nullptr;
+    size_t capacidad_ = 0;
+};
+
+// Reservas hechas por el pool en todo el proceso (para comprobar que el lote
+// no reserva memoria en regimen estacionario)
+struct EstadisticasPoolBuffers {
+    std::atomic<uint64_t> reservas{0};
+    std::atomic<uint64_t> bytes_reservados{0};
+};
+
+inline EstadisticasPoolBuffers& estadisticasPoolBuffers() {
+    static EstadisticasPoolBuffers estadisticas;
+    return estadisticas;
+}
+
+// Buffers libres de un thread. Se guardan como mucho MAX_LIBRES; al devolver
+// uno de mas se libera el mas pequeño.
+class PoolBuffersHilo {
+public:
+    static constexpr size_t MAX_LIBRES = 24;
+
+    PoolBuffersHilo() { libres.reserve(MAX_LIBRES + 1); }
+
+    static PoolBuffersHilo& delHilo() {
+        thread_local PoolBuffersHilo pool;
+        return pool;
+    }
+
+    // El libre mas pequeño que alcance; si no hay, uno nuevo
+    BufferAlineado pedir(size_t minimo) {
+        if (minimo == 0) {
+            return BufferAlineado();
+        }
+        size_t elegido = libres.size();
+        for (size_t k = 0; k < libres.size(); ++k) {
+            if (libres[k].capacidad() >= minimo && (elegido == libres.size() || libres[k].capacidad() < libres[elegido].capacidad())) {
+                elegido = k;
+            }
+        }
+        if (elegido < libres.size()) {
+            BufferAlineado buffer = std::move(libres[elegido]);
+            libres[elegido] = std::move(libres.back());
+            libres.pop_back();
+            return buffer;
+        }
+        BufferAlineado buffer(minimo);
+        EstadisticasPoolBuffers& e = estadisticasPoolBuffers();
+        e.reservas.fetch_add(1, std::memory_order_relaxed);
+        e.bytes_reservados.fetch_add(buffer.capacidad(), std::memory_order_relaxed);
+        return buffer;
+    }
+
+    void devolver(BufferAlineado&& buffer) {
+        if (buffer.datos() == nullptr) {
+            return;
+        }
+        libres.push_back(std::move(buffer));
+        if (libres.size() > MAX_LIBRES) {
+            auto menor = std::min_element(libres.begin(), libres.end(), [](const BufferAlineado& a, const BufferAlineado& b) {
+                return a.capacidad() < b.capacidad();
+            });
+            *menor = std::move(libres.back());
+            libres.pop_back();
+        }
+    }
+
+private:
+    std::vector<BufferAlineado> libres;
+};
+
+// Prestamo RAII de un buffer del pool del thread actual. Se devuelve al
+// destruirse, asi que debe destruirse en el mismo thread que lo pidio (todas
+// las etapas lo usan dentro de una sola funcion).
+class BufferPrestado {
+public:
+    explicit BufferPrestado(size_t tam) : buffer(PoolBuffersHilo::delHilo().pedir(tam)), tam_(tam) {}
+    ~BufferPrestado() { PoolBuffersHilo::delHilo().devolver(std::move(buffer)); }
+
+    BufferPrestado(const BufferPrestado&) = delete;
+    BufferPrestado& operator=(const BufferPrestado&) = delete;
+
+    char* data() const { return buffer.datos(); }
+    size_t size() const { return tam_; }
+
+private:
+    BufferAlineado buffer;
+    size_t tam_;
+};
+
+#endif // POOL_BUFFERS_H
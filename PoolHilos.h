@@ -0,0 +1,260 @@
+#ifndef POOL_HILOS_H
+#define POOL_HILOS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pool con un numero fijo de threads y una cola doble por thread.
+// Cada thread toma trabajo del final de su propia cola (LIFO, lo mas reciente
+// sigue caliente en cache) y, cuando se queda sin trabajo, roba del principio
+// de las colas de los demas (FIFO, las tareas mas antiguas y grandes).
+// Las tareas encoladas desde un thread del pool van a su propia cola, de modo
+// que los trozos de un archivo se quedan cerca del thread que los genero.
+class PoolHilos {
+public:
+    typedef std::function<void()> Tarea;
+
+    // 'al_iniciar' se ejecuta en cada thread al arrancar con su indice (p. ej. para fijarlo a un CPU)
+    explicit PoolHilos(unsigned int num_hilos, std::function<void(unsigned int)> al_iniciar = nullptr)
+        : colas(num_hilos > 0 ? num_hilos : 1) {
+        for (auto& cola : colas) {
+            cola.reset(new ColaTrabajo());
+        }
+        for (unsigned int i = 0; i < colas.size(); ++i) {
+            hilos.emplace_back([this, i, al_iniciar]() {
+                if (al_iniciar) {
+                    al_iniciar(i);
+                }
+                bucleTrabajador(i);
+            });
+        }
+    }
+
+    // Termina las tareas pendientes y espera a todos los threads
+    ~PoolHilos() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_espera);
+            detener = true;
+        }
+        cv_trabajo.notify_all();
+        for (auto& hilo : hilos) {
+            hilo.join();
+        }
+    }
+
+    PoolHilos(const PoolHilos&) = delete;
+    PoolHilos& operator=(const PoolHilos&) = delete;
+
+    unsigned int numHilos() const { return static_cast<unsigned int>(hilos.size()); }
+
+    void encolar(Tarea tarea) {
+        size_t destino;
+        if (pool_actual == this) {
+            destino = indice_actual;
+        } else {
+            destino = siguiente_cola.fetch_add(1, std::memory_order_relaxed) % colas.size();
+        }
+        // Se cuenta antes de publicarla para que el contador nunca quede por debajo de cero
+        {
+            std::lock_guard<std::mutex> lock(mtx_espera);
+            pendientes++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(colas[destino]->mtx);
+            colas[destino]->tareas.push_back(std::move(tarea));
+        }
+        cv_trabajo.notify_one();
+    }
+
+    // Ejecuta una tarea pendiente en el thread que llama, si la hay. Lo usan
+    // quienes esperan a un grupo para ayudar en lugar de bloquearse.
+    bool ejecutarPendiente() {
+        size_t propia = (pool_actual == this) ? indice_actual : 0;
+        Tarea tarea;
+        if (!tomarTarea(propia, tarea)) {
+            return false;
+        }
+        tarea();
+        return true;
+    }
+
+private:
+    struct ColaTrabajo {
+        std::mutex mtx;
+        std::deque<Tarea> tareas;
+    };
+
+    bool tomarTarea(size_t propia, Tarea& tarea) {
+        // Primero la cola propia por el final...
+        {
+            ColaTrabajo& cola = *colas[propia];
+            std::lock_guard<std::mutex> lock(cola.mtx);
+            if (!cola.tareas.empty()) {
+                tarea = std::move(cola.tareas.back());
+                cola.tareas.pop_back();
+                restarPendiente();
+                return true;
+            }
+        }
+        // ...y si esta vacia, robar del principio de las demas
+        for (size_t k = 1; k < colas.size(); ++k) {
+            ColaTrabajo& victima = *colas[(propia + k) % colas.size()];
+            std::lock_guard<std::mutex> lock(victima.mtx);
+            if (!victima.tareas.empty()) {
+                tarea = std::move(victima.tareas.front());
+                victima.tareas.pop_front();
+                restarPendiente();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void restarPendiente() {
+        std::lock_guard<std::mutex> lock(mtx_espera);
+        pendientes--;
+    }
+
+    void bucleTrabajador(unsigned int indice) {
+        pool_actual = this;
+        indice_actual = indice;
+        Tarea tarea;
+        while (true) {
+            if (tomarTarea(indice, tarea)) {
+                tarea();
+                tarea = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mtx_espera);
+            cv_trabajo.wait(lock, [this]() { return pendientes > 0 || detener; });
+            if (detener && pendientes == 0) {
+                break;
+            }
+        }
+        pool_actual = nullptr;
+    }
+
+    std::vector<std::unique_ptr<ColaTrabajo>> colas;
+    std::vector<std::thread> hilos;
+    std::atomic<size_t> siguiente_cola{0};
+
+    std::mutex mtx_espera;              // Protege 'pendientes' y 'detener'
+    std::condition_variable cv_trabajo;
+    size_t pendientes = 0;              // Tareas encoladas aun no tomadas
+    bool detener = false;
+
+    inline static thread_local PoolHilos* pool_actual = nullptr;
+    inline static thread_local size_t indice_actual = 0;
+};
+
+// Conjunto de tareas lanzadas al pool que se esperan juntas. Quien espera
+// ejecuta tareas pendientes mientras tanto, asi que un trabajo del pool puede
+// repartir sus trozos y esperarlos sin dejar su thread ocioso ni bloquear el pool.
+// Si una tarea lanza una excepcion, el grupo la guarda (la primera) y esperar()
+// la relanza cuando han terminado todas; el destructor solo espera.
+class GrupoTareas {
+public:
+    explicit GrupoTareas(PoolHilos& pool) : pool(pool) {}
+    ~GrupoTareas() { esperarTodas(); }
+
+    GrupoTareas(const GrupoTareas&) = delete;
+    GrupoTareas& operator=(const GrupoTareas&) = delete;
+
+    void lanzar(std::function<void()> tarea) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            sin_terminar++;
+        }
+        pool.encolar([this, tarea]() {
+            std::exception_ptr fallo;
+            try {
+                tarea();
+            } catch (...) {
+                fallo = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            if (fallo && !primer_fallo) {
+                primer_fallo = fallo;
+            }
+            if (--sin_terminar == 0) {
+                cv_terminado.notify_all();
+            }
+        });
+    }
+
+    void esperar() {
+        esperarTodas();
+        std::exception_ptr fallo;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::swap(fallo, primer_fallo);
+        }
+        if (fallo) {
+            std::rethrow_exception(fallo);
+        }
+    }
+
+private:
+    void esperarTodas() {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (sin_terminar == 0) {
+                    return;
+                }
+            }
+            if (!pool.ejecutarPendiente()) {
+                // Lo que queda del grupo ya se esta ejecutando en otros threads
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_terminado.wait(lock, [this]() { return sin_terminar == 0; });
+                return;
+            }
+        }
+    }
+
+    PoolHilos& pool;
+    std::mutex mtx;
+    std::condition_variable cv_terminado;
+    size_t sin_terminar = 0;
+    std::exception_ptr primer_fallo;
+};
+
+// Una tarea que lanza no debe dejar el grupo esperando para siempre: el
+// resto termina y esperar() relanza la excepcion
+inline bool verificarGrupoTareas(std::string& detalle) {
+    PoolHilos pool(2);
+    std::atomic<int> hechas{0};
+    GrupoTareas grupo(pool);
+    for (int i = 0; i < 16; ++i) {
+        grupo.lanzar([i, &hechas]() {
+            if (i == 5) {
+                throw std::runtime_error("tarea 5");
+            }
+            hechas++;
+        });
+    }
+    try {
+        grupo.esperar();
+        detalle = "esperar() no relanzo la excepcion de la tarea";
+        return false;
+    } catch (const std::runtime_error&) {
+        // Esperado
+    }
+    if (hechas.load() != 15) {
+        detalle = "solo terminaron " + std::to_string(hechas.load()) + " de 15 tareas";
+        return false;
+    }
+    grupo.esperar();    // Ya relanzada: una segunda espera no falla
+    return true;
+}
+
+#endif // POOL_HILOS_H
@@ -2,39 +2,94 @@
 #define SHA256_H
 
 #include <string>
-#include <vector>
-#include <sstream>
-#include <iomanip>
+#include <cstring>
 #include <cstdint>
+#include <immintrin.h>
+
+#include "CapacidadesCPU.h"
 
 class SHA256 {
+public:
+    // Implementaciones disponibles de la funcion de compresion
+    enum class Backend {
+        Escalar,    // Implementacion de referencia
+        SSSE3,      // Message schedule vectorizado (4 palabras por instruccion)
+        AVX2,       // Message schedule de dos bloques a la vez
+        SHANI       // Extensiones SHA de Intel/AMD
+    };
+    
+    // Procesa 'nbloques' bloques consecutivos de 64 bytes sobre el estado 'h'
+    typedef void (*FuncionCompresion)(uint32_t h[8], const uint8_t* data, size_t nbloques);
+    
 private:
+    friend class SHA256Lote;    // Reutiliza constantes y estado para el hash multi-buffer
+    
     static const uint32_t k[];
     static const uint32_t sha256_h[];
     
-    uint32_t rotr(uint32_t x, int n) {
+    static uint32_t rotr(uint32_t x, int n) {
         return (x >> n) | (x << (32 - n));
     }
     
-    uint32_t choose(uint32_t x, uint32_t y, uint32_t z) {
+    static uint32_t choose(uint32_t x, uint32_t y, uint32_t z) {
         return (x & y) ^ (~x & z);
     }
     
-    uint32_t majority(uint32_t x, uint32_t y, uint32_t z) {
+    static uint32_t majority(uint32_t x, uint32_t y, uint32_t z) {
         return (x & y) ^ (x & z) ^ (y & z);
     }
     
-    uint32_t sig0(uint32_t x) {
+    static uint32_t sig0(uint32_t x) {
         return rotr(x, 2) ^ rotr(x, 13) ^ rotr(x, 22);
     }
     
-    uint32_t sig1(uint32_t x) {
+    static uint32_t sig1(uint32_t x) {
         return rotr(x, 6) ^ rotr(x, 11) ^ rotr(x, 25);
     }
     
-    void transform(const uint8_t* data, uint32_t h[8]);
+    static void transform(const uint8_t* data, uint32_t h[8]);
+    static void rondas(uint32_t h[8], const uint32_t wk[64]);
+    
+    // Backends de compresion (todos producen exactamente el mismo resultado)
+    static void compresionEscalar(uint32_t h[8], const uint8_t* data, size_t nbloques);
+    static void compresionSSSE3(uint32_t h[8], const uint8_t* data, size_t nbloques);
+    static void compresionAVX2(uint32_t h[8], const uint8_t* data, size_t nbloques);
+    static void compresionSHANI(uint32_t h[8], const uint8_t* data, size_t nbloques);
+    
+    FuncionCompresion compresion;
+    
+    // Estado del hash incremental
+    uint32_t estado[8];
+    uint8_t bloque[64];     // Bloque parcial pendiente de procesar
+    size_t bloque_len;      // Bytes validos en 'bloque'
+    uint64_t total_bytes;   // Longitud total del mensaje procesado
     
 public:
+    static const size_t DIGEST_SIZE = 32;
+    static const size_t BLOCK_SIZE = 64;
+    
+    SHA256() : compresion(funcionCompresion(backendActivo())) { reset(); }
+    explicit SHA256(Backend backend) : compresion(funcionCompresion(backend)) { reset(); }
+    
+    // Seleccion del backend: se elige una sola vez al arrancar segun cpuid
+    static bool backendDisponible(Backend backend);
+    static Backend backendActivo();
+    static const char* nombreBackend(Backend backend);
+    static FuncionCompresion funcionCompresion(Backend backend);
+    
+    // Verifica con vectores conocidos que todos los backends disponibles
+    // coinciden; en caso de fallo 'detalle' describe el primer error
+    static bool verificarBackends(std::string& detalle);
+    
+    // API incremental: reset() -> update()* -> finalize()
+    void reset();
+    void update(const void* data, size_t len);
+    void finalize(uint8_t digest[DIGEST_SIZE]);
+    
+    // Convierte un digest binario de 32 bytes a hexadecimal (64 caracteres)
+    static std::string toHex(const uint8_t digest[DIGEST_SIZE]);
+    
+    // Hash de un string completo en memoria (compatibilidad)
     std::string operator()(const std::string& input);
 };
 
@@ -107,39 +162,399 @@ void SHA256::transform(const uint8_t* data, uint32_t h[8]) {
     h[4] += e; h[5] += f; h[6] += g; h[7] += h_local;
 }
 
-std::string SHA256::operator()(const std::string& input) {
-    std::vector<uint8_t> data(input.begin(), input.end());
-    uint64_t bit_len = data.size() * 8;
+// Rondas de compresion a partir del message schedule ya sumado con k (w[i] + k[i])
+void SHA256::rondas(uint32_t h[8], const uint32_t wk[64]) {
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], h_local = h[7];
     
-    // Padding
-    data.push_back(0x80);
-    while (data.size() % 64 != 56) {
-        data.push_back(0x00);
+    // Desenrollado de 8 rondas rotando los nombres en lugar de mover valores
+#define SHA256_RONDA(a, b, c, d, e, f, g, h, i) do {                   \
+        uint32_t temp1 = h + sig1(e) + choose(e, f, g) + wk[i];        \
+        d += temp1;                                                    \
+        h = temp1 + sig0(a) + majority(a, b, c);                       \
+    } while (0)
+    
+    for (int i = 0; i < 64; i += 8) {
+        SHA256_RONDA(a, b, c, d, e, f, g, h_local, i);
+        SHA256_RONDA(h_local, a, b, c, d, e, f, g, i + 1);
+        SHA256_RONDA(g, h_local, a, b, c, d, e, f, i + 2);
+        SHA256_RONDA(f, g, h_local, a, b, c, d, e, i + 3);
+        SHA256_RONDA(e, f, g, h_local, a, b, c, d, i + 4);
+        SHA256_RONDA(d, e, f, g, h_local, a, b, c, i + 5);
+        SHA256_RONDA(c, d, e, f, g, h_local, a, b, i + 6);
+        SHA256_RONDA(b, c, d, e, f, g, h_local, a, i + 7);
     }
+#undef SHA256_RONDA
     
-    // Añadir longitud
-    for (int i = 7; i >= 0; i--) {
-        data.push_back((bit_len >> (i * 8)) & 0xff);
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += h_local;
+}
+
+void SHA256::compresionEscalar(uint32_t h[8], const uint8_t* data, size_t nbloques) {
+    for (size_t i = 0; i < nbloques; i++) {
+        transform(data + i * BLOCK_SIZE, h);
     }
+}
+
+// --- Message schedule vectorizado ---
+// Cada paso calcula w[i..i+3] a partir de los 16 anteriores. Las dos palabras
+// altas dependen de las dos bajas recien calculadas (sigma1 de w[i-2]), por eso
+// sigma1 se aplica en dos mitades. Con AVX2 las mismas operaciones trabajan por
+// carril de 128 bits, asi que cada carril lleva el schedule de un bloque distinto.
+
+SO_TARGET("ssse3")
+static inline __m128i sha256RotrSSE(__m128i x, int n) {
+    return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+}
+
+SO_TARGET("ssse3")
+static inline __m128i sha256ScheduleSSE(__m128i w0, __m128i w1, __m128i w2, __m128i w3) {
+    // w0 = w[i-16..i-13], w1 = w[i-12..i-9], w2 = w[i-8..i-5], w3 = w[i-4..i-1]
+    __m128i w15 = _mm_alignr_epi8(w1, w0, 4);   // w[i-15..i-12]
+    __m128i w7 = _mm_alignr_epi8(w3, w2, 4);    // w[i-7..i-4]
+    __m128i s0 = _mm_xor_si128(_mm_xor_si128(sha256RotrSSE(w15, 7), sha256RotrSSE(w15, 18)),
+                               _mm_srli_epi32(w15, 3));
+    __m128i t = _mm_add_epi32(_mm_add_epi32(w0, s0), w7);
+    
+    // sigma1 de w[i-2], w[i-1] para las dos palabras bajas
+    __m128i x = _mm_shuffle_epi32(w3, _MM_SHUFFLE(3, 3, 3, 2));
+    __m128i s1 = _mm_xor_si128(_mm_xor_si128(sha256RotrSSE(x, 17), sha256RotrSSE(x, 19)),
+                               _mm_srli_epi32(x, 10));
+    t = _mm_add_epi32(t, _mm_and_si128(s1, _mm_set_epi32(0, 0, -1, -1)));
+    
+    // sigma1 de las dos palabras recien calculadas para las dos altas
+    x = _mm_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 0, 0));
+    s1 = _mm_xor_si128(_mm_xor_si128(sha256RotrSSE(x, 17), sha256RotrSSE(x, 19)),
+                       _mm_srli_epi32(x, 10));
+    return _mm_add_epi32(t, _mm_and_si128(s1, _mm_set_epi32(-1, -1, 0, 0)));
+}
+
+SO_TARGET("avx2")
+static inline __m256i sha256RotrAVX2(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+SO_TARGET("avx2")
+static inline __m256i sha256ScheduleAVX2(__m256i w0, __m256i w1, __m256i w2, __m256i w3) {
+    __m256i w15 = _mm256_alignr_epi8(w1, w0, 4);
+    __m256i w7 = _mm256_alignr_epi8(w3, w2, 4);
+    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha256RotrAVX2(w15, 7), sha256RotrAVX2(w15, 18)),
+                                  _mm256_srli_epi32(w15, 3));
+    __m256i t = _mm256_add_epi32(_mm256_add_epi32(w0, s0), w7);
+    
+    __m256i x = _mm256_shuffle_epi32(w3, _MM_SHUFFLE(3, 3, 3, 2));
+    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha256RotrAVX2(x, 17), sha256RotrAVX2(x, 19)),
+                                  _mm256_srli_epi32(x, 10));
+    t = _mm256_add_epi32(t, _mm256_and_si256(s1, _mm256_set_epi32(0, 0, -1, -1, 0, 0, -1, -1)));
+    
+    x = _mm256_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 0, 0));
+    s1 = _mm256_xor_si256(_mm256_xor_si256(sha256RotrAVX2(x, 17), sha256RotrAVX2(x, 19)),
+                          _mm256_srli_epi32(x, 10));
+    return _mm256_add_epi32(t, _mm256_and_si256(s1, _mm256_set_epi32(-1, -1, 0, 0, -1, -1, 0, 0)));
+}
+
+SO_TARGET("ssse3")
+void SHA256::compresionSSSE3(uint32_t h[8], const uint8_t* data, size_t nbloques) {
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    alignas(16) uint32_t wk[64];
+    
+    for (size_t b = 0; b < nbloques; b++, data += BLOCK_SIZE) {
+        __m128i w[4];
+        for (int i = 0; i < 4; i++) {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), bswap);
+            _mm_store_si128((__m128i*)&wk[i * 4],
+                            _mm_add_epi32(w[i], _mm_loadu_si128((const __m128i*)&k[i * 4])));
+        }
+        for (int i = 4; i < 16; i++) {
+            __m128i nuevo = sha256ScheduleSSE(w[0], w[1], w[2], w[3]);
+            w[0] = w[1]; w[1] = w[2]; w[2] = w[3]; w[3] = nuevo;
+            _mm_store_si128((__m128i*)&wk[i * 4],
+                            _mm_add_epi32(nuevo, _mm_loadu_si128((const __m128i*)&k[i * 4])));
+        }
+        rondas(h, wk);
+    }
+}
+
+SO_TARGET("avx2")
+void SHA256::compresionAVX2(uint32_t h[8], const uint8_t* data, size_t nbloques) {
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    alignas(32) uint32_t wk[2][64];
+    
+    // Pares de bloques: el carril bajo lleva el primero y el alto el segundo
+    for (; nbloques >= 2; nbloques -= 2, data += 2 * BLOCK_SIZE) {
+        __m256i w[4];
+        for (int i = 0; i < 4; i++) {
+            __m256i par = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(data + i * 16))),
+                _mm_loadu_si128((const __m128i*)(data + BLOCK_SIZE + i * 16)), 1);
+            w[i] = _mm256_shuffle_epi8(par, bswap);
+            __m256i kv = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&k[i * 4]));
+            __m256i suma = _mm256_add_epi32(w[i], kv);
+            _mm_store_si128((__m128i*)&wk[0][i * 4], _mm256_castsi256_si128(suma));
+            _mm_store_si128((__m128i*)&wk[1][i * 4], _mm256_extracti128_si256(suma, 1));
+        }
+        for (int i = 4; i < 16; i++) {
+            __m256i nuevo = sha256ScheduleAVX2(w[0], w[1], w[2], w[3]);
+            w[0] = w[1]; w[1] = w[2]; w[2] = w[3]; w[3] = nuevo;
+            __m256i kv = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&k[i * 4]));
+            __m256i suma = _mm256_add_epi32(nuevo, kv);
+            _mm_store_si128((__m128i*)&wk[0][i * 4], _mm256_castsi256_si128(suma));
+            _mm_store_si128((__m128i*)&wk[1][i * 4], _mm256_extracti128_si256(suma, 1));
+        }
+        rondas(h, wk[0]);
+        rondas(h, wk[1]);
+    }
+    
+    // Bloque impar restante
+    if (nbloques > 0) {
+        compresionSSSE3(h, data, nbloques);
+    }
+}
+
+SO_TARGET("sha,sse4.1,ssse3")
+void SHA256::compresionSHANI(uint32_t h[8], const uint8_t* data, size_t nbloques) {
+    const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
     
-    // Inicializar hash
-    uint32_t h[8];
+    // Reordenar el estado a la disposicion que usan las instrucciones (ABEF / CDGH)
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[0]), 0xB1);     // CDAB
+    __m128i estado1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&h[4]), 0x1B); // EFGH
+    __m128i estado0 = _mm_alignr_epi8(tmp, estado1, 8);                                // ABEF
+    estado1 = _mm_blend_epi16(estado1, tmp, 0xF0);                                     // CDGH
+    
+    for (size_t b = 0; b < nbloques; b++, data += BLOCK_SIZE) {
+        __m128i abef_previo = estado0;
+        __m128i cdgh_previo = estado1;
+        __m128i msg[4];
+        
+        // 16 grupos de 4 rondas; msg[j % 4] contiene w[4j..4j+3]
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC unroll 16
+#endif
+        for (int j = 0; j < 16; j++) {
+            if (j < 4) {
+                msg[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + j * 16)), bswap);
+            }
+            __m128i& actual = msg[j & 3];
+            __m128i wk = _mm_add_epi32(actual, _mm_loadu_si128((const __m128i*)&k[j * 4]));
+            estado1 = _mm_sha256rnds2_epu32(estado1, estado0, wk);
+            if (j >= 3 && j < 15) {
+                __m128i& siguiente = msg[(j + 1) & 3];
+                siguiente = _mm_add_epi32(siguiente, _mm_alignr_epi8(actual, msg[(j + 3) & 3], 4));
+                siguiente = _mm_sha256msg2_epu32(siguiente, actual);
+            }
+            estado0 = _mm_sha256rnds2_epu32(estado0, estado1, _mm_shuffle_epi32(wk, 0x0E));
+            if (j >= 1 && j < 13) {
+                __m128i& anterior = msg[(j + 3) & 3];
+                anterior = _mm_sha256msg1_epu32(anterior, actual);
+            }
+        }
+        
+        estado0 = _mm_add_epi32(estado0, abef_previo);
+        estado1 = _mm_add_epi32(estado1, cdgh_previo);
+    }
+    
+    // Volver al orden ABCD / EFGH
+    tmp = _mm_shuffle_epi32(estado0, 0x1B);                 // FEBA
+    estado1 = _mm_shuffle_epi32(estado1, 0xB1);             // DCHG
+    estado0 = _mm_blend_epi16(tmp, estado1, 0xF0);          // DCBA
+    estado1 = _mm_alignr_epi8(estado1, tmp, 8);             // HGFE
+    _mm_storeu_si128((__m128i*)&h[0], estado0);
+    _mm_storeu_si128((__m128i*)&h[4], estado1);
+}
+
+bool SHA256::backendDisponible(Backend backend) {
+    const CapacidadesCPU& caps = capacidadesCPU();
+    switch (backend) {
+        case Backend::Escalar: return true;
+        case Backend::SSSE3:   return caps.ssse3;
+        case Backend::AVX2:    return caps.avx2;
+        case Backend::SHANI:   return caps.sha && caps.sse41 && caps.ssse3;
+    }
+    return false;
+}
+
+SHA256::Backend SHA256::backendActivo() {
+    static const Backend elegido = []() {
+        if (backendDisponible(Backend::SHANI)) return Backend::SHANI;
+        if (backendDisponible(Backend::AVX2)) return Backend::AVX2;
+        if (backendDisponible(Backend::SSSE3)) return Backend::SSSE3;
+        return Backend::Escalar;
+    }();
+    return elegido;
+}
+
+const char* SHA256::nombreBackend(Backend backend) {
+    switch (backend) {
+        case Backend::Escalar: return "escalar";
+        case Backend::SSSE3:   return "SSSE3";
+        case Backend::AVX2:    return "AVX2";
+        case Backend::SHANI:   return "SHA-NI";
+    }
+    return "desconocido";
+}
+
+SHA256::FuncionCompresion SHA256::funcionCompresion(Backend backend) {
+    // Si se pide un backend no soportado se usa la referencia escalar
+    if (!backendDisponible(backend)) {
+        return compresionEscalar;
+    }
+    switch (backend) {
+        case Backend::Escalar: return compresionEscalar;
+        case Backend::SSSE3:   return compresionSSSE3;
+        case Backend::AVX2:    return compresionAVX2;
+        case Backend::SHANI:   return compresionSHANI;
+    }
+    return compresionEscalar;
+}
+
+bool SHA256::verificarBackends(std::string& detalle) {
+    // Vectores de prueba de FIPS 180-2
+    struct VectorConocido {
+        std::string mensaje;
+        const char* hash;
+    };
+    const VectorConocido vectores[] = {
+        { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+        { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+          "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" },
+        { std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+    };
+    const Backend backends[] = { Backend::Escalar, Backend::SSSE3, Backend::AVX2, Backend::SHANI };
+    
+    // Mensaje pseudoaleatorio para comparar backends con longitudes y cortes variados
+    std::string aleatorio(4096 + 77, '\0');
+    uint32_t semilla = 0x12345678;
+    for (size_t i = 0; i < aleatorio.size(); i++) {
+        semilla = semilla * 1664525u + 1013904223u;
+        aleatorio[i] = static_cast<char>(semilla >> 24);
+    }
+    
+    for (Backend backend : backends) {
+        if (!backendDisponible(backend)) {
+            continue;
+        }
+        SHA256 sha(backend);
+        for (const VectorConocido& v : vectores) {
+            if (sha(v.mensaje) != v.hash) {
+                detalle = std::string("backend ") + nombreBackend(backend) +
+                          ": hash incorrecto para mensaje de " + std::to_string(v.mensaje.size()) + " bytes";
+                return false;
+            }
+        }
+        
+        SHA256 referencia(Backend::Escalar);
+        for (size_t len = 0; len <= aleatorio.size(); len += (len < 300 ? 1 : 131)) {
+            // Trocear la entrada en partes de tamaño variable para ejercitar update()
+            uint8_t d1[DIGEST_SIZE], d2[DIGEST_SIZE];
+            size_t pos = 0, paso = 1 + len % 200;
+            while (pos < len) {
+                size_t n = (len - pos < paso) ? len - pos : paso;
+                sha.update(aleatorio.data() + pos, n);
+                pos += n;
+                paso = paso * 3 % 517 + 1;
+            }
+            sha.finalize(d1);
+            referencia.update(aleatorio.data(), len);
+            referencia.finalize(d2);
+            if (std::memcmp(d1, d2, DIGEST_SIZE) != 0) {
+                detalle = std::string("backend ") + nombreBackend(backend) +
+                          ": difiere de la referencia escalar con " + std::to_string(len) + " bytes";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void SHA256::reset() {
     for (int i = 0; i < 8; i++) {
-        h[i] = sha256_h[i];
+        estado[i] = sha256_h[i];
+    }
+    bloque_len = 0;
+    total_bytes = 0;
+}
+
+void SHA256::update(const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    total_bytes += len;
+    
+    // Completar el bloque parcial pendiente
+    if (bloque_len > 0) {
+        size_t faltan = BLOCK_SIZE - bloque_len;
+        size_t n = (len < faltan) ? len : faltan;
+        std::memcpy(bloque + bloque_len, p, n);
+        bloque_len += n;
+        p += n;
+        len -= n;
+        if (bloque_len < BLOCK_SIZE) {
+            return;
+        }
+        compresion(estado, bloque, 1);
+        bloque_len = 0;
+    }
+    
+    // Procesar todos los bloques completos directamente desde la entrada, sin copiar
+    size_t nbloques = len / BLOCK_SIZE;
+    if (nbloques > 0) {
+        compresion(estado, p, nbloques);
+        p += nbloques * BLOCK_SIZE;
+        len -= nbloques * BLOCK_SIZE;
+    }
+    
+    // Guardar el resto para la siguiente llamada
+    if (len > 0) {
+        std::memcpy(bloque, p, len);
+        bloque_len = len;
     }
+}
+
+void SHA256::finalize(uint8_t digest[DIGEST_SIZE]) {
+    uint64_t bit_len = total_bytes * 8;
     
-    // Procesar en bloques de 512 bits
-    for (size_t i = 0; i < data.size(); i += 64) {
-        transform(&data[i], h);
+    // Padding: 0x80, ceros hasta 56 mod 64 y longitud en big-endian
+    bloque[bloque_len++] = 0x80;
+    if (bloque_len > 56) {
+        std::memset(bloque + bloque_len, 0, BLOCK_SIZE - bloque_len);
+        compresion(estado, bloque, 1);
+        bloque_len = 0;
     }
+    std::memset(bloque + bloque_len, 0, 56 - bloque_len);
+    for (int i = 0; i < 8; i++) {
+        bloque[56 + i] = (bit_len >> ((7 - i) * 8)) & 0xff;
+    }
+    compresion(estado, bloque, 1);
     
-    // Convertir a string hexadecimal
-    std::stringstream ss;
     for (int i = 0; i < 8; i++) {
-        ss << std::hex << std::setw(8) << std::setfill('0') << h[i];
+        digest[i * 4]     = (estado[i] >> 24) & 0xff;
+        digest[i * 4 + 1] = (estado[i] >> 16) & 0xff;
+        digest[i * 4 + 2] = (estado[i] >> 8) & 0xff;
+        digest[i * 4 + 3] = estado[i] & 0xff;
     }
     
-    return ss.str();
+    // Dejar el objeto listo para un nuevo mensaje
+    reset();
+}
+
+std::string SHA256::toHex(const uint8_t digest[DIGEST_SIZE]) {
+    static const char hex[] = "0123456789abcdef";
+    std::string resultado(DIGEST_SIZE * 2, '0');
+    for (size_t i = 0; i < DIGEST_SIZE; i++) {
+        resultado[i * 2] = hex[digest[i] >> 4];
+        resultado[i * 2 + 1] = hex[digest[i] & 0x0f];
+    }
+    return resultado;
+}
+
+std::string SHA256::operator()(const std::string& input) {
+    uint8_t digest[DIGEST_SIZE];
+    reset();
+    update(input.data(), input.size());
+    finalize(digest);
+    return toHex(digest);
 }
 
 #endif // SHA256_H 
\ No newline at end of file
@@ -0,0 +1,622 @@
+#ifndef SHA256_LOTE_H
+#define SHA256_LOTE_H
+
+// Hash SHA-256 multi-buffer: calcula varios mensajes independientes a la vez,
+// uno por carril SIMD (4 con SSE2, 8 con AVX2, 16 con AVX-512). Cuando un
+// mensaje termina, su carril se rellena con el siguiente mensaje pendiente.
+
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <fstream>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <immintrin.h>
+
+#include "SHA256.h"
+#include "CapacidadesCPU.h"
+#include "PoolBuffers.h"
+
+// Origen de los datos de un mensaje; entrega el mensaje en tramos consecutivos
+class FuenteLote {
+public:
+    virtual ~FuenteLote() {}
+    // Devuelve false cuando no quedan mas datos
+    virtual bool siguiente(const uint8_t*& datos, size_t& len) = 0;
+    // false si la fuente no pudo abrirse o fallo la lectura
+    virtual bool valida() const { return true; }
+};
+
+// Mensaje completo ya en memoria (sin copias)
+class FuenteMemoria : public FuenteLote {
+public:
+    FuenteMemoria(const void* datos, size_t len)
+        : datos(static_cast<const uint8_t*>(datos)), len(len), entregado(false) {}
+
+    bool siguiente(const uint8_t*& d, size_t& n) override {
+        if (entregado) {
+            return false;
+        }
+        entregado = true;
+        d = datos;
+        n = len;
+        return true;
+    }
+
+private:
+    const uint8_t* datos;
+    size_t len;
+    bool entregado;
+};
+
+// Archivo leido por bloques en un tramo de buffer prestado por el lote; al
+// destruirse devuelve el tramo a 'libres' para el siguiente archivo
+class FuenteArchivo : public FuenteLote {
+public:
+    static const size_t TAM_BUFFER = 64 * 1024;
+
+    FuenteArchivo(const std::string& ruta, std::vector<char*>& libres)
+        : archivo(ruta, std::ios::binary), libres(libres), buffer(libres.back()) {
+        libres.pop_back();
+    }
+    ~FuenteArchivo() override { libres.push_back(buffer); }
+
+    bool siguiente(const uint8_t*& d, size_t& n) override {
+        if (!archivo.is_open() || !archivo) {
+            return false;
+        }
+        archivo.read(buffer, TAM_BUFFER);
+        std::streamsize leidos = archivo.gcount();
+        if (leidos <= 0) {
+            return false;
+        }
+        d = reinterpret_cast<const uint8_t*>(buffer);
+        n = static_cast<size_t>(leidos);
+        return true;
+    }
+
+    bool valida() const override { return archivo.is_open() && !archivo.bad(); }
+
+private:
+    std::ifstream archivo;
+    std::vector<char*>& libres;
+    char* buffer;
+};
+
+class SHA256Lote {
+public:
+    typedef std::array<uint8_t, SHA256::DIGEST_SIZE> Digest;
+
+    // Abre la fuente del mensaje 'indice'
+    typedef std::function<std::unique_ptr<FuenteLote>(size_t indice)> AbrirFuente;
+    // Recibe el digest del mensaje 'indice' (nullptr si la fuente fallo)
+    typedef std::function<void(size_t indice, const uint8_t* digest)> AlTerminar;
+
+    // Usa el mayor numero de carriles que soporte la CPU
+    SHA256Lote() : SHA256Lote(carrilesDisponibles()) {}
+    explicit SHA256Lote(int carriles);
+
+    static int carrilesDisponibles();
+    int carriles() const { return num_carriles; }
+
+    // true si el lote supera al mejor backend de un solo flujo en esta CPU
+    // (con SHA-NI solo compensa el ancho de 16 carriles)
+    static bool superaFlujoSimple();
+
+    // Hashea 'n' mensajes independientes
+    void hashear(size_t n, const AbrirFuente& abrir, const AlTerminar& al_terminar);
+
+    // Atajos para mensajes en memoria y para archivos ("" si no se pudo leer)
+    std::vector<Digest> hashearMemoria(const std::vector<std::pair<const void*, size_t>>& mensajes);
+    std::vector<std::string> hashearArchivos(const std::vector<std::string>& rutas);
+
+    // Compara cada ancho disponible con el SHA256 de un solo flujo
+    static bool verificar(std::string& detalle);
+
+private:
+    static const int MAX_CARRILES = 16;
+
+    // Comprime un bloque por carril; estado en formato [palabra][carril]
+    typedef void (*CompresionLote)(uint32_t* estado, const uint8_t* const* bloques);
+
+    static void compresionSSE2(uint32_t* estado, const uint8_t* const* bloques);
+    static void compresionAVX2(uint32_t* estado, const uint8_t* const* bloques);
+    static void compresionAVX512(uint32_t* estado, const uint8_t* const* bloques);
+
+    // Estado de un mensaje en curso dentro de un carril
+    struct Carril {
+        bool activo = false;
+        size_t indice = 0;
+        std::unique_ptr<FuenteLote> fuente;
+        const uint8_t* datos = nullptr;    // Tramo actual de la fuente
+        size_t restantes = 0;
+        bool fuente_agotada = false;
+        uint8_t parcial[SHA256::BLOCK_SIZE];   // Bloque que cruza dos tramos
+        size_t parcial_len = 0;
+        uint8_t cola[2 * SHA256::BLOCK_SIZE];  // Bloques finales con padding
+        int bloques_cola = 0;
+        int pos_cola = 0;
+        uint64_t procesados = 0;               // Bytes del mensaje ya comprimidos
+    };
+
+    const uint8_t* siguienteBloque(Carril& c);
+    void iniciarCarril(int carril, size_t indice, const AbrirFuente& abrir);
+    void terminarCarril(int carril, const AlTerminar& al_terminar);
+    void drenarCarril(int carril, const AlTerminar& al_terminar);
+
+    int num_carriles;
+    bool drenaje_habilitado;
+    CompresionLote compresion;
+    alignas(64) uint32_t estado[8 * MAX_CARRILES];
+    Carril carriles_[MAX_CARRILES];
+};
+
+// --- Kernels: una ronda SHA-256 en cada carril con operaciones verticales ---
+
+// Traspone las 16 palabras big-endian del bloque de cada carril a w[t][carril]
+static inline void sha256LoteCargarMensaje(const uint8_t* const* bloques, int carriles, uint32_t* w) {
+    for (int c = 0; c < carriles; c++) {
+        const uint8_t* b = bloques[c];
+        for (int t = 0; t < 16; t++) {
+            w[t * carriles + c] = (static_cast<uint32_t>(b[t * 4]) << 24) |
+                                  (static_cast<uint32_t>(b[t * 4 + 1]) << 16) |
+                                  (static_cast<uint32_t>(b[t * 4 + 2]) << 8) |
+                                  static_cast<uint32_t>(b[t * 4 + 3]);
+        }
+    }
+}
+
+SO_TARGET("sse2")
+static inline __m128i sha256LoteRotrSSE2(__m128i x, int n) {
+    return _mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n));
+}
+
+SO_TARGET("sse2")
+void SHA256Lote::compresionSSE2(uint32_t* estado, const uint8_t* const* bloques) {
+    alignas(16) uint32_t mensaje[16 * 4];
+    sha256LoteCargarMensaje(bloques, 4, mensaje);
+
+    __m128i v[8], w[16];
+    for (int i = 0; i < 8; i++) {
+        v[i] = _mm_load_si128((const __m128i*)&estado[i * 4]);
+    }
+    __m128i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    for (int t = 0; t < 64; t++) {
+        __m128i wt;
+        if (t < 16) {
+            wt = _mm_load_si128((const __m128i*)&mensaje[t * 4]);
+        } else {
+            __m128i x = w[(t - 15) & 15], y = w[(t - 2) & 15];
+            __m128i s0 = _mm_xor_si128(_mm_xor_si128(sha256LoteRotrSSE2(x, 7), sha256LoteRotrSSE2(x, 18)),
+                                       _mm_srli_epi32(x, 3));
+            __m128i s1 = _mm_xor_si128(_mm_xor_si128(sha256LoteRotrSSE2(y, 17), sha256LoteRotrSSE2(y, 19)),
+                                       _mm_srli_epi32(y, 10));
+            wt = _mm_add_epi32(_mm_add_epi32(w[t & 15], s0), _mm_add_epi32(w[(t - 7) & 15], s1));
+        }
+        w[t & 15] = wt;
+
+        __m128i S1 = _mm_xor_si128(_mm_xor_si128(sha256LoteRotrSSE2(e, 6), sha256LoteRotrSSE2(e, 11)),
+                                   sha256LoteRotrSSE2(e, 25));
+        __m128i ch = _mm_xor_si128(_mm_and_si128(e, f), _mm_andnot_si128(e, g));
+        __m128i temp1 = _mm_add_epi32(_mm_add_epi32(h, S1),
+                                      _mm_add_epi32(ch, _mm_add_epi32(wt, _mm_set1_epi32(SHA256::k[t]))));
+        __m128i S0 = _mm_xor_si128(_mm_xor_si128(sha256LoteRotrSSE2(a, 2), sha256LoteRotrSSE2(a, 13)),
+                                   sha256LoteRotrSSE2(a, 22));
+        __m128i maj = _mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(c, _mm_or_si128(a, b)));
+        h = g; g = f; f = e;
+        e = _mm_add_epi32(d, temp1);
+        d = c; c = b; b = a;
+        a = _mm_add_epi32(temp1, _mm_add_epi32(S0, maj));
+    }
+
+    __m128i r[8] = { a, b, c, d, e, f, g, h };
+    for (int i = 0; i < 8; i++) {
+        _mm_store_si128((__m128i*)&estado[i * 4], _mm_add_epi32(v[i], r[i]));
+    }
+}
+
+SO_TARGET("avx2")
+static inline __m256i sha256LoteRotrAVX2(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+SO_TARGET("avx2")
+void SHA256Lote::compresionAVX2(uint32_t* estado, const uint8_t* const* bloques) {
+    alignas(32) uint32_t mensaje[16 * 8];
+    sha256LoteCargarMensaje(bloques, 8, mensaje);
+
+    __m256i v[8], w[16];
+    for (int i = 0; i < 8; i++) {
+        v[i] = _mm256_load_si256((const __m256i*)&estado[i * 8]);
+    }
+    __m256i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    for (int t = 0; t < 64; t++) {
+        __m256i wt;
+        if (t < 16) {
+            wt = _mm256_load_si256((const __m256i*)&mensaje[t * 8]);
+        } else {
+            __m256i x = w[(t - 15) & 15], y = w[(t - 2) & 15];
+            __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(sha256LoteRotrAVX2(x, 7), sha256LoteRotrAVX2(x, 18)),
+                                          _mm256_srli_epi32(x, 3));
+            __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(sha256LoteRotrAVX2(y, 17), sha256LoteRotrAVX2(y, 19)),
+                                          _mm256_srli_epi32(y, 10));
+            wt = _mm256_add_epi32(_mm256_add_epi32(w[t & 15], s0), _mm256_add_epi32(w[(t - 7) & 15], s1));
+        }
+        w[t & 15] = wt;
+
+        __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(sha256LoteRotrAVX2(e, 6), sha256LoteRotrAVX2(e, 11)),
+                                      sha256LoteRotrAVX2(e, 25));
+        __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        __m256i temp1 = _mm256_add_epi32(_mm256_add_epi32(h, S1),
+                                         _mm256_add_epi32(ch, _mm256_add_epi32(wt, _mm256_set1_epi32(SHA256::k[t]))));
+        __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(sha256LoteRotrAVX2(a, 2), sha256LoteRotrAVX2(a, 13)),
+                                      sha256LoteRotrAVX2(a, 22));
+        __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        h = g; g = f; f = e;
+        e = _mm256_add_epi32(d, temp1);
+        d = c; c = b; b = a;
+        a = _mm256_add_epi32(temp1, _mm256_add_epi32(S0, maj));
+    }
+
+    __m256i r[8] = { a, b, c, d, e, f, g, h };
+    for (int i = 0; i < 8; i++) {
+        _mm256_store_si256((__m256i*)&estado[i * 8], _mm256_add_epi32(v[i], r[i]));
+    }
+}
+
+// GCC marca como no inicializado el valor indefinido interno de las macros AVX-512
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+SO_TARGET("avx512f")
+void SHA256Lote::compresionAVX512(uint32_t* estado, const uint8_t* const* bloques) {
+    alignas(64) uint32_t mensaje[16 * 16];
+    sha256LoteCargarMensaje(bloques, 16, mensaje);
+
+    __m512i v[8], w[16];
+    for (int i = 0; i < 8; i++) {
+        v[i] = _mm512_load_si512((const void*)&estado[i * 16]);
+    }
+    __m512i a = v[0], b = v[1], c = v[2], d = v[3], e = v[4], f = v[5], g = v[6], h = v[7];
+
+    // vpternlogd: 0x96 = x^y^z, 0xCA = ch(x,y,z), 0xE8 = maj(x,y,z)
+    for (int t = 0; t < 64; t++) {
+        __m512i wt;
+        if (t < 16) {
+            wt = _mm512_load_si512((const void*)&mensaje[t * 16]);
+        } else {
+            __m512i x = w[(t - 15) & 15], y = w[(t - 2) & 15];
+            __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(x, 7), _mm512_ror_epi32(x, 18),
+                                                   _mm512_srli_epi32(x, 3), 0x96);
+            __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(y, 17), _mm512_ror_epi32(y, 19),
+                                                   _mm512_srli_epi32(y, 10), 0x96);
+            wt = _mm512_add_epi32(_mm512_add_epi32(w[t & 15], s0), _mm512_add_epi32(w[(t - 7) & 15], s1));
+        }
+        w[t & 15] = wt;
+
+        __m512i S1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11),
+                                               _mm512_ror_epi32(e, 25), 0x96);
+        __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xCA);
+        __m512i temp1 = _mm512_add_epi32(_mm512_add_epi32(h, S1),
+                                         _mm512_add_epi32(ch, _mm512_add_epi32(wt, _mm512_set1_epi32(SHA256::k[t]))));
+        __m512i S0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13),
+                                               _mm512_ror_epi32(a, 22), 0x96);
+        __m512i maj = _mm512_ternarylogic_epi32(a, b, c, 0xE8);
+        h = g; g = f; f = e;
+        e = _mm512_add_epi32(d, temp1);
+        d = c; c = b; b = a;
+        a = _mm512_add_epi32(temp1, _mm512_add_epi32(S0, maj));
+    }
+
+    __m512i r[8] = { a, b, c, d, e, f, g, h };
+    for (int i = 0; i < 8; i++) {
+        _mm512_store_si512((void*)&estado[i * 16], _mm512_add_epi32(v[i], r[i]));
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// --- Planificador de carriles ---
+
+SHA256Lote::SHA256Lote(int carriles) : drenaje_habilitado(true) {
+    // Si se pide un ancho no soportado se baja al mayor disponible
+    int maximo = carrilesDisponibles();
+    num_carriles = (carriles >= 16 && maximo >= 16) ? 16 : (carriles >= 8 && maximo >= 8) ? 8 : 4;
+    compresion = (num_carriles == 16) ? compresionAVX512 :
+                 (num_carriles == 8) ? compresionAVX2 : compresionSSE2;
+}
+
+int SHA256Lote::carrilesDisponibles() {
+    const CapacidadesCPU& caps = capacidadesCPU();
+    if (caps.avx512f) return 16;
+    if (caps.avx2) return 8;
+    return 4;
+}
+
+bool SHA256Lote::superaFlujoSimple() {
+    return SHA256::backendActivo() != SHA256::Backend::SHANI || carrilesDisponibles() >= 16;
+}
+
+// Devuelve el siguiente bloque de 64 bytes del carril, o nullptr si ya no quedan
+const uint8_t* SHA256Lote::siguienteBloque(Carril& c) {
+    const size_t B = SHA256::BLOCK_SIZE;
+
+    if (c.bloques_cola > 0) {
+        return (c.pos_cola < c.bloques_cola) ? c.cola + (c.pos_cola++) * B : nullptr;
+    }
+
+    while (true) {
+        // Camino rapido: bloque completo directamente desde el tramo de la fuente
+        if (c.parcial_len == 0 && c.restantes >= B) {
+            const uint8_t* bloque = c.datos;
+            c.datos += B;
+            c.restantes -= B;
+            return bloque;
+        }
+        // Bloque repartido entre el final de un tramo y el principio del siguiente
+        if (c.restantes > 0) {
+            size_t n = (B - c.parcial_len < c.restantes) ? B - c.parcial_len : c.restantes;
+            std::memcpy(c.parcial + c.parcial_len, c.datos, n);
+            c.parcial_len += n;
+            c.datos += n;
+            c.restantes -= n;
+            if (c.parcial_len == B) {
+                c.parcial_len = 0;
+                return c.parcial;
+            }
+        }
+        if (c.fuente_agotada) {
+            break;
+        }
+        if (!c.fuente->siguiente(c.datos, c.restantes)) {
+            c.fuente_agotada = true;
+            c.restantes = 0;
+        }
+    }
+
+    // Fin del mensaje: construir el padding en la cola (1 o 2 bloques)
+    uint64_t total = c.procesados + c.parcial_len;
+    uint64_t bit_len = total * 8;
+    std::memset(c.cola, 0, sizeof(c.cola));
+    std::memcpy(c.cola, c.parcial, c.parcial_len);
+    c.cola[c.parcial_len] = 0x80;
+    c.bloques_cola = (c.parcial_len + 1 + 8 > B) ? 2 : 1;
+    uint8_t* longitud = c.cola + c.bloques_cola * B - 8;
+    for (int i = 0; i < 8; i++) {
+        longitud[i] = (bit_len >> ((7 - i) * 8)) & 0xff;
+    }
+    c.parcial_len = 0;
+    c.pos_cola = 1;
+    return c.cola;
+}
+
+void SHA256Lote::iniciarCarril(int carril, size_t indice, const AbrirFuente& abrir) {
+    Carril& c = carriles_[carril];
+    c.activo = true;
+    c.indice = indice;
+    c.fuente = abrir(indice);
+    c.datos = nullptr;
+    c.restantes = 0;
+    c.fuente_agotada = false;
+    c.parcial_len = 0;
+    c.bloques_cola = 0;
+    c.pos_cola = 0;
+    c.procesados = 0;
+    for (int i = 0; i < 8; i++) {
+        estado[i * num_carriles + carril] = SHA256::sha256_h[i];
+    }
+}
+
+void SHA256Lote::terminarCarril(int carril, const AlTerminar& al_terminar) {
+    Carril& c = carriles_[carril];
+    if (c.fuente && c.fuente->valida()) {
+        uint8_t digest[SHA256::DIGEST_SIZE];
+        for (int i = 0; i < 8; i++) {
+            uint32_t v = estado[i * num_carriles + carril];
+            digest[i * 4] = (v >> 24) & 0xff;
+            digest[i * 4 + 1] = (v >> 16) & 0xff;
+            digest[i * 4 + 2] = (v >> 8) & 0xff;
+            digest[i * 4 + 3] = v & 0xff;
+        }
+        al_terminar(c.indice, digest);
+    } else {
+        al_terminar(c.indice, nullptr);
+    }
+    c.activo = false;
+    c.fuente.reset();
+}
+
+// Termina un mensaje con el SHA256 de un solo flujo partiendo del estado del carril
+void SHA256Lote::drenarCarril(int carril, const AlTerminar& al_terminar) {
+    Carril& c = carriles_[carril];
+    SHA256 sha;
+    for (int i = 0; i < 8; i++) {
+        sha.estado[i] = estado[i * num_carriles + carril];
+    }
+    if (c.bloques_cola > 0) {
+        sha.compresion(sha.estado, c.cola + c.pos_cola * SHA256::BLOCK_SIZE, c.bloques_cola - c.pos_cola);
+    } else {
+        sha.total_bytes = c.procesados;
+        sha.update(c.parcial, c.parcial_len);
+        sha.update(c.datos, c.restantes);
+        while (!c.fuente_agotada) {
+            if (c.fuente->siguiente(c.datos, c.restantes)) {
+                sha.update(c.datos, c.restantes);
+            } else {
+                c.fuente_agotada = true;
+            }
+        }
+        uint8_t digest[SHA256::DIGEST_SIZE];
+        sha.finalize(digest);
+        for (int i = 0; i < 8; i++) {
+            sha.estado[i] = (static_cast<uint32_t>(digest[i * 4]) << 24) |
+                            (static_cast<uint32_t>(digest[i * 4 + 1]) << 16) |
+                            (static_cast<uint32_t>(digest[i * 4 + 2]) << 8) | digest[i * 4 + 3];
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        estado[i * num_carriles + carril] = sha.estado[i];
+    }
+    terminarCarril(carril, al_terminar);
+}
+
+void SHA256Lote::hashear(size_t n, const AbrirFuente& abrir, const AlTerminar& al_terminar) {
+    static const uint8_t bloque_vacio[SHA256::BLOCK_SIZE] = {};
+    const uint8_t* bloques[MAX_CARRILES];
+    size_t siguiente = 0;
+    int activos = 0;
+
+    for (int l = 0; l < num_carriles; l++) {
+        carriles_[l].activo = false;
+        if (siguiente < n) {
+            iniciarCarril(l, siguiente++, abrir);
+            activos++;
+        }
+    }
+
+    // Con SHA-NI un flujo simple supera a pocos carriles ocupados: en ese caso
+    // los ultimos mensajes se terminan fuera del lote
+    bool drenar = drenaje_habilitado && SHA256::backendActivo() == SHA256::Backend::SHANI;
+
+    while (activos > 0) {
+        if (drenar && siguiente >= n && activos * 2 < num_carriles) {
+            for (int l = 0; l < num_carriles; l++) {
+                if (carriles_[l].activo) {
+                    drenarCarril(l, al_terminar);
+                }
+            }
+            break;
+        }
+
+        for (int l = 0; l < num_carriles; l++) {
+            Carril& c = carriles_[l];
+            bloques[l] = c.activo ? siguienteBloque(c) : bloque_vacio;
+        }
+        compresion(estado, bloques);
+
+        for (int l = 0; l < num_carriles; l++) {
+            Carril& c = carriles_[l];
+            if (!c.activo) {
+                continue;
+            }
+            if (c.bloques_cola == 0) {
+                c.procesados += SHA256::BLOCK_SIZE;
+            } else if (c.pos_cola == c.bloques_cola) {
+                terminarCarril(l, al_terminar);
+                activos--;
+                // Rellenar el carril con el siguiente mensaje pendiente
+                if (siguiente < n) {
+                    iniciarCarril(l, siguiente++, abrir);
+                    activos++;
+                }
+            }
+        }
+    }
+}
+
+std::vector<SHA256Lote::Digest> SHA256Lote::hashearMemoria(const std::vector<std::pair<const void*, size_t>>& mensajes) {
+    std::vector<Digest> digests(mensajes.size());
+    hashear(mensajes.size(),
+            [&](size_t i) { return std::unique_ptr<FuenteLote>(new FuenteMemoria(mensajes[i].first, mensajes[i].second)); },
+            [&](size_t i, const uint8_t* d) { std::memcpy(digests[i].data(), d, SHA256::DIGEST_SIZE); });
+    return digests;
+}
+
+std::vector<std::string> SHA256Lote::hashearArchivos(const std::vector<std::string>& rutas) {
+    std::vector<std::string> hashes(rutas.size());
+    // Un solo prestamo para todos los carriles, del mismo tamaño con cualquier
+    // numero de archivos: el pool del thread lo reserva una vez y luego lo reutiliza
+    BufferPrestado memoria(MAX_CARRILES * FuenteArchivo::TAM_BUFFER);
+    std::vector<char*> libres;
+    for (int k = 0; k < MAX_CARRILES; k++) {
+        libres.push_back(memoria.data() + k * FuenteArchivo::TAM_BUFFER);
+    }
+    hashear(rutas.size(),
+            [&](size_t i) { return std::unique_ptr<FuenteLote>(new FuenteArchivo(rutas[i], libres)); },
+            [&](size_t i, const uint8_t* d) { hashes[i] = d ? SHA256::toHex(d) : ""; });
+    return hashes;
+}
+
+// Fuente que entrega un mensaje en memoria en tramos irregulares, para probar
+// los bloques que cruzan de un tramo a otro
+class FuenteTroceada : public FuenteLote {
+public:
+    FuenteTroceada(const uint8_t* datos, size_t len, size_t paso) : datos(datos), len(len), pos(0), paso(paso) {}
+
+    bool siguiente(const uint8_t*& d, size_t& n) override {
+        if (pos >= len) {
+            return false;
+        }
+        n = (len - pos < paso) ? len - pos : paso;
+        d = datos + pos;
+        pos += n;
+        paso = paso * 5 % 301 + 1;
+        return true;
+    }
+
+private:
+    const uint8_t* datos;
+    size_t len, pos, paso;
+};
+
+bool SHA256Lote::verificar(std::string& detalle) {
+    std::vector<uint8_t> datos(20000);
+    uint32_t semilla = 0xC0FFEE;
+    for (size_t i = 0; i < datos.size(); i++) {
+        semilla = semilla * 1664525u + 1013904223u;
+        datos[i] = static_cast<uint8_t>(semilla >> 24);
+    }
+
+    // Longitudes mezcladas para que los carriles terminen en momentos distintos
+    std::vector<size_t> longitudes;
+    for (size_t len = 0; len < 200; len++) {
+        longitudes.push_back(len);
+    }
+    for (size_t len = 200; len < datos.size(); len = len * 3 / 2 + 17) {
+        longitudes.push_back(len);
+    }
+
+    std::vector<SHA256Lote::Digest> esperados(longitudes.size());
+    SHA256 referencia(SHA256::Backend::Escalar);
+    for (size_t i = 0; i < longitudes.size(); i++) {
+        referencia.update(datos.data(), longitudes[i]);
+        referencia.finalize(esperados[i].data());
+    }
+
+    const int anchos[] = { 4, 8, 16 };
+    for (int ancho : anchos) {
+        if (ancho > carrilesDisponibles()) {
+            continue;
+        }
+        for (int drenaje = 0; drenaje < 2; drenaje++) {
+            SHA256Lote lote(ancho);
+            lote.drenaje_habilitado = (drenaje == 1);
+            bool correcto = true;
+            lote.hashear(longitudes.size(),
+                         [&](size_t i) {
+                             return std::unique_ptr<FuenteLote>(new FuenteTroceada(datos.data(), longitudes[i], 1 + i % 150));
+                         },
+                         [&](size_t i, const uint8_t* d) {
+                             if (!d || std::memcmp(d, esperados[i].data(), SHA256::DIGEST_SIZE) != 0) {
+                                 correcto = false;
+                             }
+                         });
+            if (!correcto) {
+                detalle = "lote de " + std::to_string(ancho) + " carriles difiere del SHA256 de referencia";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#endif // SHA256_LOTE_H
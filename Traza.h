@@ -0,0 +1,276 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+// Medicion por etapas del pipeline (copiar, cifrar, hash, descifrar, comparar...).
+// Cada etapa se mide con un objeto EtapaTraza en su ambito; el evento se guarda
+// en un buffer propio del thread que la ejecuta, sin locks. Al final se puede
+// exportar todo como JSON de eventos de traza de Chrome (se abre en Perfetto o
+// chrome://tracing, un carril por thread) y resumir bytes, tiempo y MB/s por etapa.
+// Desactivada, cada etapa cuesta una lectura atomica.
+//
+// Con los contadores activados cada etapa guarda ademas los ciclos,
+// instrucciones y fallos de cache y de salto del thread que la ejecuta
+// (ContadoresHardware.h). Solo cuentan el trabajo de ese thread: los rangos
+// que una etapa reparte en el pool aparecen como etapas propias.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ContadoresHardware.h"
+
+struct EventoTraza {
+    const char* nombre;     // Literal: nombre de la etapa
+    int64_t inicio_ns;      // Desde el arranque del registro
+    int64_t duracion_ns;
+    uint64_t bytes;         // Bytes procesados por la etapa (0 si no aplica)
+    int archivo;            // Indice del archivo del lote (0 si no aplica)
+    int proceso;            // Proceso del programa (base, optimizado...) al que pertenece
+    LecturaContadores contadores;   // Diferencia durante la etapa (valida = false si no se midieron)
+};
+
+class RegistroTraza {
+public:
+    static RegistroTraza& instancia() {
+        static RegistroTraza registro;
+        return registro;
+    }
+
+    void activar() { activa.store(true, std::memory_order_relaxed); }
+    bool estaActiva() const { return activa.load(std::memory_order_relaxed); }
+
+    // Medir tambien los contadores de hardware en cada etapa (implica activar)
+    void activarContadores() {
+        contadores_activos.store(true, std::memory_order_relaxed);
+        activar();
+    }
+    bool contadoresActivos() const { return contadores_activos.load(std::memory_order_relaxed); }
+
+    // Los eventos siguientes se agrupan bajo este proceso (un "pid" en la traza)
+    void fijarProceso(int id, const std::string& nombre) {
+        std::lock_guard<std::mutex> lock(mtx);
+        proceso_actual.store(id, std::memory_order_relaxed);
+        nombres_proceso[id] = nombre;
+    }
+
+    // Nombre del carril del thread actual en la traza (p. ej. "trabajador 3")
+    void nombrarHilo(const std::string& nombre) {
+        if (estaActiva()) {
+            bufferActual().nombre = nombre;
+        }
+    }
+
+    int64_t ahoraNs() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origen).count();
+    }
+
+    void registrar(const char* nombre, int64_t inicio_ns, int64_t fin_ns, uint64_t bytes, int archivo,
+                   const LecturaContadores& contadores = LecturaContadores()) {
+        bufferActual().eventos.push_back(
+            EventoTraza{nombre, inicio_ns, fin_ns - inicio_ns, bytes, archivo, proceso_actual.load(std::memory_order_relaxed), contadores});
+    }
+
+    // Escribe la traza en formato JSON de eventos de Chrome ("X" = evento con duracion).
+    // Debe llamarse cuando ya no quedan threads midiendo.
+    bool exportarChrome(const std::string& ruta) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::ofstream ofs(ruta);
+        if (!ofs.is_open()) {
+            return false;
+        }
+        ofs << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool primero = true;
+        auto separador = [&]() -> std::ostream& {
+            ofs << (primero ? "  " : ",\n  ");
+            primero = false;
+            return ofs;
+        };
+        for (const auto& p : nombres_proceso) {
+            separador() << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << p.first
+                        << ", \"args\": {\"name\": \"" << p.second << "\"}}";
+        }
+        ofs << std::fixed << std::setprecision(3);
+        for (size_t tid = 0; tid < buffers.size(); ++tid) {
+            const BufferHilo& buffer = *buffers[tid];
+            // El mismo thread puede aparecer en varios procesos: se nombra en cada uno
+            std::vector<int> procesos;
+            for (const EventoTraza& e : buffer.eventos) {
+                if (std::find(procesos.begin(), procesos.end(), e.proceso) == procesos.end()) {
+                    procesos.push_back(e.proceso);
+                }
+            }
+            for (int pid : procesos) {
+                separador() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << tid
+                            << ", \"args\": {\"name\": \"" << buffer.nombre << "\"}}";
+            }
+            for (const EventoTraza& e : buffer.eventos) {
+                separador() << "{\"name\": \"" << e.nombre << "\", \"cat\": \"etapa\", \"ph\": \"X\", \"pid\": " << e.proceso
+                            << ", \"tid\": " << tid << ", \"ts\": " << e.inicio_ns / 1000.0 << ", \"dur\": " << e.duracion_ns / 1000.0
+                            << ", \"args\": {\"bytes\": " << e.bytes << ", \"archivo\": " << e.archivo;
+                if (e.contadores.valida) {
+                    ofs << ", \"ciclos\": " << e.contadores.ciclos << ", \"instrucciones\": " << e.contadores.instrucciones
+                        << ", \"fallos_llc\": " << e.contadores.fallos_llc << ", \"fallos_rama\": " << e.contadores.fallos_rama;
+                }
+                ofs << "}}";
+            }
+        }
+        ofs << "\n]}\n";
+        return static_cast<bool>(ofs);
+    }
+
+    // Tabla por proceso y etapa: veces, tiempo acumulado, bytes y MB/s.
+    // El tiempo es la suma de las duraciones (tiempo de CPU ocupado en la etapa,
+    // no de reloj: con varios threads puede superar al total del proceso).
+    void imprimirResumen(std::ostream& os) {
+        struct Acumulado {
+            size_t veces = 0;
+            int64_t ns = 0;
+            uint64_t bytes = 0;
+            LecturaContadores contadores;   // Suma de las etapas que se midieron
+            uint64_t bytes_contados = 0;    // Bytes de esas etapas (para bytes/ciclo)
+        };
+        std::lock_guard<std::mutex> lock(mtx);
+        std::map<std::pair<int, std::string>, Acumulado> etapas;
+        for (const auto& buffer : buffers) {
+            for (const EventoTraza& e : buffer->eventos) {
+                Acumulado& a = etapas[{e.proceso, e.nombre}];
+                a.veces++;
+                a.ns += e.duracion_ns;
+                a.bytes += e.bytes;
+                if (e.contadores.valida) {
+                    a.contadores.valida = true;
+                    a.contadores.ciclos += e.contadores.ciclos;
+                    a.contadores.instrucciones += e.contadores.instrucciones;
+                    a.contadores.fallos_llc += e.contadores.fallos_llc;
+                    a.contadores.fallos_rama += e.contadores.fallos_rama;
+                    a.bytes_contados += e.bytes;
+                }
+            }
+        }
+        std::ios::fmtflags flags = os.flags();
+        os << "RESUMEN POR ETAPAS" << std::endl;
+        os << std::left << std::setfill(' ') << std::setw(12) << "proceso" << std::setw(25) << "etapa" << std::right
+           << std::setw(7) << "veces" << std::setw(12) << "tiempo ms" << std::setw(12) << "MB" << std::setw(10) << "MB/s" << std::endl;
+        os << std::fixed;
+        for (const auto& par : etapas) {
+            const Acumulado& a = par.second;
+            double ms = a.ns / 1e6;
+            double mb = a.bytes / 1e6;
+            os << std::left << std::setw(12) << nombres_proceso[par.first.first] << std::setw(25) << par.first.second << std::right
+               << std::setw(7) << a.veces << std::setprecision(1) << std::setw(12) << ms << std::setw(12) << mb << std::setw(10);
+            if (a.bytes > 0 && a.ns > 0) {
+                os << mb / (a.ns / 1e9);
+            } else {
+                os << "-";
+            }
+            os << std::endl;
+        }
+
+        // IPC alto y bytes/ciclo estables = limitado por calculo; IPC bajo con
+        // muchos fallos de LLC por KiB = limitado por memoria
+        bool hay_contadores = false;
+        for (const auto& par : etapas) {
+            hay_contadores |= par.second.contadores.valida;
+        }
+        if (hay_contadores) {
+            os << "CONTADORES DE HARDWARE POR ETAPA" << std::endl;
+            os << std::left << std::setw(12) << "proceso" << std::setw(25) << "etapa" << std::right << std::setw(12) << "Mciclos"
+               << std::setw(8) << "IPC" << std::setw(10) << "B/ciclo" << std::setw(12) << "LLC/KiB" << std::setw(14) << "saltos/kinst" << std::endl;
+            for (const auto& par : etapas) {
+                const LecturaContadores& c = par.second.contadores;
+                if (!c.valida || c.ciclos == 0) {
+                    continue;
+                }
+                os << std::left << std::setw(12) << nombres_proceso[par.first.first] << std::setw(25) << par.first.second << std::right
+                   << std::setprecision(1) << std::setw(12) << c.ciclos / 1e6
+                   << std::setprecision(2) << std::setw(8) << static_cast<double>(c.instrucciones) / c.ciclos
+                   << std::setw(10) << static_cast<double>(par.second.bytes_contados) / c.ciclos
+                   << std::setw(12) << (par.second.bytes_contados > 0 ? c.fallos_llc / (par.second.bytes_contados / 1024.0) : 0.0)
+                   << std::setw(14) << (c.instrucciones > 0 ? c.fallos_rama / (c.instrucciones / 1000.0) : 0.0) << std::endl;
+            }
+        }
+        os.flags(flags);
+    }
+
+private:
+    struct BufferHilo {
+        std::string nombre;
+        std::vector<EventoTraza> eventos;
+    };
+
+    RegistroTraza() : origen(std::chrono::steady_clock::now()) {}
+
+    // El buffer lo crea y lo guarda el registro: sobrevive al thread que lo uso
+    BufferHilo& bufferActual() {
+        thread_local BufferHilo* propio = nullptr;
+        if (propio == nullptr) {
+            std::lock_guard<std::mutex> lock(mtx);
+            buffers.emplace_back(new BufferHilo());
+            propio = buffers.back().get();
+            propio->nombre = "thread " + std::to_string(buffers.size() - 1);
+            propio->eventos.reserve(1024);
+        }
+        return *propio;
+    }
+
+    std::atomic<bool> activa{false};
+    std::atomic<bool> contadores_activos{false};
+    std::atomic<int> proceso_actual{0};
+    const std::chrono::steady_clock::time_point origen;
+    std::mutex mtx;                                     // Protege 'buffers' y 'nombres_proceso'
+    std::vector<std::unique_ptr<BufferHilo>> buffers;   // Indice = tid en la traza
+    std::map<int, std::string> nombres_proceso;
+};
+
+inline bool trazaActiva() {
+    return RegistroTraza::instancia().estaActiva();
+}
+
+// Mide su propio ambito como una etapa: { EtapaTraza etapa("cifrar", bytes, i); ... }
+class EtapaTraza {
+public:
+    explicit EtapaTraza(const char* nombre, uint64_t bytes = 0, int archivo = 0)
+        : nombre(nombre), bytes(bytes), archivo(archivo), inicio_ns(-1) {
+        if (trazaActiva()) {
+            RegistroTraza& registro = RegistroTraza::instancia();
+            if (registro.contadoresActivos()) {
+                inicio_contadores = leerContadoresHilo();
+            }
+            inicio_ns = registro.ahoraNs();
+        }
+    }
+
+    ~EtapaTraza() {
+        if (inicio_ns >= 0) {
+            RegistroTraza& registro = RegistroTraza::instancia();
+            int64_t fin_ns = registro.ahoraNs();
+            LecturaContadores contadores;
+            if (inicio_contadores.valida) {
+                contadores = leerContadoresHilo() - inicio_contadores;
+            }
+            registro.registrar(nombre, inicio_ns, fin_ns, bytes, archivo, contadores);
+        }
+    }
+
+    EtapaTraza(const EtapaTraza&) = delete;
+    EtapaTraza& operator=(const EtapaTraza&) = delete;
+
+private:
+    const char* nombre;
+    uint64_t bytes;
+    int archivo;
+    int64_t inicio_ns;
+    LecturaContadores inicio_contadores;
+};
+
+#endif // TRAZA_H
@@ -14,234 +14,372 @@
 #include <iomanip>      // Para std::setw, std::setfill
 #include <sstream>      // Para std::stringstream
 #include <cstdio>       // Para remove()
+#include <cstring>      // Para std::memcpy
+#include <algorithm>    // Para std::min
 #include <thread>       // Para std::this_thread::sleep_for
 #include <thread>       // Para multithreading
 #include <mutex>        // Para sincronización
-#include <future>       // Para std::async
-#include <immintrin.h>  // Para instrucciones SIMD (AVX/SSE)
-#include <windows.h>    // Para optimizaciones específicas de Windows
+#include <functional>   // Para std::function
+#include <unordered_map> // Para agrupar archivos duplicados
 
 // --- INICIO DE LA LIBRERÍA SHA-256 ---
 #include "SHA256.h"
+#include "SHA256Lote.h"
 // --- FIN DE LA LIBRERÍA SHA-256 ---
 
+#include "Opciones.h"
+#include "Cifrado.h"        // Cifrado por caracter y kernels SIMD
+#include "MotorCifrado.h"   // Motores de cifrado intercambiables (Cesar, AES-CTR)
+#include "EntradaSalida.h"  // Backends de E/S: flujos o archivos mapeados
+#include "Plataforma.h"     // Prioridad, afinidad y topologia de CPUs
+#include "PoolHilos.h"      // Pool de threads con robo de trabajo
+#include "ManifiestoMerkle.h" // Formato .sha alternativo en arbol
+#include "Comparacion.h"    // Comparación de archivos por bloques
+#include "LoteIoUring.h"    // Copia y cifrado del lote con E/S asíncrona
+#include "Benchmark.h"      // Estadísticas e informes del modo --benchmark
+#include "Traza.h"          // Tiempos por etapa y exportación de trazas de Chrome
+#include "LoteDirectorio.h" // Modo por directorios con reparto de mayor a menor
+#include "FiltroFlujo.h"    // Modo filtro stdin -> stdout con lector, cálculo y escritor
+#include "PoolBuffers.h"    // Buffers alineados reutilizados por thread
+#include "CacheHash.h"      // Cache de hashes y deduplicación del modo por directorios
+#include "DiarioLote.h"     // Diario para reanudar el modo por directorios
+#include "CompresionLZ.h"   // Compresión LZ por bloques antes del cifrado
+
 // Definiciones de funciones (prototipos)
-char cifrarCaracter(char c);
-char descifrarCaracter(char c);
-void copiarArchivo(const std::string& origen, const std::string& destino);
-void encriptarArchivo(const std::string& entrada, const std::string& salida);
-void desencriptarArchivo(const std::string& entrada, const std::string& salida);
-std::string generarHashSHA256(const std::string& rutaArchivo);
+void copiarArchivo(const std::string& origen, const std::string& destino, BackendES es = BackendES::Flujo);
+void encriptarArchivo(const std::string& entrada, const std::string& salida, BackendES es = BackendES::Flujo);
+void desencriptarArchivo(const std::string& entrada, const std::string& salida, BackendES es = BackendES::Flujo);
+void transformarArchivoPorCaracter(const std::string& entrada, const std::string& salida, bool cifrar);
+std::string generarHashSHA256(const std::string& rutaArchivo, BackendES es = BackendES::Flujo);
+std::string copiarEncriptarYHashear(const std::string& origen, const std::string& copia, const std::string& encriptado, BackendES es = BackendES::Flujo);
+std::string desencriptarYHashear(const std::string& entrada, const std::string& salida, BackendES es = BackendES::Flujo);
+std::string desencriptarHashearYComparar(const std::string& entrada, const std::string& original, const std::string& salida, BackendES es, int64_t& primer_distinto);
 bool validarHashSHA256(const std::string& rutaArchivoEncriptado, const std::string& hashEsperado);
-bool compararArchivos(const std::string& archivo1, const std::string& archivo2);
+bool compararArchivos(const std::string& archivo1, const std::string& archivo2, BackendES es = BackendES::Flujo, PoolHilos* pool = nullptr);
 std::string formatDuration(long long microseconds);
-long long ejecutarProcesoBase(int N, const std::string& originalFileName);
-void ejecutarProcesoOptimizado(int N, const std::string& originalFileName, long long tiempoBase);
-void procesarArchivo(int i, const std::string& originalFileName, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion);
-void optimizarConfiguracionWindows();
-bool tieneCapacidadesSIMD();
-void cifrarChunkOptimizado(char* buffer, size_t size);
-void descifrarChunkOptimizado(char* buffer, size_t size);
-void cifrarChunkSIMD(char* buffer, size_t size);
-void descifrarChunkSIMD(char* buffer, size_t size);
+uint64_t bytesParaTraza(const std::string& ruta);
+void informarReservasBuffers(uint64_t reservas_previas, uint64_t bytes_previos, size_t num_archivos);
+long long ejecutarProcesoBase(int N, const std::string& originalFileName, bool* hubo_errores = nullptr);
+long long ejecutarProcesoOptimizado(int N, const std::string& originalFileName, long long tiempoBase, const OpcionesPrograma& opciones, bool* hubo_errores = nullptr);
+int ejecutarBenchmark(const OpcionesPrograma& opciones);
+int ejecutarLoteDirectorios(const OpcionesPrograma& opciones);
+int ejecutarFiltroFlujo(const OpcionesPrograma& opciones);
+bool comprimirYCifrarFlujo(const std::function<long long(char*, size_t)>& leer, const std::function<bool(const char*, size_t)>& escribir,
+                           SHA256* sha, uint64_t& bytes_plano);
+bool descifrarYDescomprimirFlujo(const std::function<bool(char*, size_t)>& leer_exacto, const std::function<bool(const char*, size_t)>& consumir,
+                                 std::string& error);
+bool comprimirYCifrarArchivo(const std::string& entrada, const std::string& salida, PoolHilos& pool, std::string& error);
+std::string descifrarDescomprimirHashearYComparar(const std::string& entrada, const std::string& original, PoolHilos& pool,
+                                                  int64_t& primer_distinto, std::string& error);
+bool procesarArchivoDeLote(const ArchivoLote& archivo, const std::string& hash_conocido, int restantes, const OpcionesPrograma& opciones,
+                           PoolHilos& pool, DiarioLote* diario, std::mutex& mtx);
+bool salidaCompletaSegunDiario(const ArchivoLote& archivo, const DiarioLote& diario, const OpcionesPrograma& opciones, std::string& hash);
+std::string configuracionDiario(const OpcionesPrograma& opciones);
+bool cifrarPorSegmentos(const std::string& entrada, const std::string& salida, uint64_t desde, const OpcionesPrograma& opciones, PoolHilos& pool,
+                        const std::function<void(uint64_t)>& segmento_terminado);
+std::string hashEntradaConCache(const ArchivoLote& archivo, CacheHashes* cache, BackendES es);
+bool enlazarSalidaDuplicada(const ArchivoLote& representante, const ArchivoLote& archivo, const std::string& hash,
+                            const OpcionesPrograma& opciones, std::atomic<unsigned int>* usos_enlace, DiarioLote* diario, std::mutex& mtx);
+void procesarArchivo(int i, int N, const std::string& originalFileName, const OpcionesPrograma& opciones, PoolHilos& pool, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion);
+void procesarArchivosConHashLote(int N, const std::string& originalFileName, PoolHilos& pool, const OpcionesPrograma& opciones, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion);
+void procesarLoteIoUring(int N, const std::string& originalFileName, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion);
+void optimizarConfiguracionPlataforma(const OpcionesPrograma& opciones);
 void limpiarArchivosExistentes(int N);
+std::string nombreArchivoDesencriptado(int i, int N);
+bool ejecutarAutoprueba();
+bool dividirEnRangos(const std::string& entrada, int N, const OpcionesPrograma& opciones, const PoolHilos& pool);
+bool transformarArchivoPorRangos(const std::string& entrada, const std::string& salida, bool cifrar, const OpcionesPrograma& opciones, PoolHilos& pool);
+void transformarArchivoOptimizado(const std::string& entrada, const std::string& salida, bool cifrar, int N, const OpcionesPrograma& opciones, PoolHilos& pool);
+void copiarArchivoOptimizado(const std::string& origen, const std::string& destino, const OpcionesPrograma& opciones);
+void generarYValidarManifiestoMerkle(const std::string& originalFileName, const std::string& copiaFileName, const std::string& encriptadoFileName,
+                                     const std::string& hashFileName, const std::string& desencriptadoFileName, int N,
+                                     const OpcionesPrograma& opciones, PoolHilos& pool, std::mutex& mtx, bool& errores_verificacion);
+
+int main(int argc, char* argv[]) {
+
+    OpcionesPrograma opciones;
+    if (!parsearArgumentos(argc, argv, opciones)) {
+        return 1;
+    }
 
-// Función para detectar capacidades SIMD del procesador
-bool tieneCapacidadesSIMD() {
-    // Por ahora, asumimos que las CPUs modernas tienen SSE4.2
-    // En una implementación real, usaríamos __cpuid o IsProcessorFeaturePresent
-    return false; // Fallback: usar algoritmo tradicional para evitar errores
-}
+    // Modo autoprueba: verifica los kernels acelerados contra las referencias y termina
+    if (opciones.autoprueba) {
+        return ejecutarAutoprueba() ? 0 : 1;
+    }
 
-// Función de cifrado que usa SIMD si está disponible, sino tradicional
-void cifrarChunkOptimizado(char* buffer, size_t size) {
-    if (tieneCapacidadesSIMD()) {
-        cifrarChunkSIMD(buffer, size);
-    } else {
-        // Fallback a método tradicional
-        for (size_t i = 0; i < size; ++i) {
-            buffer[i] = cifrarCaracter(buffer[i]);
+    // Motor de cifrado: se crea una vez, antes de lanzar ningún thread
+    {
+        std::string error;
+        std::unique_ptr<MotorCifrado> motor = crearMotorCifrado(opciones.motorCifrado, opciones.claveCifrado, opciones.ivCifrado, error);
+        if (!motor) {
+            (opciones.filtro != ModoFiltro::Ninguno ? std::cerr : std::cout) << "Error: " << error << std::endl;
+            return 1;
+        }
+        // Filtro sobre un .enc del modo por directorios: el motor de su ruta
+        if (opciones.filtro != ModoFiltro::Ninguno && !opciones.rutaLote.empty()) {
+            motor = motor->paraArchivo(opciones.rutaLote);
+        }
+        activarMotorCifrado(std::move(motor));
+    }
+
+    // Prioridad del proceso (Windows y Linux)
+    optimizarConfiguracionPlataforma(opciones);
+
+    // Modo filtro: stdout lleva los datos, así que no se imprime nada más en él
+    if (opciones.filtro != ModoFiltro::Ninguno) {
+        return ejecutarFiltroFlujo(opciones);
+    }
+
+    // Modo benchmark: repeticiones medidas en lugar de una sola pasada
+    if (opciones.benchmark) {
+        return ejecutarBenchmark(opciones);
+    }
+
+    // Tiempos por etapa: solo se registran si se pidió la traza o el resumen
+    RegistroTraza& traza = RegistroTraza::instancia();
+    if (!opciones.rutaTraza.empty() || opciones.resumenEtapas || opciones.contadoresHardware) {
+        traza.activar();
+        traza.nombrarHilo("principal");
+    }
+    if (opciones.contadoresHardware) {
+        std::string motivo;
+        if (contadoresHardwareDisponibles(&motivo)) {
+            traza.activarContadores();
+        } else {
+            std::cout << "Aviso: Contadores de hardware no disponibles: " << motivo << ". Se mide solo el tiempo." << std::endl;
         }
     }
-}
 
-// Función de descifrado que usa SIMD si está disponible, sino tradicional
-void descifrarChunkOptimizado(char* buffer, size_t size) {
-    if (tieneCapacidadesSIMD()) {
-        descifrarChunkSIMD(buffer, size);
+    int resultado = 0;
+    if (!opciones.directoriosEntrada.empty()) {
+        // Modo por directorios: cada archivo de los árboles de entrada una vez
+        traza.fijarProceso(3, "directorios");
+        resultado = ejecutarLoteDirectorios(opciones);
     } else {
-        // Fallback a método tradicional
-        for (size_t i = 0; i < size; ++i) {
-            buffer[i] = descifrarCaracter(buffer[i]);
+        std::string originalFileName = opciones.archivoOriginal; // El archivo original proporcionado
+
+        // El enunciado indica N = 10 para la entrega y evaluación
+        int N = opciones.N;
+
+        // Limpiar archivos existentes antes de empezar
+        limpiarArchivosExistentes(N);
+
+        traza.fijarProceso(1, "base");
+        long long tiempoBase = ejecutarProcesoBase(N, originalFileName);
+
+        std::cout << std::endl;
+
+        traza.fijarProceso(2, "optimizado");
+        ejecutarProcesoOptimizado(N, originalFileName, tiempoBase, opciones);
+    }
+
+    if (traza.estaActiva()) {
+        traza.imprimirResumen(std::cout);
+    }
+    if (!opciones.rutaTraza.empty()) {
+        if (traza.exportarChrome(opciones.rutaTraza)) {
+            std::cout << "Traza guardada en " << opciones.rutaTraza << " (abrir con Perfetto o chrome://tracing)" << std::endl;
+        } else {
+            std::cout << "Error: No se pudo escribir la traza: " << opciones.rutaTraza << std::endl;
         }
     }
+
+    return resultado;
 }
 
-// Función optimizada de cifrado usando SIMD
-void cifrarChunkSIMD(char* buffer, size_t size) {
-    // Procesar 16 caracteres a la vez usando SSE
-    size_t simd_size = size - (size % 16);
-    
-    for (size_t i = 0; i < simd_size; i += 16) {
-        // Cargar 16 caracteres en un registro SSE
-        __m128i chars = _mm_loadu_si128((__m128i*)(buffer + i));
-        
-        // Crear máscaras para diferentes rangos de caracteres
-        __m128i upper_mask = _mm_set1_epi8('A');
-        __m128i upper_end = _mm_set1_epi8('Z');
-        __m128i lower_mask = _mm_set1_epi8('a');
-        __m128i lower_end = _mm_set1_epi8('z');
-        __m128i digit_mask = _mm_set1_epi8('0');
-        __m128i digit_end = _mm_set1_epi8('9');
-        
-        // Detectar letras mayúsculas (usando comparaciones disponibles)
-        __m128i upper_range = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(upper_mask, _mm_set1_epi8(1))),
-            _mm_cmplt_epi8(chars, _mm_add_epi8(upper_end, _mm_set1_epi8(1)))
-        );
-        
-        // Detectar letras minúsculas
-        __m128i lower_range = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(lower_mask, _mm_set1_epi8(1))),
-            _mm_cmplt_epi8(chars, _mm_add_epi8(lower_end, _mm_set1_epi8(1)))
-        );
-        
-        // Detectar dígitos
-        __m128i digit_range = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(digit_mask, _mm_set1_epi8(1))),
-            _mm_cmplt_epi8(chars, _mm_add_epi8(digit_end, _mm_set1_epi8(1)))
-        );
-        
-        // Aplicar transformaciones
-        __m128i upper_shifted = _mm_add_epi8(chars, _mm_set1_epi8(3));
-        __m128i lower_shifted = _mm_add_epi8(chars, _mm_set1_epi8(3));
-        __m128i digits_symmetric = _mm_sub_epi8(_mm_set1_epi8('9'), _mm_sub_epi8(chars, digit_mask));
-        
-        // Combinar resultados
-        __m128i result = _mm_or_si128(
-            _mm_or_si128(
-                _mm_and_si128(upper_range, upper_shifted),
-                _mm_and_si128(lower_range, lower_shifted)
-            ),
-            _mm_and_si128(digit_range, digits_symmetric)
-        );
-        
-        // Guardar resultado
-        _mm_storeu_si128((__m128i*)(buffer + i), result);
+// Implementación de las funciones
+
+// Tamaño de bloque para leer, cifrar y escribir
+const size_t TAM_BLOQUE_CIFRADO = 64 * 1024;
+
+// Tamaño a partir del cual un archivo se reparte por rangos en modo automático
+const int64_t UMBRAL_RANGOS = 64LL * 1024 * 1024;
+
+// Con --diario, los archivos de al menos este tamaño se cifran por segmentos
+// y cada segmento terminado se anota para poder reanudarlos
+const uint64_t TAM_SEGMENTO_DIARIO = 64ULL * 1024 * 1024;
+
+#if SO_TIENE_MMAP
+// Variantes con archivos mapeados: el origen se mapea en solo lectura, el
+// destino se crea con su tamaño final y los kernels de cifrado y hash trabajan
+// directamente sobre las paginas, sin copias intermedias en espacio de usuario.
+
+bool copiarArchivoMapeado(const std::string& origen, const std::string& destino) {
+    ArchivoMapeado src;
+    ArchivoMapeado dst;
+    if (!src.abrirLectura(origen)) {
+        std::cout << "Error: No se pudo abrir el archivo de origen para copiar: " << origen << std::endl;
+        return false;
     }
-    
-    // Procesar caracteres restantes de forma tradicional
-    for (size_t i = simd_size; i < size; ++i) {
-        buffer[i] = cifrarCaracter(buffer[i]);
+    if (!dst.crearEscritura(destino, src.tam())) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de destino para copiar: " << destino << std::endl;
+        return false;
+    }
+    if (src.tam() > 0) {
+        std::memcpy(dst.datos(), src.datos(), src.tam());
     }
+    return true;
 }
 
-// Función optimizada de descifrado usando SIMD
-void descifrarChunkSIMD(char* buffer, size_t size) {
-    // Procesar 16 caracteres a la vez usando SSE
-    size_t simd_size = size - (size % 16);
-    
-    for (size_t i = 0; i < simd_size; i += 16) {
-        // Cargar 16 caracteres en un registro SSE
-        __m128i chars = _mm_loadu_si128((__m128i*)(buffer + i));
-        
-        // Crear máscaras para diferentes rangos de caracteres
-        __m128i upper_mask = _mm_set1_epi8('A');
-        __m128i upper_end = _mm_set1_epi8('Z');
-        __m128i lower_mask = _mm_set1_epi8('a');
-        __m128i lower_end = _mm_set1_epi8('z');
-        __m128i digit_mask = _mm_set1_epi8('0');
-        __m128i digit_end = _mm_set1_epi8('9');
-        
-        // Detectar letras mayúsculas (usando comparaciones disponibles)
-        __m128i upper_range = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(upper_mask, _mm_set1_epi8(1))),
-            _mm_cmplt_epi8(chars, _mm_add_epi8(upper_end, _mm_set1_epi8(1)))
-        );
-        
-        // Detectar letras minúsculas
-        __m128i lower_range = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(lower_mask, _mm_set1_epi8(1))),
-            _mm_cmplt_epi8(chars, _mm_add_epi8(lower_end, _mm_set1_epi8(1)))
-        );
-        
-        // Detectar dígitos
-        __m128i digit_range = _mm_and_si128(
-            _mm_cmpgt_epi8(chars, _mm_sub_epi8(digit_mask, _mm_set1_epi8(1))),
-            _mm_cmplt_epi8(chars, _mm_add_epi8(digit_end, _mm_set1_epi8(1)))
-        );
-        
-        // Aplicar transformaciones inversas
-        __m128i upper_shifted = _mm_sub_epi8(chars, _mm_set1_epi8(3));
-        __m128i lower_shifted = _mm_sub_epi8(chars, _mm_set1_epi8(3));
-        __m128i digits_symmetric = _mm_sub_epi8(_mm_set1_epi8('9'), _mm_sub_epi8(chars, digit_mask));
-        
-        // Combinar resultados
-        __m128i result = _mm_or_si128(
-            _mm_or_si128(
-                _mm_and_si128(upper_range, upper_shifted),
-                _mm_and_si128(lower_range, lower_shifted)
-            ),
-            _mm_and_si128(digit_range, digits_symmetric)
-        );
-        
-        // Guardar resultado
-        _mm_storeu_si128((__m128i*)(buffer + i), result);
+bool transformarArchivoMapeado(const std::string& entrada, const std::string& salida, bool cifrar) {
+    const char* accion = cifrar ? "encriptar" : "desencriptar";
+    ArchivoMapeado src;
+    ArchivoMapeado dst;
+    if (!src.abrirLectura(entrada)) {
+        std::cout << "Error: No se pudo abrir el archivo de entrada para " << accion << ": " << entrada << std::endl;
+        return false;
     }
-    
-    // Procesar caracteres restantes de forma tradicional
-    for (size_t i = simd_size; i < size; ++i) {
-        buffer[i] = descifrarCaracter(buffer[i]);
+    if (!dst.crearEscritura(salida, src.tam())) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para " << accion << ": " << salida << std::endl;
+        return false;
+    }
+    if (cifrar) {
+        motorCifradoActivo().cifrar(src.datos(), dst.datos(), src.tam(), 0);
+    } else {
+        motorCifradoActivo().descifrar(src.datos(), dst.datos(), src.tam(), 0);
     }
+    return true;
 }
 
-int main() {
-
-    // Optimización específica de Windows
-    optimizarConfiguracionWindows();
-
-    std::string originalFileName = "original.txt"; // El archivo original proporcionado
+std::string generarHashSHA256Mapeado(const std::string& rutaArchivo) {
+    ArchivoMapeado archivo;
+    if (!archivo.abrirLectura(rutaArchivo)) {
+        std::cout << "Error al abrir el archivo para hash: " << rutaArchivo << std::endl;
+        return "";
+    }
+    SHA256 sha256;
+    sha256.update(archivo.datos(), archivo.tam());
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
+}
 
-    // El enunciado indica N = 10 para la entrega y evaluación
-    int N = 10;
+// Modo fusionado sobre mapas: el hash del texto plano y el cifrado se hacen
+// por bloques para que cada bloque del original se lea de cache una sola vez
+std::string copiarEncriptarYHashearMapeado(const std::string& origen, const std::string& copia, const std::string& encriptado) {
+    ArchivoMapeado src;
+    ArchivoMapeado dst_copia;
+    ArchivoMapeado dst_enc;
+    if (!src.abrirLectura(origen)) {
+        std::cout << "Error: No se pudo abrir el archivo de origen para copiar: " << origen << std::endl;
+        return "";
+    }
+    if (!dst_copia.crearEscritura(copia, src.tam())) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de destino para copiar: " << copia << std::endl;
+        return "";
+    }
+    if (!dst_enc.crearEscritura(encriptado, src.tam())) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para encriptar: " << encriptado << std::endl;
+        return "";
+    }
 
-    // Limpiar archivos existentes antes de empezar
-    limpiarArchivosExistentes(N);
+    SHA256 sha256;
+    for (size_t pos = 0; pos < src.tam(); pos += TAM_BLOQUE_CIFRADO) {
+        size_t n = std::min(TAM_BLOQUE_CIFRADO, src.tam() - pos);
+        sha256.update(src.datos() + pos, n);
+        std::memcpy(dst_copia.datos() + pos, src.datos() + pos, n);
+        motorCifradoActivo().cifrar(src.datos() + pos, dst_enc.datos() + pos, n, pos);
+    }
 
-    long long tiempoBase = ejecutarProcesoBase(N, originalFileName);
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
+}
 
-    std::cout << std::endl;
+std::string desencriptarYHashearMapeado(const std::string& entrada, const std::string& salida) {
+    ArchivoMapeado src;
+    ArchivoMapeado dst;
+    if (!src.abrirLectura(entrada)) {
+        std::cout << "Error: No se pudo abrir el archivo de entrada para desencriptar: " << entrada << std::endl;
+        return "";
+    }
+    if (!dst.crearEscritura(salida, src.tam())) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para desencriptar: " << salida << std::endl;
+        return "";
+    }
 
-    ejecutarProcesoOptimizado(N, originalFileName, tiempoBase);
+    SHA256 sha256;
+    for (size_t pos = 0; pos < src.tam(); pos += TAM_BLOQUE_CIFRADO) {
+        size_t n = std::min(TAM_BLOQUE_CIFRADO, src.tam() - pos);
+        motorCifradoActivo().descifrar(src.datos() + pos, dst.datos() + pos, n, pos);
+        sha256.update(dst.datos() + pos, n);
+    }
 
-    return 0;
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
 }
 
-// Implementación de las funciones
+// Verificación en memoria sobre mapas: cada bloque del .enc se descifra en un
+// buffer reutilizable (o en el mapa de la salida si se conserva), se hashea y
+// se compara con el mismo bloque del original mientras sigue en caché
+std::string desencriptarHashearYCompararMapeado(const std::string& entrada, const std::string& original, const std::string& salida, int64_t& primer_distinto) {
+    primer_distinto = -1;
+    ArchivoMapeado src;
+    ArchivoMapeado orig;
+    ArchivoMapeado dst;
+    if (!src.abrirLectura(entrada)) {
+        std::cout << "Error: No se pudo abrir el archivo de entrada para desencriptar: " << entrada << std::endl;
+        return "";
+    }
+    if (!orig.abrirLectura(original)) {
+        std::cout << "Error: No se pudo abrir el archivo original para comparar: " << original << std::endl;
+        return "";
+    }
+    if (!salida.empty() && !dst.crearEscritura(salida, src.tam())) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para desencriptar: " << salida << std::endl;
+        return "";
+    }
 
-char cifrarCaracter(char c) {
-    if (c >= 'A' && c <= 'Z') {
-        return 'A' + (c - 'A' + 3) % 26;
-    } else if (c >= 'a' && c <= 'z') {
-        return 'a' + (c - 'a' + 3) % 26;
-    } else if (c >= '0' && c <= '9') {
-        return '9' - (c - '0'); // Simétrico
+    KernelComparacion comparar = kernelComparacionActivo();
+    BufferPrestado buffer(salida.empty() ? TAM_BLOQUE_CIFRADO : 0);
+    SHA256 sha256;
+    for (size_t pos = 0; pos < src.tam(); pos += TAM_BLOQUE_CIFRADO) {
+        size_t n = std::min(TAM_BLOQUE_CIFRADO, src.tam() - pos);
+        char* bloque = salida.empty() ? buffer.data() : dst.datos() + pos;
+        motorCifradoActivo().descifrar(src.datos() + pos, bloque, n, pos);
+        sha256.update(bloque, n);
+        if (primer_distinto < 0) {
+            size_t comunes = pos < orig.tam() ? std::min(n, orig.tam() - pos) : 0;
+            size_t k = comparar(reinterpret_cast<const uint8_t*>(bloque),
+                                reinterpret_cast<const uint8_t*>(orig.datos() + pos), comunes);
+            if (k < comunes || comunes < n) {
+                primer_distinto = static_cast<int64_t>(pos + k);
+            }
+        }
+    }
+    if (primer_distinto < 0 && orig.tam() != src.tam()) {
+        primer_distinto = static_cast<int64_t>(src.tam());   // El original es más largo
     }
-    return c; // Otros caracteres sin cambios
-}
 
-char descifrarCaracter(char c) {
-    if (c >= 'A' && c <= 'Z') {
-        return 'A' + (c - 'A' - 3 + 26) % 26; // +26 para manejar números negativos en C++
-    } else if (c >= 'a' && c <= 'z') {
-        return 'a' + (c - 'a' - 3 + 26) % 26;
-    } else if (c >= '0' && c <= '9') {
-        return '9' - (c - '0'); // Es la misma lógica para descifrar el simétrico
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
+}
+#endif // SO_TIENE_MMAP
+
+// Un único archivo por el anillo io_uring (la copia, el cifrado o el descifrado
+// sueltos). El proceso optimizado mete todo el lote en el mismo anillo.
+bool transformarArchivoIoUring(const std::string& entrada, const std::string& salida, TransformacionBloque transformar) {
+    std::string error;
+    if (!ejecutarLoteIoUring({TrabajoLote{entrada, {SalidaLote{salida, transformar}}}}, error)) {
+        std::cout << "Error: " << error << std::endl;
+        return false;
     }
-    return c;
+    return true;
 }
 
-void copiarArchivo(const std::string& origen, const std::string& destino) {
+void copiarArchivo(const std::string& origen, const std::string& destino, BackendES es) {
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        copiarArchivoMapeado(origen, destino);
+        return;
+    }
+#endif
+    if (es == BackendES::IoUring) {
+        transformarArchivoIoUring(origen, destino, nullptr);
+        return;
+    }
     std::ifstream src(origen, std::ios::binary);
     std::ofstream dst(destino, std::ios::binary);
     
@@ -261,7 +399,17 @@ void copiarArchivo(const std::string& origen, const std::string& destino) {
     dst.close();
 }
 
-void encriptarArchivo(const std::string& entrada, const std::string& salida) {
+void encriptarArchivo(const std::string& entrada, const std::string& salida, BackendES es) {
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        transformarArchivoMapeado(entrada, salida, true);
+        return;
+    }
+#endif
+    if (es == BackendES::IoUring) {
+        transformarArchivoIoUring(entrada, salida, cifrarBloqueEnPosicion);
+        return;
+    }
     std::ifstream ifs(entrada, std::ios::binary);
     std::ofstream ofs(salida, std::ios::binary);
     
@@ -274,18 +422,35 @@ void encriptarArchivo(const std::string& entrada, const std::string& salida) {
         return;
     }
     
-    // Procesar carácter por carácter
-    char c;
-    while (ifs.get(c)) {
-        char encriptado = cifrarCaracter(c);
-        ofs.put(encriptado);
+    // Procesar por bloques con el motor de cifrado activo
+    BufferPrestado buffer(TAM_BLOQUE_CIFRADO);
+    uint64_t posicion = 0;
+    while (ifs) {
+        ifs.read(buffer.data(), buffer.size());
+        std::streamsize leidos = ifs.gcount();
+        if (leidos <= 0) {
+            break;
+        }
+        cifrarBloqueEnPosicion(buffer.data(), static_cast<size_t>(leidos), posicion);
+        ofs.write(buffer.data(), leidos);
+        posicion += static_cast<uint64_t>(leidos);
     }
     
     ifs.close();
     ofs.close();
 }
 
-void desencriptarArchivo(const std::string& entrada, const std::string& salida) {
+void desencriptarArchivo(const std::string& entrada, const std::string& salida, BackendES es) {
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        transformarArchivoMapeado(entrada, salida, false);
+        return;
+    }
+#endif
+    if (es == BackendES::IoUring) {
+        transformarArchivoIoUring(entrada, salida, descifrarBloqueEnPosicion);
+        return;
+    }
     std::ifstream ifs(entrada, std::ios::binary);
     std::ofstream ofs(salida, std::ios::binary);
     
@@ -298,81 +463,290 @@ void desencriptarArchivo(const std::string& entrada, const std::string& salida)
         return;
     }
     
-    // Procesar carácter por carácter
+    // Procesar por bloques con el motor de cifrado activo
+    BufferPrestado buffer(TAM_BLOQUE_CIFRADO);
+    uint64_t posicion = 0;
+    while (ifs) {
+        ifs.read(buffer.data(), buffer.size());
+        std::streamsize leidos = ifs.gcount();
+        if (leidos <= 0) {
+            break;
+        }
+        descifrarBloqueEnPosicion(buffer.data(), static_cast<size_t>(leidos), posicion);
+        ofs.write(buffer.data(), leidos);
+        posicion += static_cast<uint64_t>(leidos);
+    }
+    
+    ifs.close();
+    ofs.close();
+}
+
+// Versión original carácter por carácter, solo para el proceso base: así el
+// base sigue midiendo el programa de partida y no las rutas de bloques SIMD y
+// del motor que usa el optimizado. Con el César se usan las tablas de siempre;
+// los motores por contador no tienen versión por carácter, así que cada byte
+// pasa por el motor con su posición (lento a propósito, como el original).
+void transformarArchivoPorCaracter(const std::string& entrada, const std::string& salida, bool cifrar) {
+    std::ifstream ifs(entrada, std::ios::binary);
+    std::ofstream ofs(salida, std::ios::binary);
+
+    if (!ifs.is_open()) {
+        std::cout << "Error: No se pudo abrir el archivo de entrada para " << (cifrar ? "encriptar: " : "desencriptar: ") << entrada << std::endl;
+        return;
+    }
+    if (!ofs.is_open()) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para " << (cifrar ? "encriptar: " : "desencriptar: ") << salida << std::endl;
+        return;
+    }
+
+    const MotorCifrado& motor = motorCifradoActivo();
+    const bool es_cesar = dynamic_cast<const MotorCesar*>(&motor) != nullptr;
     char c;
+    uint64_t posicion = 0;
     while (ifs.get(c)) {
-        char desencriptado = descifrarCaracter(c);
-        ofs.put(desencriptado);
+        if (es_cesar) {
+            c = cifrar ? cifrarCaracter(c) : descifrarCaracter(c);
+        } else if (cifrar) {
+            motor.cifrar(&c, &c, 1, posicion);
+        } else {
+            motor.descifrar(&c, &c, 1, posicion);
+        }
+        ofs.put(c);
+        ++posicion;
     }
-    
+
     ifs.close();
     ofs.close();
 }
 
-// **Requiere una librería SHA-256 externa**
-// Si usas una librería como "sha256.h/.cpp", tu función podría verse así:
-std::string generarHashSHA256(const std::string& rutaArchivo) {
+// Calcula el SHA-256 de un archivo leyendolo por bloques de tamaño fijo,
+// de modo que la memoria usada no depende del tamaño del archivo
+std::string generarHashSHA256(const std::string& rutaArchivo, BackendES es) {
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        return generarHashSHA256Mapeado(rutaArchivo);
+    }
+#endif
     std::ifstream file(rutaArchivo, std::ios::binary);
     if (!file.is_open()) {
         std::cout << "Error al abrir el archivo para hash: " << rutaArchivo << std::endl;
         return "";
     }
     
-    // Leer el contenido del archivo
-    std::string content((std::istreambuf_iterator<char>(file)),
-                        std::istreambuf_iterator<char>());
+    const size_t TAM_BLOQUE_HASH = 64 * 1024;
+    BufferPrestado buffer(TAM_BLOQUE_HASH);
+    SHA256 sha256;
+    
+    while (file) {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize leidos = file.gcount();
+        if (leidos <= 0) {
+            break;
+        }
+        sha256.update(buffer.data(), static_cast<size_t>(leidos));
+    }
     file.close();
     
-    // Usar la librería SHA-256
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
+}
+
+// Modo fusionado: lee el original una sola vez y, en la misma pasada, escribe
+// la copia, escribe el bloque cifrado y alimenta el hash del texto plano.
+// Devuelve el hash de la copia ("" si hubo error).
+std::string copiarEncriptarYHashear(const std::string& origen, const std::string& copia, const std::string& encriptado, BackendES es) {
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        return copiarEncriptarYHashearMapeado(origen, copia, encriptado);
+    }
+#endif
+    std::ifstream src(origen, std::ios::binary);
+    std::ofstream dst_copia(copia, std::ios::binary);
+    std::ofstream dst_enc(encriptado, std::ios::binary);
+
+    if (!src.is_open()) {
+        std::cout << "Error: No se pudo abrir el archivo de origen para copiar: " << origen << std::endl;
+        return "";
+    }
+    if (!dst_copia.is_open()) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de destino para copiar: " << copia << std::endl;
+        return "";
+    }
+    if (!dst_enc.is_open()) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para encriptar: " << encriptado << std::endl;
+        return "";
+    }
+
+    BufferPrestado buffer(TAM_BLOQUE_CIFRADO);
     SHA256 sha256;
-    return sha256(content);
+    uint64_t posicion = 0;
+    while (src) {
+        src.read(buffer.data(), buffer.size());
+        std::streamsize leidos = src.gcount();
+        if (leidos <= 0) {
+            break;
+        }
+        size_t n = static_cast<size_t>(leidos);
+        sha256.update(buffer.data(), n);
+        dst_copia.write(buffer.data(), leidos);
+        cifrarBloqueEnPosicion(buffer.data(), n, posicion);
+        dst_enc.write(buffer.data(), leidos);
+        posicion += n;
+    }
+
+    if (!dst_copia || !dst_enc) {
+        std::cout << "Error: Fallo la escritura de " << copia << " o " << encriptado << std::endl;
+        return "";
+    }
+
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
 }
 
-bool validarHashSHA256(const std::string& rutaArchivoEncriptado, const std::string& hashEsperado) {
-    std::string hashCalculado = generarHashSHA256(rutaArchivoEncriptado);
-    return hashCalculado == hashEsperado;
+// Descifra 'entrada' en 'salida' y devuelve el hash del texto descifrado
+// calculado en la misma pasada ("" si hubo error)
+std::string desencriptarYHashear(const std::string& entrada, const std::string& salida, BackendES es) {
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        return desencriptarYHashearMapeado(entrada, salida);
+    }
+#endif
+    std::ifstream ifs(entrada, std::ios::binary);
+    std::ofstream ofs(salida, std::ios::binary);
+
+    if (!ifs.is_open()) {
+        std::cout << "Error: No se pudo abrir el archivo de entrada para desencriptar: " << entrada << std::endl;
+        return "";
+    }
+    if (!ofs.is_open()) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para desencriptar: " << salida << std::endl;
+        return "";
+    }
+
+    BufferPrestado buffer(TAM_BLOQUE_CIFRADO);
+    SHA256 sha256;
+    uint64_t posicion = 0;
+    while (ifs) {
+        ifs.read(buffer.data(), buffer.size());
+        std::streamsize leidos = ifs.gcount();
+        if (leidos <= 0) {
+            break;
+        }
+        descifrarBloqueEnPosicion(buffer.data(), static_cast<size_t>(leidos), posicion);
+        sha256.update(buffer.data(), static_cast<size_t>(leidos));
+        ofs.write(buffer.data(), leidos);
+        posicion += static_cast<uint64_t>(leidos);
+    }
+
+    if (!ofs) {
+        std::cout << "Error: Fallo la escritura de " << salida << std::endl;
+        return "";
+    }
+
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
 }
 
-bool compararArchivos(const std::string& archivo1, const std::string& archivo2) {
-    std::ifstream f1(archivo1, std::ios::binary);
-    std::ifstream f2(archivo2, std::ios::binary);
+// Descifra 'entrada' bloque a bloque en memoria: cada bloque alimenta el hash y
+// se compara con el bloque equivalente de 'original' en la misma pasada. Solo
+// se escribe el descifrado si 'salida' no está vacía. Devuelve el hash del
+// texto descifrado ("" si hubo error) y en 'primer_distinto' el primer byte que
+// no coincide con el original (-1 si son idénticos).
+std::string desencriptarHashearYComparar(const std::string& entrada, const std::string& original, const std::string& salida, BackendES es, int64_t& primer_distinto) {
+#if SO_TIENE_MMAP
+    if (es == BackendES::Mmap) {
+        return desencriptarHashearYCompararMapeado(entrada, original, salida, primer_distinto);
+    }
+#endif
+    primer_distinto = -1;
+    std::ifstream ifs(entrada, std::ios::binary);
+    std::ifstream orig(original, std::ios::binary);
+    std::ofstream ofs;
 
-    if (!f1.is_open() || !f2.is_open()) {
-        std::cout << "Error: No se pudieron abrir los archivos para comparar. Archivo1: " << archivo1 << ", Archivo2: " << archivo2 << std::endl;
-        return false;
+    if (!ifs.is_open()) {
+        std::cout << "Error: No se pudo abrir el archivo de entrada para desencriptar: " << entrada << std::endl;
+        return "";
+    }
+    if (!orig.is_open()) {
+        std::cout << "Error: No se pudo abrir el archivo original para comparar: " << original << std::endl;
+        return "";
+    }
+    if (!salida.empty()) {
+        ofs.open(salida, std::ios::binary);
+        if (!ofs.is_open()) {
+            std::cout << "Error: No se pudo crear/abrir el archivo de salida para desencriptar: " << salida << std::endl;
+            return "";
+        }
     }
 
-    // Comparar carácter por carácter
-    char c1, c2;
-    size_t pos = 0;
-    
-    while (true) {
-        bool f1_has_data = static_cast<bool>(f1.get(c1));
-        bool f2_has_data = static_cast<bool>(f2.get(c2));
-        
-        // Si ambos llegaron al final al mismo tiempo, son iguales
-        if (!f1_has_data && !f2_has_data) {
-            f1.close();
-            f2.close();
-            return true;
+    KernelComparacion comparar = kernelComparacionActivo();
+    BufferPrestado buffer(TAM_BLOQUE_CIFRADO);
+    BufferPrestado buffer_original(TAM_BLOQUE_CIFRADO);
+    SHA256 sha256;
+    int64_t offset = 0;
+    while (ifs) {
+        ifs.read(buffer.data(), buffer.size());
+        std::streamsize leidos = ifs.gcount();
+        if (leidos <= 0) {
+            break;
         }
-        
-        // Si solo uno llegó al final, tienen diferentes longitudes
-        if (f1_has_data != f2_has_data) {
-            f1.close();
-            f2.close();
-            return false; // Diferentes longitudes
+        size_t n = static_cast<size_t>(leidos);
+        descifrarBloqueEnPosicion(buffer.data(), n, static_cast<uint64_t>(offset));
+        sha256.update(buffer.data(), n);
+        if (!salida.empty()) {
+            ofs.write(buffer.data(), leidos);
         }
-        
-        // Si ambos tienen datos pero son diferentes
-        if (c1 != c2) {
-            f1.close();
-            f2.close();
-            return false; // Contenido diferente
+        if (primer_distinto < 0) {
+            orig.read(buffer_original.data(), leidos);
+            size_t comunes = static_cast<size_t>(orig.gcount());
+            size_t k = comparar(reinterpret_cast<const uint8_t*>(buffer.data()),
+                                reinterpret_cast<const uint8_t*>(buffer_original.data()), comunes);
+            if (k < comunes || comunes < n) {
+                primer_distinto = offset + static_cast<int64_t>(k);
+            }
         }
-        
-        pos++;
+        offset += leidos;
+    }
+    // Si el original sigue teniendo datos, es más largo que el descifrado
+    if (primer_distinto < 0 && orig.peek() != std::char_traits<char>::eof()) {
+        primer_distinto = offset;
+    }
+    if (!salida.empty() && !ofs) {
+        std::cout << "Error: Fallo la escritura de " << salida << std::endl;
+        return "";
     }
+
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
+}
+
+bool validarHashSHA256(const std::string& rutaArchivoEncriptado, const std::string& hashEsperado) {
+    std::string hashCalculado = generarHashSHA256(rutaArchivoEncriptado);
+    return hashCalculado == hashEsperado;
+}
+
+// Compara por tamaño y después por bloques con el kernel SIMD (ver Comparacion.h).
+// Si difieren, informa del primer byte distinto o de los dos tamaños.
+bool compararArchivos(const std::string& archivo1, const std::string& archivo2, BackendES es, PoolHilos* pool) {
+    ResultadoComparacion resultado = compararArchivosPorBloques(archivo1, archivo2, es, pool);
+    if (resultado.error) {
+        std::cout << "Error: No se pudieron abrir los archivos para comparar. Archivo1: " << archivo1 << ", Archivo2: " << archivo2 << std::endl;
+        return false;
+    }
+    if (resultado.iguales) {
+        return true;
+    }
+    if (resultado.primer_distinto >= 0) {
+        std::cout << archivo1 << " y " << archivo2 << " difieren a partir del byte " << resultado.primer_distinto << std::endl;
+    } else {
+        std::cout << archivo1 << " (" << resultado.tam1 << " bytes) y " << archivo2 << " (" << resultado.tam2
+                  << " bytes) tienen distinto tamaño" << std::endl;
+    }
+    return false;
 }
 
 std::string formatDuration(long long microseconds) {
@@ -399,7 +773,23 @@ std::string formatDuration(long long microseconds) {
     return ss.str();
 }
 
-long long ejecutarProcesoBase(int N, const std::string& originalFileName) {
+// Tamaño del archivo para anotar las etapas de la traza (0 si no está activa)
+uint64_t bytesParaTraza(const std::string& ruta) {
+    int64_t tam = trazaActiva() ? tamArchivo(ruta) : 0;
+    return tam > 0 ? static_cast<uint64_t>(tam) : 0;
+}
+
+// Buffers que el pool tuvo que reservar durante un proceso. Con el pool por
+// thread no crece con el número de archivos: solo el primero de cada thread
+// (y de cada tamaño de bloque) reserva memoria. El hash multi-buffer pide un
+// único bloque para todos sus carriles, así que tampoco depende de N.
+void informarReservasBuffers(uint64_t reservas_previas, uint64_t bytes_previos, size_t num_archivos) {
+    const EstadisticasPoolBuffers& e = estadisticasPoolBuffers();
+    std::cout << "Buffers: " << (e.reservas.load() - reservas_previas) << " reservados ("
+              << (e.bytes_reservados.load() - bytes_previos) / 1024 << " KiB) para " << num_archivos << " archivos" << std::endl;
+}
+
+long long ejecutarProcesoBase(int N, const std::string& originalFileName, bool* hubo_errores) {
     auto ti_total_chrono = std::chrono::high_resolution_clock::now();
     
     std::cout << "---------------------------------------------------------------" << std::endl;
@@ -416,40 +806,68 @@ long long ejecutarProcesoBase(int N, const std::string& originalFileName) {
         std::string copiaFileName = std::to_string(i) + ".txt";
         std::string encriptadoFileName = std::to_string(i) + ".enc";
         std::string hashFileName = std::to_string(i) + ".sha";
-        std::string desencriptadoFileName = std::to_string(i) + "2.txt";
-
-        copiarArchivo(originalFileName, copiaFileName);
-        encriptarArchivo(copiaFileName, encriptadoFileName);
-        std::string hash_generado = generarHashSHA256(copiaFileName);
-        std::ofstream hash_ofs(hashFileName);
-        if (hash_ofs.is_open()) {
-            hash_ofs << hash_generado;
-            hash_ofs.close();
-        } else {
-            std::cout << "Error: No se pudo crear el archivo hash: " << hashFileName << std::endl;
-            errores_verificacion = true;
+        std::string desencriptadoFileName = nombreArchivoDesencriptado(i, N);
+
+        const uint64_t bytes = bytesParaTraza(originalFileName);
+
+        {
+            EtapaTraza etapa("copiar", bytes, i);
+            copiarArchivo(originalFileName, copiaFileName);
+        }
+        {
+            EtapaTraza etapa("cifrar", bytes, i);
+            transformarArchivoPorCaracter(copiaFileName, encriptadoFileName, true);
+        }
+        std::string hash_generado;
+        {
+            EtapaTraza etapa("hash", bytes, i);
+            hash_generado = generarHashSHA256(copiaFileName);
+        }
+        {
+            EtapaTraza etapa("escribir_sha", 0, i);
+            std::ofstream hash_ofs(hashFileName);
+            if (hash_ofs.is_open()) {
+                hash_ofs << hash_generado;
+                hash_ofs.close();
+            } else {
+                std::cout << "Error: No se pudo crear el archivo hash: " << hashFileName << std::endl;
+                errores_verificacion = true;
+            }
         }
 
-        desencriptarArchivo(encriptadoFileName, desencriptadoFileName);
+        {
+            EtapaTraza etapa("descifrar", bytes, i);
+            transformarArchivoPorCaracter(encriptadoFileName, desencriptadoFileName, false);
+        }
         std::string hash_leido_para_validacion;
-        std::ifstream hash_ifs(hashFileName);
-        if (hash_ifs.is_open()) {
-            hash_ifs >> hash_leido_para_validacion;
-            hash_ifs.close();
-        } else {
-            std::cout << "Error: No se pudo leer el archivo hash: " << hashFileName << std::endl;
-            errores_verificacion = true;
+        {
+            EtapaTraza etapa("leer_sha", 0, i);
+            std::ifstream hash_ifs(hashFileName);
+            if (hash_ifs.is_open()) {
+                hash_ifs >> hash_leido_para_validacion;
+                hash_ifs.close();
+            } else {
+                std::cout << "Error: No se pudo leer el archivo hash: " << hashFileName << std::endl;
+                errores_verificacion = true;
+            }
         }
 
-        std::string hash_desencriptado = generarHashSHA256(desencriptadoFileName);
+        std::string hash_desencriptado;
+        {
+            EtapaTraza etapa("hash_verificacion", bytes, i);
+            hash_desencriptado = generarHashSHA256(desencriptadoFileName);
+        }
         if (!errores_verificacion && hash_desencriptado != hash_leido_para_validacion) {
             std::cout << "Error de validacion de hash para el archivo " << encriptadoFileName << std::endl;
             errores_verificacion = true;
         }
 
-        if (!errores_verificacion && !compararArchivos(originalFileName, desencriptadoFileName)) {
-            std::cout << "Error: El archivo desencriptado " << desencriptadoFileName << " no coincide con el original." << std::endl;
-            errores_verificacion = true;
+        if (!errores_verificacion) {
+            EtapaTraza etapa("comparar", bytes, i);
+            if (!compararArchivos(originalFileName, desencriptadoFileName)) {
+                std::cout << "Error: El archivo desencriptado " << desencriptadoFileName << " no coincide con el original." << std::endl;
+                errores_verificacion = true;
+            }
         }
 
         auto end_file_process = std::chrono::high_resolution_clock::now();
@@ -485,57 +903,107 @@ long long ejecutarProcesoBase(int N, const std::string& originalFileName) {
     
     std::cout << "---------------------------------------------------------------" << std::endl;
 
+    if (hubo_errores != nullptr) {
+        *hubo_errores = errores_verificacion;
+    }
     return tt_total.count();
 }
 
-void ejecutarProcesoOptimizado(int N, const std::string& originalFileName, long long tiempoBase) {
+long long ejecutarProcesoOptimizado(int N, const std::string& originalFileName, long long tiempoBase, const OpcionesPrograma& opciones, bool* hubo_errores) {
     auto ti_total_chrono = std::chrono::high_resolution_clock::now();
     
     std::cout << "---------------------------------------------------------------" << std::endl;
     std::cout << "PROCESO OPTIMIZADO" << std::endl;
     std::cout.flush();
     std::cout << "TI: " << formatDuration(0) << std::endl;
+    const uint64_t reservas_previas = estadisticasPoolBuffers().reservas.load();
+    const uint64_t bytes_reservados_previos = estadisticasPoolBuffers().bytes_reservados.load();
 
     std::vector<long long> tiempos_por_archivo(N, 0);
     bool errores_verificacion = false;
     std::mutex mtx;
 
-    // Optimización: Determinar número de threads óptimo
-    unsigned int num_threads = std::thread::hardware_concurrency();
-    if (num_threads == 0) num_threads = 4;
-    
-    // Optimización: Limitar threads para evitar overhead
-    if (num_threads > 8) num_threads = 8;
-    
-    std::cout << "Usando " << num_threads << " threads para optimizacion" << std::endl;
+    // Optimización: Determinar número de threads óptimo (salvo que se indique con --hilos)
+    unsigned int num_threads = opciones.hilos;
+    if (num_threads == 0) {
+        num_threads = std::thread::hardware_concurrency();
+        if (num_threads == 0) num_threads = 4;
 
-    // Optimización: Usar std::async para mejor gestión de threads
-    std::vector<std::future<void>> futures;
-    
-    // Lanzar todos los trabajos en paralelo
-    for (int i = 1; i <= N; ++i) {
-        futures.emplace_back(std::async(std::launch::async, procesarArchivo, i, 
-                                       std::ref(originalFileName), std::ref(tiempos_por_archivo), 
-                                       std::ref(mtx), std::ref(errores_verificacion)));
-    }
-    
-    // Esperar a que todos terminen
-    for (auto& future : futures) {
-        future.wait();
+        // Optimización: Limitar threads para evitar overhead
+        if (num_threads > 8) num_threads = 8;
     }
 
-    auto tfin_total_chrono = std::chrono::high_resolution_clock::now();
-    auto tt_total = std::chrono::duration_cast<std::chrono::microseconds>(tfin_total_chrono - ti_total_chrono);
+    // Un único pool para todo el proceso: los N trabajos se reparten entre
+    // num_threads threads fijos en lugar de crear un thread por archivo
+    PoolHilos pool(num_threads, [&opciones](unsigned int indice) {
+        fijarTrabajador(static_cast<int>(indice), opciones.afinidad);
+        RegistroTraza::instancia().nombrarHilo("trabajador " + std::to_string(indice));
+    });
 
-    long long sum_tiempos = 0;
-    for (long long t : tiempos_por_archivo) {
-        sum_tiempos += t;
+    std::cout << "Usando " << num_threads << " threads para optimizacion" << std::endl;
+    std::cout << "Backend SHA-256: " << SHA256::nombreBackend(SHA256::backendActivo()) << std::endl;
+    std::cout << "Motor de cifrado: " << motorCifradoActivo().nombre() << std::endl;
+    std::cout << "Backend E/S: " << nombreBackendES(opciones.es) << std::endl;
+    std::cout << "Topologia: " << describirTopologia(topologiaCPU()) << std::endl;
+    std::cout << "Afinidad de threads: " << nombreDisposicion(opciones.afinidad) << std::endl;
+    if (opciones.rangos != ModoRangos::Nunca) {
+        std::cout << "Cifrado por rangos: " << (opciones.rangos == ModoRangos::Siempre ? "siempre" : "auto")
+                  << ", " << opciones.tamRango / (1024 * 1024) << " MiB por rango" << std::endl;
     }
-    long long tppa_microseconds = (N > 0) ? (sum_tiempos / N) : 0;
-
+    if (opciones.formatoHash == FormatoHash::Merkle) {
+        std::cout << "Manifiesto .sha: Merkle, hojas de " << opciones.tamHoja / 1024 << " KiB" << std::endl;
+    } else if (opciones.fusionado) {
+        std::cout << "Modo fusionado: copia, cifrado y hash en una sola lectura" << std::endl;
+    }
+    if (opciones.verificacionEnMemoria && opciones.formatoHash == FormatoHash::Plano) {
+        std::cout << "Verificacion en memoria: descifrado, hash y comparacion en una pasada"
+                  << (opciones.conservarDescifrado ? " (se conserva el descifrado)" : " (sin escribir el descifrado)") << std::endl;
+    }
+
+    // Optimización: con muchos archivos los hashes se calculan en lote (multi-buffer)
+    // (el modo fusionado ya calcula los hashes durante la lectura, no lo necesita).
+    // Con io_uring y el flujo normal (sin fusionado, verificación en memoria ni
+    // Merkle) se trabaja por lotes: la copia y el cifrado de todos los archivos
+    // comparten un mismo anillo. Con esas opciones cada archivo abre el suyo
+    // (parsearArgumentos ya avisó).
+    bool lote_io_uring = opciones.es == BackendES::IoUring;
+    bool usar_hash_lote = !opciones.fusionado && !opciones.verificacionEnMemoria && opciones.formatoHash == FormatoHash::Plano &&
+                          (lote_io_uring || opciones.hashLote == ModoHashLote::Siempre ||
+                           (opciones.hashLote == ModoHashLote::Auto && N >= 32 && SHA256Lote::superaFlujoSimple()));
+
+    if (usar_hash_lote) {
+        std::cout << "Hash multi-buffer: " << SHA256Lote::carrilesDisponibles() << " carriles" << std::endl;
+        procesarArchivosConHashLote(N, originalFileName, pool, opciones, tiempos_por_archivo, mtx, errores_verificacion);
+    } else {
+        // Lanzar todos los trabajos al pool
+        GrupoTareas trabajos(pool);
+        for (int i = 1; i <= N; ++i) {
+            trabajos.lanzar([i, N, &originalFileName, &opciones, &pool, &tiempos_por_archivo, &mtx, &errores_verificacion]() {
+                procesarArchivo(i, N, originalFileName, opciones, pool, tiempos_por_archivo, mtx, errores_verificacion);
+            });
+        }
+
+        // Esperar a que todos terminen
+        trabajos.esperar();
+    }
+
+    auto tfin_total_chrono = std::chrono::high_resolution_clock::now();
+    auto tt_total = std::chrono::duration_cast<std::chrono::microseconds>(tfin_total_chrono - ti_total_chrono);
+
+    long long sum_tiempos = 0;
+    for (long long t : tiempos_por_archivo) {
+        sum_tiempos += t;
+    }
+    long long tppa_microseconds = (N > 0) ? (sum_tiempos / N) : 0;
+
     std::cout << "TFIN : " << formatDuration(tt_total.count()) << std::endl;
     std::cout << "TPPA : " << formatDuration(tppa_microseconds) << std::endl;
     std::cout << "TT: " << formatDuration(tt_total.count()) << std::endl;
+    std::string metodos_copia = describirMetodosCopia();
+    if (!metodos_copia.empty()) {
+        std::cout << "Copias: " << metodos_copia << std::endl;
+    }
+    informarReservasBuffers(reservas_previas, bytes_reservados_previos, N);
 
     if (errores_verificacion) {
         std::cout << "Hubo errores en la verificacion final." << std::endl;
@@ -550,55 +1018,274 @@ void ejecutarProcesoOptimizado(int N, const std::string& originalFileName, long
     std::cout << "DF: " << formatDuration(df_microseconds) << std::endl;
     std::cout << "PM: " << std::fixed << std::setprecision(2) << pm_porcentaje << " %" << std::endl;
     std::cout << "---------------------------------------------------------------" << std::endl;
+
+    if (hubo_errores != nullptr) {
+        *hubo_errores = errores_verificacion;
+    }
+    return tt_total.count();
+}
+
+// Modo --benchmark: cada combinacion de archivo (el original o corpus
+// sinteticos generados), N y threads se ejecuta 'calentamiento' veces sin
+// medir y 'repeticiones' veces midiendo, con la salida de los procesos
+// silenciada. Se informa mediana, p95, p99, desviacion y MB/s (N copias del
+// archivo por repeticion), y opcionalmente se guarda en JSON/CSV.
+int ejecutarBenchmark(const OpcionesPrograma& opciones) {
+    std::vector<std::string> archivos;
+    std::vector<std::string> generados;
+    if (opciones.benchTamanos.empty()) {
+        archivos.push_back(opciones.archivoOriginal);
+    }
+    for (uint64_t tam : opciones.benchTamanos) {
+        std::string ruta = "bench_" + std::to_string(tam) + ".txt";
+        std::cout << "Generando corpus sintetico " << ruta << " (" << tam << " bytes)..." << std::endl;
+        if (!generarCorpusSintetico(ruta, tam)) {
+            std::cout << "Error: No se pudo generar el corpus " << ruta << std::endl;
+            return 1;
+        }
+        archivos.push_back(ruta);
+        generados.push_back(ruta);
+    }
+    std::vector<int> valores_n = opciones.benchN.empty() ? std::vector<int>{opciones.N} : opciones.benchN;
+    std::vector<unsigned int> valores_hilos = opciones.benchHilos.empty() ? std::vector<unsigned int>{opciones.hilos} : opciones.benchHilos;
+
+    std::cout << "---------------------------------------------------------------" << std::endl;
+    std::cout << "BENCHMARK" << std::endl;
+    std::cout << "Calentamiento: " << opciones.calentamiento << ", repeticiones: " << opciones.repeticiones
+              << ", cache de paginas: " << (opciones.vaciarCache ? "vaciada en cada repeticion" : "caliente") << std::endl;
+    std::cout << "Backend E/S: " << nombreBackendES(opciones.es) << ", topologia: " << describirTopologia(topologiaCPU()) << std::endl;
+    std::cout << "Motor de cifrado: " << motorCifradoActivo().nombre() << std::endl;
+
+    // Rendimiento en memoria de cada motor del registro (un thread, buffer de
+    // 4 MiB en el lugar). Los motores con clave se miden con una clave de ceros.
+    std::vector<std::pair<std::string, std::string>> rendimiento_motores;
+    {
+        const size_t TAM_MEDIDA = 4 * 1024 * 1024;
+        BufferPrestado buffer(TAM_MEDIDA);
+        for (size_t i = 0; i < TAM_MEDIDA; ++i) {
+            buffer.data()[i] = static_cast<char>('a' + i % 26);
+        }
+        std::cout << "Cifrado en memoria por motor (1 thread):" << std::endl;
+        for (const DescripcionMotorCifrado& d : registroMotoresCifrado()) {
+            std::cout << "  " << std::setfill(' ') << std::left << std::setw(12) << d.id << std::right;
+            std::string error;
+            std::unique_ptr<MotorCifrado> motor = crearMotorCifrado(d.id, std::string(2 * d.tam_clave, '0'),
+                                                                    std::string(d.tam_clave > 0 ? 2 * TAM_BLOQUE_AES : 0, '0'), error);
+            if (!motor) {
+                std::cout << error << std::endl;
+                continue;
+            }
+            double mb_por_segundo = medirRendimientoMotor(*motor, buffer.data(), TAM_MEDIDA);
+            std::cout << std::fixed << std::setprecision(1) << mb_por_segundo << " MB/s  (" << motor->nombre() << ")" << std::endl;
+            std::ostringstream valor;
+            valor << std::fixed << std::setprecision(1) << mb_por_segundo;
+            rendimiento_motores.push_back({std::string("mb_por_s_motor_") + d.id, valor.str()});
+        }
+    }
+
+    std::vector<ResultadoBenchmark> resultados;
+    const char* metodo_cache = nullptr;
+    bool errores = false;
+    for (const std::string& archivo : archivos) {
+        int64_t tam = tamArchivo(archivo);
+        if (tam < 0) {
+            std::cout << "Error: No se pudo abrir el archivo a medir: " << archivo << std::endl;
+            errores = true;
+            continue;
+        }
+        for (int N : valores_n) {
+            // El proceso base es secuencial: se mide una vez por (archivo, N)
+            std::vector<std::pair<bool, unsigned int>> procesos;
+            if (opciones.benchBase) {
+                procesos.push_back({true, 1});
+            }
+            for (unsigned int hilos : valores_hilos) {
+                procesos.push_back({false, hilos});
+            }
+            for (const auto& proceso : procesos) {
+                OpcionesPrograma config = opciones;
+                config.hilos = proceso.second;
+
+                ResultadoBenchmark r;
+                r.proceso = proceso.first ? "base" : "optimizado";
+                r.archivo = archivo;
+                r.tam_archivo = static_cast<uint64_t>(tam);
+                r.N = N;
+                r.hilos = proceso.second;
+                r.backend_es = proceso.first ? nombreBackendES(BackendES::Flujo) : nombreBackendES(opciones.es);
+
+                std::vector<long long> muestras;
+                for (int k = 0; k < opciones.calentamiento + opciones.repeticiones; ++k) {
+                    bool errores_repeticion = false;
+                    long long tiempo;
+                    {
+                        SilenciarSalida silencio;
+                        limpiarArchivosExistentes(N);
+                        if (opciones.vaciarCache) {
+                            metodo_cache = vaciarCachePaginas({archivo});
+                        }
+                        tiempo = proceso.first ? ejecutarProcesoBase(N, archivo, &errores_repeticion)
+                                               : ejecutarProcesoOptimizado(N, archivo, 0, config, &errores_repeticion);
+                    }
+                    r.errores |= errores_repeticion;
+                    if (k >= opciones.calentamiento) {
+                        muestras.push_back(tiempo);
+                    }
+                }
+                r.tiempos = calcularEstadisticas(muestras);
+                if (r.tiempos.mediana > 0) {
+                    r.mb_por_segundo = (static_cast<double>(N) * static_cast<double>(tam)) / r.tiempos.mediana;   // bytes/us = MB/s
+                }
+                errores |= r.errores;
+                resultados.push_back(r);
+
+                std::cout << std::setfill(' ') << std::left << std::setw(10) << r.proceso << std::right
+                          << " " << archivo << " N=" << N << " hilos=" << (r.hilos == 0 ? std::string("auto") : std::to_string(r.hilos))
+                          << " | mediana " << formatDuration(static_cast<long long>(r.tiempos.mediana))
+                          << "  p95 " << formatDuration(static_cast<long long>(r.tiempos.p95))
+                          << "  p99 " << formatDuration(static_cast<long long>(r.tiempos.p99))
+                          << "  desv " << std::fixed << std::setprecision(2) << r.tiempos.desviacion / 1000.0 << " ms"
+                          << "  " << std::setprecision(1) << r.mb_por_segundo << " MB/s"
+                          << (r.errores ? "  [ERRORES]" : "") << std::endl;
+            }
+            SilenciarSalida silencio;
+            limpiarArchivosExistentes(N);
+        }
+    }
+    for (const std::string& ruta : generados) {
+        remove(ruta.c_str());
+    }
+    if (opciones.vaciarCache && metodo_cache == nullptr) {
+        std::cout << "Aviso: No se pudo vaciar la cache de paginas; las repeticiones se midieron en caliente." << std::endl;
+    }
+
+    std::vector<std::pair<std::string, std::string>> metadatos = {
+        {"fecha", fechaISO8601()},
+        {"topologia", describirTopologia(topologiaCPU())},
+        {"backend_sha256", SHA256::nombreBackend(SHA256::backendActivo())},
+        {"backend_cifrado", nombreBackendCifrado(backendCifradoActivo())},
+        {"motor_cifrado", motorCifradoActivo().nombre()},
+        {"calentamiento", std::to_string(opciones.calentamiento)},
+        {"repeticiones", std::to_string(opciones.repeticiones)},
+        {"cache", opciones.vaciarCache ? (metodo_cache != nullptr ? metodo_cache : "sin vaciar") : "caliente"},
+    };
+    metadatos.insert(metadatos.end(), rendimiento_motores.begin(), rendimiento_motores.end());
+    if (!opciones.benchJSON.empty() && !escribirJSONBenchmark(opciones.benchJSON, metadatos, resultados)) {
+        std::cout << "Error: No se pudo escribir el informe JSON: " << opciones.benchJSON << std::endl;
+        errores = true;
+    }
+    if (!opciones.benchCSV.empty() && !escribirCSVBenchmark(opciones.benchCSV, resultados)) {
+        std::cout << "Error: No se pudo escribir el informe CSV: " << opciones.benchCSV << std::endl;
+        errores = true;
+    }
+    std::cout << "---------------------------------------------------------------" << std::endl;
+    return errores ? 1 : 0;
 }
 
 // Función para procesar un archivo individual (para usar en threads)
-void procesarArchivo(int i, const std::string& originalFileName, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion) {
+void procesarArchivo(int i, int N, const std::string& originalFileName, const OpcionesPrograma& opciones, PoolHilos& pool, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion) {
     auto start_file_process = std::chrono::high_resolution_clock::now();
 
     std::string copiaFileName = std::to_string(i) + ".txt";
     std::string encriptadoFileName = std::to_string(i) + ".enc";
     std::string hashFileName = std::to_string(i) + ".sha";
-    std::string desencriptadoFileName = std::to_string(i) + "2.txt";
+    std::string desencriptadoFileName = nombreArchivoDesencriptado(i, N);
+
+    const uint64_t bytes = bytesParaTraza(originalFileName);
+
+    // Resultado de la comparación cuando se hace durante el descifrado en memoria
+    bool comparado_en_memoria = false;
+    int64_t primer_distinto = -1;
 
     // Procesar archivo individual
-    copiarArchivo(originalFileName, copiaFileName);
-    encriptarArchivo(copiaFileName, encriptadoFileName);
-    std::string hash_generado = generarHashSHA256(copiaFileName);
-    
-    std::ofstream hash_ofs(hashFileName);
-    if (hash_ofs.is_open()) {
-        hash_ofs << hash_generado;
-        hash_ofs.close();
+    if (opciones.formatoHash == FormatoHash::Merkle) {
+        generarYValidarManifiestoMerkle(originalFileName, copiaFileName, encriptadoFileName, hashFileName,
+                                        desencriptadoFileName, N, opciones, pool, mtx, errores_verificacion);
     } else {
-        std::lock_guard<std::mutex> lock(mtx);
-        std::cout << "Error: No se pudo crear el archivo hash: " << hashFileName << std::endl;
-        errores_verificacion = true;
-    }
+        std::string hash_generado;
+        if (opciones.fusionado) {
+            EtapaTraza etapa("copiar_cifrar_hash", bytes, i);
+            hash_generado = copiarEncriptarYHashear(originalFileName, copiaFileName, encriptadoFileName, opciones.es);
+        } else {
+            {
+                EtapaTraza etapa("copiar", bytes, i);
+                copiarArchivoOptimizado(originalFileName, copiaFileName, opciones);
+            }
+            {
+                EtapaTraza etapa("cifrar", bytes, i);
+                transformarArchivoOptimizado(copiaFileName, encriptadoFileName, true, N, opciones, pool);
+            }
+            EtapaTraza etapa("hash", bytes, i);
+            hash_generado = generarHashSHA256(copiaFileName, opciones.es);
+        }
+    
+        {
+            EtapaTraza etapa("escribir_sha", 0, i);
+            std::ofstream hash_ofs(hashFileName);
+            if (hash_ofs.is_open()) {
+                hash_ofs << hash_generado;
+                hash_ofs.close();
+            } else {
+                std::lock_guard<std::mutex> lock(mtx);
+                std::cout << "Error: No se pudo crear el archivo hash: " << hashFileName << std::endl;
+                errores_verificacion = true;
+            }
+        }
 
-    desencriptarArchivo(encriptadoFileName, desencriptadoFileName);
-    std::string hash_leido_para_validacion;
-    std::ifstream hash_ifs(hashFileName);
-    if (hash_ifs.is_open()) {
-        hash_ifs >> hash_leido_para_validacion;
-        hash_ifs.close();
-    } else {
-        std::lock_guard<std::mutex> lock(mtx);
-        std::cout << "Error: No se pudo leer el archivo hash: " << hashFileName << std::endl;
-        errores_verificacion = true;
-    }
+        // En modo fusionado el descifrado se hashea mientras se escribe; en la
+        // verificación en memoria además se compara con el original sin escribirlo
+        std::string hash_desencriptado;
+        if (opciones.verificacionEnMemoria) {
+            EtapaTraza etapa("descifrar_hash_comparar", bytes, i);
+            const std::string salida = opciones.conservarDescifrado ? desencriptadoFileName : "";
+            hash_desencriptado = desencriptarHashearYComparar(encriptadoFileName, originalFileName, salida, opciones.es, primer_distinto);
+            comparado_en_memoria = true;
+        } else if (opciones.fusionado) {
+            EtapaTraza etapa("descifrar_hash", bytes, i);
+            hash_desencriptado = desencriptarYHashear(encriptadoFileName, desencriptadoFileName, opciones.es);
+        } else {
+            EtapaTraza etapa("descifrar", bytes, i);
+            transformarArchivoOptimizado(encriptadoFileName, desencriptadoFileName, false, N, opciones, pool);
+        }
+        std::string hash_leido_para_validacion;
+        {
+            EtapaTraza etapa("leer_sha", 0, i);
+            std::ifstream hash_ifs(hashFileName);
+            if (hash_ifs.is_open()) {
+                hash_ifs >> hash_leido_para_validacion;
+                hash_ifs.close();
+            } else {
+                std::lock_guard<std::mutex> lock(mtx);
+                std::cout << "Error: No se pudo leer el archivo hash: " << hashFileName << std::endl;
+                errores_verificacion = true;
+            }
+        }
 
-    std::string hash_desencriptado = generarHashSHA256(desencriptadoFileName);
-    if (!errores_verificacion && hash_desencriptado != hash_leido_para_validacion) {
-        std::lock_guard<std::mutex> lock(mtx);
-        std::cout << "Error de validacion de hash para el archivo " << encriptadoFileName << std::endl;
-        errores_verificacion = true;
+        if (!opciones.fusionado && !opciones.verificacionEnMemoria) {
+            EtapaTraza etapa("hash_verificacion", bytes, i);
+            hash_desencriptado = generarHashSHA256(desencriptadoFileName, opciones.es);
+        }
+        if (!errores_verificacion && hash_desencriptado != hash_leido_para_validacion) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::cout << "Error de validacion de hash para el archivo " << encriptadoFileName << std::endl;
+            errores_verificacion = true;
+        }
     }
 
-    if (!errores_verificacion && !compararArchivos(originalFileName, desencriptadoFileName)) {
-        std::lock_guard<std::mutex> lock(mtx);
-        std::cout << "Error: El archivo desencriptado " << desencriptadoFileName << " no coincide con el original." << std::endl;
-        errores_verificacion = true;
+    if (comparado_en_memoria) {
+        if (!errores_verificacion && primer_distinto >= 0) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::cout << "Error: El descifrado de " << encriptadoFileName << " no coincide con el original a partir del byte "
+                      << primer_distinto << "." << std::endl;
+            errores_verificacion = true;
+        }
+    } else if (!errores_verificacion) {
+        EtapaTraza etapa("comparar", bytes, i);
+        if (!compararArchivos(originalFileName, desencriptadoFileName, opciones.es, &pool)) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::cout << "Error: El archivo desencriptado " << desencriptadoFileName << " no coincide con el original." << std::endl;
+            errores_verificacion = true;
+        }
     }
 
     auto end_file_process = std::chrono::high_resolution_clock::now();
@@ -618,13 +1305,1263 @@ void procesarArchivo(int i, const std::string& originalFileName, std::vector<lon
     // NO eliminar desencriptadoFileName para poder revisarlo
 }
 
-// Función para optimizar la configuración de Windows
-void optimizarConfiguracionWindows() {
+// Variante de procesarArchivo con manifiesto Merkle: el .sha guarda los
+// hashes de las hojas de la copia y el descifrado se verifica hoja a hoja,
+// ambos repartidos entre los threads del pool
+void generarYValidarManifiestoMerkle(const std::string& originalFileName, const std::string& copiaFileName, const std::string& encriptadoFileName,
+                                     const std::string& hashFileName, const std::string& desencriptadoFileName, int N,
+                                     const OpcionesPrograma& opciones, PoolHilos& pool, std::mutex& mtx, bool& errores_verificacion) {
+    const uint64_t bytes = bytesParaTraza(originalFileName);
+    {
+        EtapaTraza etapa("copiar", bytes);
+        copiarArchivoOptimizado(originalFileName, copiaFileName, opciones);
+    }
+    {
+        EtapaTraza etapa("cifrar", bytes);
+        transformarArchivoOptimizado(copiaFileName, encriptadoFileName, true, N, opciones, pool);
+    }
+
+    {
+        EtapaTraza etapa("manifiesto_merkle", bytes);
+        ManifiestoMerkle manifiesto;
+        if (!ManifiestoMerkle::construirArchivo(copiaFileName, opciones.tamHoja, &pool, manifiesto) || !manifiesto.guardar(hashFileName)) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::cout << "Error: No se pudo crear el archivo hash: " << hashFileName << std::endl;
+            errores_verificacion = true;
+        }
+    }
+
+    {
+        EtapaTraza etapa("descifrar", bytes);
+        transformarArchivoOptimizado(encriptadoFileName, desencriptadoFileName, false, N, opciones, pool);
+    }
+
+    ManifiestoMerkle leido;
+    if (!leido.cargar(hashFileName)) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::cout << "Error: No se pudo leer el archivo hash: " << hashFileName << std::endl;
+        errores_verificacion = true;
+        return;
+    }
+    EtapaTraza etapa("verificar_merkle", bytes);
+    std::string detalle;
+    if (!errores_verificacion && !leido.verificarArchivo(desencriptadoFileName, &pool, detalle)) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::cout << "Error de validacion de hash para el archivo " << encriptadoFileName << ": " << detalle << std::endl;
+        errores_verificacion = true;
+    }
+}
+
+// Decide si un archivo se cifra repartido por rangos entre los threads del pool.
+// En modo automatico solo compensa con archivos grandes y menos archivos que
+// threads; con muchos archivos el paralelismo entre archivos ya ocupa el pool.
+bool dividirEnRangos(const std::string& entrada, int N, const OpcionesPrograma& opciones, const PoolHilos& pool) {
+#if SO_TIENE_MMAP
+    if (opciones.rangos == ModoRangos::Nunca || pool.numHilos() < 2) {
+        return false;
+    }
+    int64_t tam = tamArchivo(entrada);
+    if (tam <= static_cast<int64_t>(opciones.tamRango)) {
+        return false;
+    }
+    return opciones.rangos == ModoRangos::Siempre ||
+           (static_cast<unsigned int>(N) < pool.numHilos() && tam >= static_cast<int64_t>(UMBRAL_RANGOS));
+#else
+    (void)entrada; (void)N; (void)opciones; (void)pool;
+    return false;
+#endif
+}
+
+// Cifra o descifra un archivo repartiéndolo en rangos de opciones.tamRango
+// bytes que los threads del pool procesan a la vez. La salida se crea con su
+// tamaño final y cada rango se escribe en su posición: sobre el mapa de la
+// salida con mmap, o con pread/pwrite con el backend de flujos.
+bool transformarArchivoPorRangos(const std::string& entrada, const std::string& salida, bool cifrar, const OpcionesPrograma& opciones, PoolHilos& pool) {
+#if SO_TIENE_MMAP
+    const char* accion = cifrar ? "encriptar" : "desencriptar";
+    const size_t tam_rango = opciones.tamRango;
+    const MotorCifrado& motor = motorCifradoActivo();   // Los rangos corren en otros threads
+    bool errores = false;
+    std::mutex mtx_errores;
+
+    if (opciones.es == BackendES::Mmap) {
+        ArchivoMapeado src;
+        ArchivoMapeado dst;
+        if (!src.abrirLectura(entrada)) {
+            std::cout << "Error: No se pudo abrir el archivo de entrada para " << accion << ": " << entrada << std::endl;
+            return false;
+        }
+        if (!dst.crearEscritura(salida, src.tam())) {
+            std::cout << "Error: No se pudo crear/abrir el archivo de salida para " << accion << ": " << salida << std::endl;
+            return false;
+        }
+        GrupoTareas rangos(pool);
+        for (size_t offset = 0; offset < src.tam(); offset += tam_rango) {
+            size_t n = std::min(tam_rango, src.tam() - offset);
+            rangos.lanzar([&src, &dst, &motor, offset, n, cifrar]() {
+                EtapaTraza etapa(cifrar ? "cifrar_rango" : "descifrar_rango", n);
+                if (cifrar) {
+                    motor.cifrar(src.datos() + offset, dst.datos() + offset, n, offset);
+                } else {
+                    motor.descifrar(src.datos() + offset, dst.datos() + offset, n, offset);
+                }
+            });
+        }
+        rangos.esperar();
+        return true;
+    }
+
+    ArchivoPosicional src;
+    ArchivoPosicional dst;
+    if (!src.abrirLectura(entrada)) {
+        std::cout << "Error: No se pudo abrir el archivo de entrada para " << accion << ": " << entrada << std::endl;
+        return false;
+    }
+    if (!dst.crearEscritura(salida, src.tam())) {
+        std::cout << "Error: No se pudo crear/abrir el archivo de salida para " << accion << ": " << salida << std::endl;
+        return false;
+    }
+    GrupoTareas rangos(pool);
+    for (size_t offset = 0; offset < src.tam(); offset += tam_rango) {
+        size_t fin = std::min(src.tam(), offset + tam_rango);
+        rangos.lanzar([&src, &dst, &motor, &errores, &mtx_errores, offset, fin, cifrar]() {
+            EtapaTraza etapa(cifrar ? "cifrar_rango" : "descifrar_rango", fin - offset);
+            BufferPrestado buffer(TAM_BLOQUE_CIFRADO);
+            for (size_t pos = offset; pos < fin; pos += TAM_BLOQUE_CIFRADO) {
+                size_t n = std::min(TAM_BLOQUE_CIFRADO, fin - pos);
+                if (!src.leerEn(buffer.data(), n, pos)) {
+                    std::lock_guard<std::mutex> lock(mtx_errores);
+                    errores = true;
+                    return;
+                }
+                if (cifrar) {
+                    motor.cifrar(buffer.data(), buffer.data(), n, pos);
+                } else {
+                    motor.descifrar(buffer.data(), buffer.data(), n, pos);
+                }
+                if (!dst.escribirEn(buffer.data(), n, pos)) {
+                    std::lock_guard<std::mutex> lock(mtx_errores);
+                    errores = true;
+                    return;
+                }
+            }
+        });
+    }
+    rangos.esperar();
+    if (errores) {
+        std::cout << "Error: Fallo la lectura o escritura por rangos de " << entrada << " en " << salida << std::endl;
+        return false;
+    }
+    return true;
+#else
+    (void)entrada; (void)salida; (void)cifrar; (void)opciones; (void)pool;
+    return false;
+#endif
+}
+
+// Modo filtro (--cifrar / --descifrar): transforma la entrada estándar hacia
+// la salida estándar, p. ej. tar c . | proyecto_so --cifrar | ssh ... Lectura,
+// cifrado y escritura se solapan en tres threads con un anillo fijo de buffers
+// (FiltroFlujo.h). El hash opcional es siempre del texto plano: antes de
+// cifrar o después de descifrar, para que ambos extremos obtengan el mismo.
+// Los mensajes van por stderr.
+int ejecutarFiltroFlujo(const OpcionesPrograma& opciones) {
+    const bool cifrar = opciones.filtro == ModoFiltro::Cifrar;
+    const bool hashear = opciones.hashFlujo || !opciones.rutaHashFlujo.empty();
+    SHA256 sha;
+    uint64_t posicion = 0;     // Los bloques llegan en orden: basta con sumar
+    auto procesar = [&](char* datos, size_t n) {
+        if (cifrar) {
+            if (hashear) {
+                sha.update(datos, n);
+            }
+            cifrarBloqueEnPosicion(datos, n, posicion);
+        } else {
+            descifrarBloqueEnPosicion(datos, n, posicion);
+            if (hashear) {
+                sha.update(datos, n);
+            }
+        }
+        posicion += n;
+    };
+
+    prepararFlujosBinarios();
+    uint64_t bytes = 0;
+    std::string error;
+    bool ok;
+    if (opciones.comprimir && cifrar) {
+        // Cada lectura se completa hasta un bloque entero: bloques pequeños comprimen peor
+        auto leer = [](char* destino, size_t n) -> long long {
+            size_t total = 0;
+            while (total < n) {
+                long long r = leerDescriptor(0, destino + total, n - total);
+                if (r < 0) {
+                    return -1;
+                }
+                if (r == 0) {
+                    break;
+                }
+                total += static_cast<size_t>(r);
+            }
+            return static_cast<long long>(total);
+        };
+        auto escribir = [](const char* origen, size_t n) { return escribirDescriptor(1, origen, n); };
+        ok = comprimirYCifrarFlujo(leer, escribir, hashear ? &sha : nullptr, bytes);
+        if (!ok) {
+            error = std::string("fallo la lectura o la escritura: ") + std::strerror(errno);
+        }
+    } else if (opciones.comprimir) {
+        auto leer_exacto = [](char* destino, size_t n) {
+            while (n > 0) {
+                long long r = leerDescriptor(0, destino, n);
+                if (r <= 0) {
+                    return false;
+                }
+                destino += r;
+                n -= static_cast<size_t>(r);
+            }
+            return true;
+        };
+        auto consumir = [&](const char* datos, size_t n) {
+            if (hashear) {
+                sha.update(datos, n);
+            }
+            bytes += n;
+            return escribirDescriptor(1, datos, n);
+        };
+        ok = descifrarYDescomprimirFlujo(leer_exacto, consumir, error);
+    } else {
+        ok = filtrarFlujo(0, 1, procesar, bytes, error, opciones.buffersFiltro, opciones.tamBufferFiltro);
+    }
+    if (!ok) {
+        std::cerr << "Error: " << error << " (" << bytes << " bytes de texto plano procesados)" << std::endl;
+        return 1;
+    }
+
+    if (hashear) {
+        uint8_t digest[SHA256::DIGEST_SIZE];
+        sha.finalize(digest);
+        std::string hash = SHA256::toHex(digest);
+        if (opciones.hashFlujo) {
+            std::cerr << "SHA-256: " << hash << "  (" << bytes << " bytes)" << std::endl;
+        }
+        if (!opciones.rutaHashFlujo.empty()) {
+            std::ofstream hash_ofs(opciones.rutaHashFlujo);
+            if (!hash_ofs.is_open() || !(hash_ofs << hash)) {
+                std::cerr << "Error: No se pudo crear el archivo hash: " << opciones.rutaHashFlujo << std::endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Marco LZ cifrado (CompresionLZ.h) de todo lo que entrega 'leer' (0 al final,
+// -1 si hay error), escrito a través de 'escribir'. Se cifra el marco entero,
+// cabeceras incluidas; el hash, si se pide, es del texto plano.
+bool comprimirYCifrarFlujo(const std::function<long long(char*, size_t)>& leer, const std::function<bool(const char*, size_t)>& escribir,
+                           SHA256* sha, uint64_t& bytes_plano) {
+    BufferPrestado plano(TAM_BLOQUE_LZ);
+    BufferPrestado bloque(TAM_CABECERA_BLOQUE_LZ + cotaComprimidoLZ(TAM_BLOQUE_LZ));
+    char cabecera[TAM_CABECERA_MARCO_LZ];
+    escribirCabeceraMarcoLZ(reinterpret_cast<uint8_t*>(cabecera));
+    cifrarBloqueEnPosicion(cabecera, sizeof(cabecera), 0);
+    if (!escribir(cabecera, sizeof(cabecera))) {
+        return false;
+    }
+    uint64_t escritos = sizeof(cabecera);
+    bytes_plano = 0;
+    while (true) {
+        long long n = leer(plano.data(), TAM_BLOQUE_LZ);
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (sha != nullptr) {
+            sha->update(plano.data(), static_cast<size_t>(n));
+        }
+        size_t len = comprimirBloqueConCabeceraLZ(reinterpret_cast<const uint8_t*>(plano.data()), static_cast<size_t>(n),
+                                                  reinterpret_cast<uint8_t*>(bloque.data()));
+        cifrarBloqueEnPosicion(bloque.data(), len, escritos);
+        if (!escribir(bloque.data(), len)) {
+            return false;
+        }
+        bytes_plano += static_cast<uint64_t>(n);
+        escritos += len;
+    }
+    char final_marco[TAM_CABECERA_BLOQUE_LZ] = {};
+    cifrarBloqueEnPosicion(final_marco, sizeof(final_marco), escritos);
+    if (!escribir(final_marco, sizeof(final_marco))) {
+        return false;
+    }
+    escritos += sizeof(final_marco);
+    EstadisticasCompresionLZ& e = estadisticasCompresionLZ();
+    e.entrada.fetch_add(bytes_plano, std::memory_order_relaxed);
+    e.salida.fetch_add(escritos, std::memory_order_relaxed);
+    return true;
+}
+
+// Recorre un marco LZ cifrado que se lee con 'leer_exacto' y entrega a
+// 'consumir' cada bloque ya descifrado y descomprimido, en orden
+bool descifrarYDescomprimirFlujo(const std::function<bool(char*, size_t)>& leer_exacto, const std::function<bool(const char*, size_t)>& consumir,
+                                 std::string& error) {
+    char cabecera[TAM_CABECERA_MARCO_LZ];
+    if (!leer_exacto(cabecera, sizeof(cabecera))) {
+        error = "falta la cabecera del marco comprimido";
+        return false;
+    }
+    uint64_t posicion = 0;     // Byte del marco cifrado, para el motor
+    descifrarBloqueEnPosicion(cabecera, sizeof(cabecera), posicion);
+    posicion += sizeof(cabecera);
+    if (!esCabeceraMarcoLZ(reinterpret_cast<const uint8_t*>(cabecera))) {
+        error = "los datos no son un marco comprimido (se cifraron sin --comprimir?)";
+        return false;
+    }
+    const size_t tam_bloque = leerLE32(reinterpret_cast<const uint8_t*>(cabecera) + 4);
+    BufferPrestado datos(cotaComprimidoLZ(tam_bloque));
+    BufferPrestado plano(tam_bloque);
+    while (true) {
+        char cabecera_bloque[TAM_CABECERA_BLOQUE_LZ];
+        CabeceraBloqueLZ c;
+        if (!leer_exacto(cabecera_bloque, sizeof(cabecera_bloque))) {
+            error = "el marco comprimido esta truncado";
+            return false;
+        }
+        descifrarBloqueEnPosicion(cabecera_bloque, sizeof(cabecera_bloque), posicion);
+        posicion += sizeof(cabecera_bloque);
+        if (!leerCabeceraBloqueLZ(reinterpret_cast<const uint8_t*>(cabecera_bloque), tam_bloque, c)) {
+            error = "cabecera de bloque no valida";
+            return false;
+        }
+        if (c.tam_original == 0) {
+            if (c.tam_guardado != 0) {
+                error = "cabecera de bloque no valida";
+                return false;
+            }
+            break;
+        }
+        if (!leer_exacto(datos.data(), c.tam_guardado)) {
+            error = "el marco comprimido esta truncado";
+            return false;
+        }
+        descifrarBloqueEnPosicion(datos.data(), c.tam_guardado, posicion);
+        posicion += c.tam_guardado;
+        if (!descomprimirDatosBloqueLZ(c, reinterpret_cast<const uint8_t*>(datos.data()), reinterpret_cast<uint8_t*>(plano.data()))) {
+            error = "bloque comprimido corrupto";
+            return false;
+        }
+        if (!consumir(plano.data(), c.tam_original)) {
+            error = "no se pudo entregar el texto descomprimido";
+            return false;
+        }
+    }
+    char extra;
+    if (leer_exacto(&extra, 1)) {
+        error = "hay datos despues del final del marco comprimido";
+        return false;
+    }
+    return true;
+}
+
+// .enc comprimido del modo por directorios. Con mmap, los bloques de
+// TAM_BLOQUE_LZ se comprimen en paralelo en el pool, por ventanas de dos
+// bloques por thread; después se cifran y se escriben en orden, cada uno en
+// la posición que suman los anteriores. Los errores vuelven en 'error' para
+// que el llamador los muestre con el lock de la consola.
+bool comprimirYCifrarArchivo(const std::string& entrada, const std::string& salida, PoolHilos& pool, std::string& error) {
+#if SO_TIENE_MMAP
+    ArchivoMapeado src;
+    if (!src.abrirLectura(entrada)) {
+        error = "No se pudo abrir el archivo de entrada para encriptar: " + entrada;
+        return false;
+    }
+    std::ofstream ofs(salida, std::ios::binary);
+    if (!ofs.is_open()) {
+        error = "No se pudo crear/abrir el archivo de salida para encriptar: " + salida;
+        return false;
+    }
+    const uint8_t* datos = reinterpret_cast<const uint8_t*>(src.datos());
+    const size_t tam_ranura = TAM_CABECERA_BLOQUE_LZ + cotaComprimidoLZ(TAM_BLOQUE_LZ);
+    const size_t ventana = 2 * static_cast<size_t>(pool.numHilos());
+    BufferPrestado ranuras(ventana * tam_ranura);
+    std::vector<size_t> longitudes(ventana, 0);
+
+    char cabecera[TAM_CABECERA_MARCO_LZ];
+    escribirCabeceraMarcoLZ(reinterpret_cast<uint8_t*>(cabecera));
+    cifrarBloqueEnPosicion(cabecera, sizeof(cabecera), 0);
+    bool escrito = static_cast<bool>(ofs.write(cabecera, sizeof(cabecera)));
+    uint64_t escritos = sizeof(cabecera);
+    for (size_t inicio = 0; escrito && inicio < src.tam(); inicio += ventana * TAM_BLOQUE_LZ) {
+        const size_t num = std::min(ventana, (src.tam() - inicio + TAM_BLOQUE_LZ - 1) / TAM_BLOQUE_LZ);
+        GrupoTareas bloques(pool);
+        for (size_t k = 0; k < num; ++k) {
+            bloques.lanzar([&src, &ranuras, &longitudes, datos, tam_ranura, inicio, k]() {
+                const size_t desde = inicio + k * TAM_BLOQUE_LZ;
+                const size_t n = std::min(TAM_BLOQUE_LZ, src.tam() - desde);
+                EtapaTraza etapa("comprimir_bloque", n);
+                longitudes[k] = comprimirBloqueConCabeceraLZ(datos + desde, n, reinterpret_cast<uint8_t*>(ranuras.data() + k * tam_ranura));
+            });
+        }
+        bloques.esperar();
+        for (size_t k = 0; k < num && escrito; ++k) {
+            char* bloque = ranuras.data() + k * tam_ranura;
+            cifrarBloqueEnPosicion(bloque, longitudes[k], escritos);
+            escrito = static_cast<bool>(ofs.write(bloque, static_cast<std::streamsize>(longitudes[k])));
+            escritos += longitudes[k];
+        }
+    }
+    char final_marco[TAM_CABECERA_BLOQUE_LZ] = {};
+    cifrarBloqueEnPosicion(final_marco, sizeof(final_marco), escritos);
+    if (!escrito || !ofs.write(final_marco, sizeof(final_marco)) || !ofs.flush()) {
+        error = "Fallo la escritura de " + salida;
+        return false;
+    }
+    escritos += sizeof(final_marco);
+    EstadisticasCompresionLZ& e = estadisticasCompresionLZ();
+    e.entrada.fetch_add(src.tam(), std::memory_order_relaxed);
+    e.salida.fetch_add(escritos, std::memory_order_relaxed);
+    return true;
+#else
+    (void)pool;
+    std::ifstream ifs(entrada, std::ios::binary);
+    std::ofstream ofs(salida, std::ios::binary);
+    if (!ifs.is_open()) {
+        error = "No se pudo abrir el archivo de entrada para encriptar: " + entrada;
+        return false;
+    }
+    if (!ofs.is_open()) {
+        error = "No se pudo crear/abrir el archivo de salida para encriptar: " + salida;
+        return false;
+    }
+    auto leer = [&ifs](char* destino, size_t n) -> long long {
+        ifs.read(destino, static_cast<std::streamsize>(n));
+        return ifs.bad() ? -1 : static_cast<long long>(ifs.gcount());
+    };
+    auto escribir = [&ofs](const char* origen, size_t n) {
+        return static_cast<bool>(ofs.write(origen, static_cast<std::streamsize>(n)));
+    };
+    uint64_t bytes_plano = 0;
+    if (!comprimirYCifrarFlujo(leer, escribir, nullptr, bytes_plano) || !ofs.flush()) {
+        error = "Fallo la escritura de " + salida;
+        return false;
+    }
+    return true;
+#endif
+}
+
+// Verificación de un .enc comprimido: cada bloque descomprimido alimenta el
+// hash y se compara con el original en la misma pasada (como
+// desencriptarHashearYComparar). Con mmap se descifran primero solo las
+// cabeceras para localizar los bloques; después, por ventanas de dos bloques
+// por thread, se descifran sus datos y descomprimirBloquesLZ los descomprime
+// en paralelo en el pool. Devuelve "" y el motivo en 'error' si falla.
+std::string descifrarDescomprimirHashearYComparar(const std::string& entrada, const std::string& original, PoolHilos& pool,
+                                                  int64_t& primer_distinto, std::string& error) {
+    primer_distinto = -1;
+    std::ifstream orig(original, std::ios::binary);
+    if (!orig.is_open()) {
+        error = "No se pudo abrir el archivo original para comparar: " + original;
+        return "";
+    }
+    KernelComparacion comparar = kernelComparacionActivo();
+    BufferPrestado buffer_original(TAM_BLOQUE_CIFRADO);
+    SHA256 sha256;
+    int64_t offset = 0;
+    auto consumir = [&](const char* datos, size_t n) {
+        sha256.update(datos, n);
+        for (size_t pos = 0; pos < n && primer_distinto < 0; pos += TAM_BLOQUE_CIFRADO) {
+            size_t len = std::min(TAM_BLOQUE_CIFRADO, n - pos);
+            orig.read(buffer_original.data(), static_cast<std::streamsize>(len));
+            size_t comunes = static_cast<size_t>(orig.gcount());
+            size_t k = comparar(reinterpret_cast<const uint8_t*>(datos + pos),
+                                reinterpret_cast<const uint8_t*>(buffer_original.data()), comunes);
+            if (k < comunes || comunes < len) {
+                primer_distinto = offset + static_cast<int64_t>(pos + k);
+            }
+        }
+        offset += static_cast<int64_t>(n);
+        return true;
+    };
+#if SO_TIENE_MMAP
+    ArchivoMapeado enc;
+    if (!enc.abrirLectura(entrada)) {
+        error = "No se pudo abrir el archivo de entrada para desencriptar: " + entrada;
+        return "";
+    }
+    const char* marco = enc.datos();
+    const size_t n = enc.tam();
+    char cabecera[TAM_CABECERA_MARCO_LZ];
+    if (n < sizeof(cabecera)) {
+        error = entrada + ": falta la cabecera del marco comprimido";
+        return "";
+    }
+    descifrarBloqueEnPosicion(static_cast<char*>(std::memcpy(cabecera, marco, sizeof(cabecera))), sizeof(cabecera), 0);
+    if (!esCabeceraMarcoLZ(reinterpret_cast<const uint8_t*>(cabecera))) {
+        error = entrada + ": los datos no son un marco comprimido (se cifraron sin --comprimir?)";
+        return "";
+    }
+    const size_t tam_bloque = leerLE32(reinterpret_cast<const uint8_t*>(cabecera) + 4);
+    std::vector<BloqueMarcoLZ> bloques;
+    size_t pos = sizeof(cabecera);
+    while (true) {
+        char cabecera_bloque[TAM_CABECERA_BLOQUE_LZ];
+        BloqueMarcoLZ b;
+        if (n - pos < sizeof(cabecera_bloque)) {
+            error = entrada + ": el marco comprimido esta truncado";
+            return "";
+        }
+        std::memcpy(cabecera_bloque, marco + pos, sizeof(cabecera_bloque));
+        descifrarBloqueEnPosicion(cabecera_bloque, sizeof(cabecera_bloque), pos);
+        if (!leerCabeceraBloqueLZ(reinterpret_cast<const uint8_t*>(cabecera_bloque), tam_bloque, b.cabecera) ||
+            (b.cabecera.tam_original == 0 && b.cabecera.tam_guardado != 0)) {
+            error = entrada + ": cabecera de bloque no valida";
+            return "";
+        }
+        pos += sizeof(cabecera_bloque);
+        if (b.cabecera.tam_original == 0) {
+            break;
+        }
+        if (n - pos < b.cabecera.tam_guardado) {
+            error = entrada + ": el marco comprimido esta truncado";
+            return "";
+        }
+        b.origen = pos;
+        b.destino = 0;
+        bloques.push_back(b);
+        pos += b.cabecera.tam_guardado;
+    }
+    if (pos != n) {
+        error = entrada + ": hay datos despues del final del marco comprimido";
+        return "";
+    }
+
+    const size_t ventana = 2 * static_cast<size_t>(pool.numHilos());
+    BufferPrestado cifrado(ventana * (TAM_CABECERA_BLOQUE_LZ + cotaComprimidoLZ(tam_bloque)));
+    BufferPrestado plano(ventana * tam_bloque);
+    std::vector<BloqueMarcoLZ> grupo;
+    for (size_t primero = 0; primero < bloques.size(); primero += ventana) {
+        const size_t num = std::min(ventana, bloques.size() - primero);
+        const size_t desde = bloques[primero].origen;
+        const size_t hasta = bloques[primero + num - 1].origen + bloques[primero + num - 1].cabecera.tam_guardado;
+        motorCifradoActivo().descifrar(marco + desde, cifrado.data(), hasta - desde, desde);
+        grupo.assign(bloques.begin() + primero, bloques.begin() + primero + num);
+        size_t total = 0;
+        for (BloqueMarcoLZ& b : grupo) {
+            b.origen -= desde;
+            b.destino = total;
+            total += b.cabecera.tam_original;
+        }
+        if (!descomprimirBloquesLZ(grupo.data(), num, reinterpret_cast<const uint8_t*>(cifrado.data()),
+                                   reinterpret_cast<uint8_t*>(plano.data()), &pool)) {
+            error = entrada + ": bloque comprimido corrupto";
+            return "";
+        }
+        consumir(plano.data(), total);
+    }
+#else
+    (void)pool;
+    std::ifstream ifs(entrada, std::ios::binary);
+    if (!ifs.is_open()) {
+        error = "No se pudo abrir el archivo de entrada para desencriptar: " + entrada;
+        return "";
+    }
+    auto leer_exacto = [&ifs](char* destino, size_t n) {
+        ifs.read(destino, static_cast<std::streamsize>(n));
+        return static_cast<size_t>(ifs.gcount()) == n;
+    };
+    if (!descifrarYDescomprimirFlujo(leer_exacto, consumir, error)) {
+        error = entrada + ": " + error;
+        return "";
+    }
+#endif
+    // Si el original sigue teniendo datos, es más largo que el descifrado
+    if (primer_distinto < 0 && orig.peek() != std::char_traits<char>::eof()) {
+        primer_distinto = offset;
+    }
+    uint8_t digest[SHA256::DIGEST_SIZE];
+    sha256.finalize(digest);
+    return SHA256::toHex(digest);
+}
+
+// Modo --directorio: recorre los árboles de entrada, ordena los archivos de
+// mayor a menor y los reparte entre los threads del pool. En lugar de encolar
+// una tarea por archivo (cada thread vaciaría su cola en orden LIFO), cada
+// thread toma el siguiente índice de la lista ordenada cuando queda libre:
+// es el reparto LPT clásico, y el archivo más grande empieza el primero.
+int ejecutarLoteDirectorios(const OpcionesPrograma& opciones) {
+    auto inicio = std::chrono::high_resolution_clock::now();
+    std::cout << "---------------------------------------------------------------" << std::endl;
+    std::cout << "LOTE POR DIRECTORIOS" << std::endl;
+    if (opciones.deduplicar != ModoDeduplicacion::Ninguno && motorCifradoActivo().dependeDeLaRuta()) {
+        std::cout << "Error: --deduplicar no se puede usar con " << opciones.motorCifrado
+                  << ": cada archivo se cifra con su propio contador y los duplicados no pueden compartir el .enc" << std::endl;
+        return 1;
+    }
+
+    const uint64_t reservas_previas = estadisticasPoolBuffers().reservas.load();
+    const uint64_t bytes_reservados_previos = estadisticasPoolBuffers().bytes_reservados.load();
+
+    std::vector<ArchivoLote> archivos;
+    std::string error;
+    if (!recorrerDirectorios(opciones.directoriosEntrada, opciones.directorioSalida, archivos, error)) {
+        std::cout << "Error: " << error << std::endl;
+        return 1;
+    }
+    ordenarMayorPrimero(archivos);
+    uint64_t total_bytes = 0;
+    for (const ArchivoLote& archivo : archivos) {
+        total_bytes += archivo.tam;
+    }
+
+    unsigned int num_threads = opciones.hilos;
+    if (num_threads == 0) {
+        num_threads = std::thread::hardware_concurrency();
+        if (num_threads == 0) num_threads = 4;
+        if (num_threads > 8) num_threads = 8;
+    }
+    PoolHilos pool(num_threads, [&opciones](unsigned int indice) {
+        fijarTrabajador(static_cast<int>(indice), opciones.afinidad);
+        RegistroTraza::instancia().nombrarHilo("trabajador " + std::to_string(indice));
+    });
+
+    std::cout << archivos.size() << " archivos, " << total_bytes << " bytes -> " << opciones.directorioSalida << std::endl;
+    std::cout << "Usando " << num_threads << " threads, backend E/S: " << nombreBackendES(opciones.es) << std::endl;
+    std::cout << "Motor de cifrado: " << motorCifradoActivo().nombre() << std::endl;
+    if (!archivos.empty()) {
+        std::cout << "Mayor: " << archivos.front().relativa.string() << " (" << archivos.front().tam << " bytes)" << std::endl;
+    }
+
+    // Reparte los índices [0, n) en orden entre los threads del pool
+    auto repartir = [&pool](size_t n, const std::function<void(size_t)>& tarea) {
+        std::atomic<size_t> siguiente(0);
+        GrupoTareas trabajadores(pool);
+        for (unsigned int t = 0; t < pool.numHilos(); ++t) {
+            trabajadores.lanzar([&]() {
+                size_t k;
+                while ((k = siguiente.fetch_add(1)) < n) {
+                    tarea(k);
+                }
+            });
+        }
+        trabajadores.esperar();
+    };
+
+    // Hash previo de cada entrada (de la cache si no cambió): hace falta para
+    // deduplicar, y con la cache ahorra la lectura de las entradas conocidas
+    CacheHashes cache;
+    const bool usar_cache = !opciones.rutaCacheHash.empty();
+    if (usar_cache && !cache.cargar(opciones.rutaCacheHash, error)) {
+        std::cout << "Aviso: " << error << ". Se empieza con la cache vacia." << std::endl;
+    }
+    std::vector<std::string> hashes(archivos.size());
+
+    // Con diario, lo que una ejecución anterior ya terminó (y no cambió) se omite
+    DiarioLote diario;
+    const bool usar_diario = !opciones.rutaDiario.empty();
+    if (usar_diario && !diario.abrir(opciones.rutaDiario, configuracionDiario(opciones), error)) {
+        std::cout << "Error: " << error << std::endl;
+        return 1;
+    }
+    if (diario.descartadoPorConfiguracion()) {
+        std::cout << "Aviso: el diario " << opciones.rutaDiario << " es de otra configuracion ("
+                  << configuracionDiario(opciones) << "); se empieza de nuevo." << std::endl;
+    }
+    std::vector<char> correcto(archivos.size(), 0);
+    std::vector<char> ya_completo(archivos.size(), 0);
+    if (usar_diario) {
+        repartir(archivos.size(), [&](size_t k) {
+            ya_completo[k] = salidaCompletaSegunDiario(archivos[k], diario, opciones, hashes[k]) ? 1 : 0;
+            correcto[k] = ya_completo[k];
+        });
+    }
+    size_t num_ya_completos = 0;
+    uint64_t bytes_ya_completos = 0;
+    for (size_t k = 0; k < archivos.size(); ++k) {
+        if (ya_completo[k]) {
+            ++num_ya_completos;
+            bytes_ya_completos += archivos[k].tam;
+        }
+    }
+    if (num_ya_completos > 0) {
+        std::cout << "Reanudando: " << num_ya_completos << " archivos (" << bytes_ya_completos
+                  << " bytes) ya estaban completos segun el diario" << std::endl;
+    }
+
+    if (usar_cache || opciones.deduplicar != ModoDeduplicacion::Ninguno) {
+        repartir(archivos.size(), [&](size_t k) {
+            if (!ya_completo[k]) {
+                hashes[k] = hashEntradaConCache(archivos[k], usar_cache ? &cache : nullptr, opciones.es);
+            }
+        });
+    }
+
+    // Con deduplicación, el primero (el de ruta menor) de cada grupo de
+    // archivos idénticos es el representante; los demás solo enlazan su .enc
+    std::vector<size_t> representante(archivos.size());
+    std::vector<size_t> a_procesar;
+    std::vector<size_t> duplicados;
+    {
+        std::unordered_map<std::string, size_t> por_contenido;
+        const bool deduplicar = opciones.deduplicar != ModoDeduplicacion::Ninguno;
+        // Los ya completos son los mejores representantes: no hay que volver a cifrarlos
+        for (size_t k = 0; k < archivos.size(); ++k) {
+            if (deduplicar && ya_completo[k]) {
+                por_contenido.emplace(hashes[k] + ":" + std::to_string(archivos[k].tam), k);
+            }
+        }
+        for (size_t k = 0; k < archivos.size(); ++k) {
+            representante[k] = k;
+            if (ya_completo[k]) {
+                continue;
+            }
+            if (deduplicar && !hashes[k].empty()) {
+                auto it = por_contenido.emplace(hashes[k] + ":" + std::to_string(archivos[k].tam), k).first;
+                representante[k] = it->second;
+            }
+            (representante[k] == k ? a_procesar : duplicados).push_back(k);
+        }
+    }
+
+    ProgresoLote progreso(archivos.size() - num_ya_completos, total_bytes - bytes_ya_completos);
+    std::mutex mtx;
+    DiarioLote* diario_activo = usar_diario ? &diario : nullptr;
+    repartir(a_procesar.size(), [&](size_t j) {
+        size_t k = a_procesar[j];
+        // Quedan pocos archivos: los grandes se cifran por rangos entre los threads libres
+        int restantes = static_cast<int>(a_procesar.size() - j);
+        bool ok = procesarArchivoDeLote(archivos[k], hashes[k], restantes, opciones, pool, diario_activo, mtx);
+        correcto[k] = ok ? 1 : 0;
+        progreso.archivoTerminado(archivos[k].tam, !ok);
+    });
+
+    std::atomic<unsigned int> usos_enlace[4] = {};
+    std::atomic<uint64_t> bytes_evitados(0);
+    repartir(duplicados.size(), [&](size_t j) {
+        size_t k = duplicados[j];
+        bool ok = correcto[representante[k]] != 0 &&
+                  enlazarSalidaDuplicada(archivos[representante[k]], archivos[k], hashes[k], opciones, usos_enlace, diario_activo, mtx);
+        if (ok) {
+            bytes_evitados.fetch_add(archivos[k].tam, std::memory_order_relaxed);
+        } else {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::cout << "Error: No se pudo generar la salida del duplicado " << archivos[k].relativa.string() << std::endl;
+        }
+        progreso.archivoTerminado(archivos[k].tam, !ok);
+    });
+
+    if (usar_cache && !cache.guardar(opciones.rutaCacheHash, error)) {
+        std::cout << "Aviso: " << error << std::endl;
+    }
+
+    auto fin = std::chrono::high_resolution_clock::now();
+    auto tt = std::chrono::duration_cast<std::chrono::microseconds>(fin - inicio);
+    progreso.informar(std::cout, std::chrono::steady_clock::now());
+    std::cout << "TT: " << formatDuration(tt.count()) << std::endl;
+    if (tt.count() > 0) {
+        std::cout << "Rendimiento: " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(total_bytes - bytes_ya_completos) / static_cast<double>(tt.count()) << " MB/s" << std::endl;
+    }
+    informarReservasBuffers(reservas_previas, bytes_reservados_previos, archivos.size());
+    if (opciones.comprimir) {
+        const EstadisticasCompresionLZ& c = estadisticasCompresionLZ();
+        std::cout << "Compresion: " << c.entrada.load() << " -> " << c.salida.load() << " bytes";
+        if (c.salida.load() > 0) {
+            std::cout << " (" << std::fixed << std::setprecision(2)
+                      << static_cast<double>(c.entrada.load()) / static_cast<double>(c.salida.load()) << "x)";
+        }
+        std::cout << std::endl;
+    }
+    if (usar_cache) {
+        std::cout << "Cache de hashes: " << cache.aciertos() << " aciertos, " << cache.fallos() << " calculados" << std::endl;
+    }
+    if (opciones.deduplicar != ModoDeduplicacion::Ninguno) {
+        std::cout << "Duplicados: " << duplicados.size() << " archivos (" << bytes_evitados.load() << " bytes sin cifrar)";
+        const char* separador = ": ";
+        for (MetodoEnlace metodo : {MetodoEnlace::EnlaceDuro, MetodoEnlace::Reflink, MetodoEnlace::CopiaNucleo, MetodoEnlace::CopiaBuffer}) {
+            unsigned int usos = usos_enlace[static_cast<int>(metodo)].load();
+            if (usos > 0) {
+                std::cout << separador << nombreMetodoEnlace(metodo) << " x" << usos;
+                separador = ", ";
+            }
+        }
+        std::cout << std::endl;
+    }
+    if (progreso.numErrores() > 0) {
+        std::cout << "Hubo errores en " << progreso.numErrores() << " archivos." << std::endl;
+    } else {
+        std::cout << "No se encontraron errores en la verificacion final." << std::endl;
+    }
+    std::cout << "---------------------------------------------------------------" << std::endl;
+    return progreso.numErrores() > 0 ? 1 : 0;
+}
+
+// Hash SHA-256 de una entrada del lote, tomado de la cache si el archivo no
+// cambió desde que se anotó ("" si no se pudo leer)
+std::string hashEntradaConCache(const ArchivoLote& archivo, CacheHashes* cache, BackendES es) {
+    const std::string entrada = archivo.entrada.string();
+    ClaveArchivo clave;
+    const bool con_clave = cache != nullptr && claveDeArchivo(entrada, clave);
+    std::string hash;
+    if (con_clave && cache->buscar(clave, hash)) {
+        return hash;
+    }
+    {
+        EtapaTraza etapa("hash", archivo.tam);
+        hash = generarHashSHA256(entrada, es);
+    }
+    if (con_clave && !hash.empty()) {
+        cache->anotar(clave, hash);
+    }
+    return hash;
+}
+
+// Salida de un archivo idéntico a otro ya cifrado y verificado: su .enc se
+// enlaza al del representante y su .sha se escribe con el hash ya conocido
+bool enlazarSalidaDuplicada(const ArchivoLote& representante, const ArchivoLote& archivo, const std::string& hash,
+                            const OpcionesPrograma& opciones, std::atomic<unsigned int>* usos_enlace, DiarioLote* diario, std::mutex& mtx) {
+    namespace fs = std::filesystem;
+    const fs::path base_representante = fs::path(opciones.directorioSalida) / representante.relativa;
+    const fs::path base = fs::path(opciones.directorioSalida) / archivo.relativa;
+    std::error_code ec;
+    fs::create_directories(base.parent_path(), ec);
+
+    MetodoEnlace metodo = MetodoEnlace::CopiaBuffer;
+    EtapaTraza etapa("enlazar_duplicado", archivo.tam);
+    if (!enlazarDuplicado(base_representante.string() + ".enc", base.string() + ".enc", opciones.deduplicar, metodo)) {
+        return false;
+    }
+    usos_enlace[static_cast<int>(metodo)].fetch_add(1, std::memory_order_relaxed);
+    std::ofstream hash_ofs(base.string() + ".sha");
+    if (!hash_ofs.is_open() || !(hash_ofs << hash)) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::cout << "Error: No se pudo crear el archivo hash: " << base.string() << ".sha" << std::endl;
+        return false;
+    }
+    ClaveArchivo clave;
+    ClaveArchivo enc;
+    if (diario != nullptr && claveDeArchivo(archivo.entrada.string(), clave) && claveDeArchivo(base.string() + ".enc", enc)) {
+        diario->anotarCompleto(archivo.relativa.generic_string(), clave, hash, enc);
+    }
+    return true;
+}
+
+// true si el diario da 'archivo' por terminado y tanto la entrada como sus
+// salidas siguen como quedaron entonces; en ese caso devuelve su hash
+bool salidaCompletaSegunDiario(const ArchivoLote& archivo, const DiarioLote& diario, const OpcionesPrograma& opciones, std::string& hash) {
+    const EntradaDiario* previa = diario.buscar(archivo.relativa.generic_string());
+    if (previa == nullptr || !previa->completo) {
+        return false;
+    }
+    const std::string base = (std::filesystem::path(opciones.directorioSalida) / archivo.relativa).string();
+    ClaveArchivo clave;
+    ClaveArchivo enc;
+    if (!claveDeArchivo(archivo.entrada.string(), clave) || !(clave == previa->clave) ||
+        !claveDeArchivo(base + ".enc", enc) || enc.tam != previa->tam_enc || enc.mtime_ns != previa->mtime_enc_ns) {
+        return false;
+    }
+    std::ifstream sha(base + ".sha");
+    std::string hash_guardado;
+    if (!(sha >> hash_guardado) || hash_guardado != previa->hash) {
+        return false;
+    }
+    hash = previa->hash;
+    return true;
+}
+
+// Cabecera del diario: lo que cambia el contenido de los .enc. Un diario
+// escrito con otra configuración no sirve para reanudar. De la clave solo se
+// guarda una huella (los 8 primeros bytes de su SHA-256), nunca la clave.
+std::string configuracionDiario(const OpcionesPrograma& opciones) {
+    std::string configuracion = std::string("comprimir=") + (opciones.comprimir ? "1" : "0") + " motor=" + opciones.motorCifrado;
+    std::string clave;
+    std::string iv;
+    if (parsearHexadecimal(opciones.claveCifrado, clave) && !clave.empty()) {
+        uint8_t digest[SHA256::DIGEST_SIZE];
+        SHA256 sha;
+        sha.update(clave.data(), clave.size());
+        sha.finalize(digest);
+        configuracion += " clave=" + SHA256::toHex(digest).substr(0, 16);
+    }
+    if (parsearHexadecimal(opciones.ivCifrado, iv) && !iv.empty()) {
+        std::ostringstream ss;
+        for (unsigned char c : iv) {
+            ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(c);
+        }
+        configuracion += " iv=" + ss.str();
+    }
+    return configuracion;
+}
+
+// Cifrado reanudable de un archivo grande con diario: se cifra por segmentos
+// de TAM_SEGMENTO_DIARIO bytes y, tras llevar cada uno a disco, se avisa para
+// anotarlo. Empieza en 'desde' (un segmento ya anotado) sin truncar la salida.
+// Dentro de cada segmento, los rangos de opciones.tamRango bytes se reparten
+// entre los threads del pool como en transformarArchivoPorRangos; el segmento
+// se sincroniza y se anota solo cuando han terminado todos.
+bool cifrarPorSegmentos(const std::string& entrada, const std::string& salida, uint64_t desde, const OpcionesPrograma& opciones, PoolHilos& pool,
+                        const std::function<void(uint64_t)>& segmento_terminado) {
+#if SO_TIENE_MMAP
+    ArchivoPosicional src;
+    ArchivoPosicional dst;
+    if (!src.abrirLectura(entrada) || !dst.abrirEscrituraExistente(salida, src.tam())) {
+        return false;
+    }
+    const size_t tam_rango = opciones.tamRango;
+    const MotorCifrado& motor = motorCifradoActivo();   // Los rangos corren en otros threads
+    bool errores = false;
+    std::mutex mtx_errores;
+    for (uint64_t segmento = desde; segmento < src.tam(); segmento += TAM_SEGMENTO_DIARIO) {
+        const size_t fin_segmento = static_cast<size_t>(std::min<uint64_t>(src.tam(), segmento + TAM_SEGMENTO_DIARIO));
+        GrupoTareas rangos(pool);
+        for (size_t offset = static_cast<size_t>(segmento); offset < fin_segmento; offset += tam_rango) {
+            const size_t fin = std::min(fin_segmento, offset + tam_rango);
+            rangos.lanzar([&src, &dst, &motor, &errores, &mtx_errores, offset, fin]() {
+                EtapaTraza etapa("cifrar_rango", fin - offset);
+                BufferPrestado buffer(TAM_BLOQUE_CIFRADO);
+                for (size_t pos = offset; pos < fin; pos += TAM_BLOQUE_CIFRADO) {
+                    size_t n = std::min(TAM_BLOQUE_CIFRADO, fin - pos);
+                    if (!src.leerEn(buffer.data(), n, pos)) {
+                        std::lock_guard<std::mutex> lock(mtx_errores);
+                        errores = true;
+                        return;
+                    }
+                    motor.cifrar(buffer.data(), buffer.data(), n, pos);
+                    if (!dst.escribirEn(buffer.data(), n, pos)) {
+                        std::lock_guard<std::mutex> lock(mtx_errores);
+                        errores = true;
+                        return;
+                    }
+                }
+            });
+        }
+        rangos.esperar();
+        // El diario solo anota lo que ya está en disco
+        if (errores || !dst.sincronizar()) {
+            return false;
+        }
+        segmento_terminado(fin_segmento);
+    }
+    return true;
+#else
+    (void)desde; (void)opciones; (void)pool; (void)segmento_terminado;
+    encriptarArchivo(entrada, salida);
+    return true;
+#endif
+}
+
+// Un archivo del modo por directorios: .enc y .sha en la ruta espejo de la
+// salida, y verificación descifrando en memoria (el descifrado no se escribe)
+bool procesarArchivoDeLote(const ArchivoLote& archivo, const std::string& hash_conocido, int restantes, const OpcionesPrograma& opciones,
+                           PoolHilos& pool, DiarioLote* diario, std::mutex& mtx) {
+    namespace fs = std::filesystem;
+    const std::string entrada = archivo.entrada.string();
+    const fs::path base = fs::path(opciones.directorioSalida) / archivo.relativa;
+    const std::string encriptadoFileName = base.string() + ".enc";
+    const std::string hashFileName = base.string() + ".sha";
+
+    std::error_code ec;
+    fs::create_directories(base.parent_path(), ec);
+    if (ec) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::cout << "Error: No se pudo crear el directorio " << base.parent_path().string() << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    // Cada archivo se cifra con el motor de su ruta relativa (en AES-CTR, un
+    // contador propio), también en los rangos y segmentos que lanza al pool
+    const std::string relativa = archivo.relativa.generic_string();
+    const std::unique_ptr<MotorCifrado> motor_archivo = motorCifradoActivo().paraArchivo(relativa);
+    MotorCifradoEnHilo motor_en_hilo(*motor_archivo);
+
+    // Con diario, un archivo grande que quedó a medio cifrar sigue desde el
+    // último segmento anotado (si la entrada no cambió y el .enc sigue ahí)
+    ClaveArchivo clave;
+    const bool anotar = diario != nullptr && claveDeArchivo(entrada, clave);
+    const bool por_segmentos = anotar && SO_TIENE_MMAP && !opciones.comprimir && archivo.tam >= TAM_SEGMENTO_DIARIO;
+    uint64_t desde = 0;
+    if (por_segmentos) {
+        const EntradaDiario* previa = diario->buscar(relativa);
+        ClaveArchivo enc;
+        if (previa != nullptr && !previa->completo && previa->clave == clave &&
+            claveDeArchivo(encriptadoFileName, enc) && enc.tam == clave.tam) {
+            desde = previa->cifrado_hasta;
+        }
+    }
+
+    // Si el .enc anterior era un enlace duro de una deduplicación, reescribirlo
+    // en su sitio cambiaría también el de los otros archivos enlazados
+    if (desde == 0) {
+        fs::remove(encriptadoFileName, ec);
+    }
+    if (por_segmentos) {
+        EtapaTraza etapa("cifrar", archivo.tam - desde);
+        bool ok = cifrarPorSegmentos(entrada, encriptadoFileName, desde, opciones, pool, [&](uint64_t hasta) {
+            diario->anotarParcial(relativa, clave, hasta);
+        });
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::cout << "Error: No se pudo cifrar " << entrada << " en " << encriptadoFileName << std::endl;
+            return false;
+        }
+    } else if (opciones.comprimir) {
+        EtapaTraza etapa("comprimir_cifrar", archivo.tam);
+        std::string error;
+        if (!comprimirYCifrarArchivo(entrada, encriptadoFileName, pool, error)) {
+            std::lock_guard<std::mutex> lock(mtx);
+            std::cout << "Error: " << error << std::endl;
+            return false;
+        }
+    } else {
+        EtapaTraza etapa("cifrar", archivo.tam);
+        transformarArchivoOptimizado(entrada, encriptadoFileName, true, restantes, opciones, pool);
+    }
+    std::string hash_generado = hash_conocido;
+    if (hash_generado.empty()) {
+        EtapaTraza etapa("hash", archivo.tam);
+        hash_generado = generarHashSHA256(entrada, opciones.es);
+    }
+    std::ofstream hash_ofs(hashFileName);
+    if (!hash_ofs.is_open() || !(hash_ofs << hash_generado)) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::cout << "Error: No se pudo crear el archivo hash: " << hashFileName << std::endl;
+        return false;
+    }
+    hash_ofs.close();
+
+    int64_t primer_distinto = -1;
+    std::string hash_desencriptado;
+    std::string error;
+    {
+        EtapaTraza etapa("descifrar_hash_comparar", archivo.tam);
+        hash_desencriptado = opciones.comprimir ? descifrarDescomprimirHashearYComparar(encriptadoFileName, entrada, pool, primer_distinto, error)
+                                                : desencriptarHashearYComparar(encriptadoFileName, entrada, "", opciones.es, primer_distinto);
+    }
+    if (hash_desencriptado.empty() || hash_desencriptado != hash_generado) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!error.empty()) {
+            std::cout << "Error: " << error << std::endl;
+        }
+        std::cout << "Error de validacion de hash para el archivo " << encriptadoFileName << std::endl;
+        return false;
+    }
+    if (primer_distinto >= 0) {
+        std::lock_guard<std::mutex> lock(mtx);
+        std::cout << "Error: El descifrado de " << encriptadoFileName << " no coincide con " << entrada
+                  << " a partir del byte " << primer_distinto << "." << std::endl;
+        return false;
+    }
+    ClaveArchivo enc;
+    if (anotar && claveDeArchivo(encriptadoFileName, enc)) {
+        diario->anotarCompleto(relativa, clave, hash_generado, enc);
+    }
+    return true;
+}
+
+// Etapa de cifrado/descifrado del proceso optimizado: por rangos si el
+// archivo lo justifica, si no de principio a fin en el thread actual
+void transformarArchivoOptimizado(const std::string& entrada, const std::string& salida, bool cifrar, int N, const OpcionesPrograma& opciones, PoolHilos& pool) {
+    if (dividirEnRangos(entrada, N, opciones, pool)) {
+        transformarArchivoPorRangos(entrada, salida, cifrar, opciones, pool);
+    } else if (cifrar) {
+        encriptarArchivo(entrada, salida, opciones.es);
+    } else {
+        desencriptarArchivo(entrada, salida, opciones.es);
+    }
+}
+
+// Etapa de copia del proceso optimizado: primero el mecanismo mas barato que
+// ofrezca el kernel (en btrfs/XFS un reflink que solo toca metadatos) y, si
+// ninguno sirve, la copia con el backend de E/S elegido
+void copiarArchivoOptimizado(const std::string& origen, const std::string& destino, const OpcionesPrograma& opciones) {
+    MetodoCopia metodo = MetodoCopia::Buffer;
+    if (!opciones.copiaEnNucleo || !copiarArchivoEnNucleo(origen, destino, metodo)) {
+        copiarArchivo(origen, destino, opciones.es);
+    }
+    registrarMetodoCopia(metodo);
+}
+
+// Fase 1 del lote con io_uring: un solo thread mantiene en vuelo las lecturas
+// y escrituras de todos los archivos. Primero original -> copia y .enc (cifrado
+// en el buffer entre las dos escrituras), despues .enc -> descifrado. El tiempo
+// de cada pasada se reparte por igual entre los archivos.
+void procesarLoteIoUring(int N, const std::string& originalFileName, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion) {
+    std::vector<TrabajoLote> cifrado;
+    std::vector<TrabajoLote> descifrado;
+    for (int i = 1; i <= N; ++i) {
+        std::string copiaFileName = std::to_string(i) + ".txt";
+        std::string encriptadoFileName = std::to_string(i) + ".enc";
+        cifrado.push_back(TrabajoLote{originalFileName, {SalidaLote{copiaFileName, nullptr},
+                                                         SalidaLote{encriptadoFileName, cifrarBloqueEnPosicion}}});
+        descifrado.push_back(TrabajoLote{encriptadoFileName, {SalidaLote{nombreArchivoDesencriptado(i, N), descifrarBloqueEnPosicion}}});
+    }
+
+    auto inicio = std::chrono::high_resolution_clock::now();
+    const uint64_t bytes = bytesParaTraza(originalFileName) * static_cast<uint64_t>(N);
+    std::string error;
+    bool ok;
+    {
+        EtapaTraza etapa("lote_io_uring_cifrar", bytes);
+        ok = ejecutarLoteIoUring(cifrado, error);
+    }
+    if (ok) {
+        EtapaTraza etapa("lote_io_uring_descifrar", bytes);
+        ok = ejecutarLoteIoUring(descifrado, error);
+    }
+    auto fin = std::chrono::high_resolution_clock::now();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!ok) {
+        std::cout << "Error: " << error << std::endl;
+        errores_verificacion = true;
+    }
+    long long por_archivo = std::chrono::duration_cast<std::chrono::microseconds>(fin - inicio).count() / N;
+    for (int i = 1; i <= N; ++i) {
+        tiempos_por_archivo[i-1] += por_archivo;
+    }
+}
+
+// Variante del proceso optimizado para lotes grandes: en lugar de hashear cada
+// archivo en su propia tarea, se cifran y descifran todos en paralelo y luego
+// los hashes de todas las copias y descifrados se calculan juntos con SHA256Lote,
+// un mensaje por carril SIMD.
+void procesarArchivosConHashLote(int N, const std::string& originalFileName, PoolHilos& pool, const OpcionesPrograma& opciones, std::vector<long long>& tiempos_por_archivo, std::mutex& mtx, bool& errores_verificacion) {
+    // Fase 1: copiar, encriptar y desencriptar cada archivo
+    GrupoTareas fase(pool);
+    if (opciones.es == BackendES::IoUring) {
+        procesarLoteIoUring(N, originalFileName, tiempos_por_archivo, mtx, errores_verificacion);
+    }
+    for (int i = 1; i <= N && opciones.es != BackendES::IoUring; ++i) {
+        fase.lanzar([i, N, &opciones, &pool, &originalFileName, &tiempos_por_archivo, &mtx]() {
+            auto inicio = std::chrono::high_resolution_clock::now();
+            std::string copiaFileName = std::to_string(i) + ".txt";
+            std::string encriptadoFileName = std::to_string(i) + ".enc";
+            std::string desencriptadoFileName = nombreArchivoDesencriptado(i, N);
+            const uint64_t bytes = bytesParaTraza(originalFileName);
+
+            {
+                EtapaTraza etapa("copiar", bytes, i);
+                copiarArchivoOptimizado(originalFileName, copiaFileName, opciones);
+            }
+            {
+                EtapaTraza etapa("cifrar", bytes, i);
+                transformarArchivoOptimizado(copiaFileName, encriptadoFileName, true, N, opciones, pool);
+            }
+            {
+                EtapaTraza etapa("descifrar", bytes, i);
+                transformarArchivoOptimizado(encriptadoFileName, desencriptadoFileName, false, N, opciones, pool);
+            }
+
+            auto fin = std::chrono::high_resolution_clock::now();
+            std::lock_guard<std::mutex> lock(mtx);
+            tiempos_por_archivo[i-1] += std::chrono::duration_cast<std::chrono::microseconds>(fin - inicio).count();
+        });
+    }
+    fase.esperar();
+
+    // Fase 2: hash multi-buffer de las N copias y los N descifrados, repartidos entre los threads
+    auto inicio_hash = std::chrono::high_resolution_clock::now();
+    std::vector<std::string> rutas;
+    for (int i = 1; i <= N; ++i) {
+        rutas.push_back(std::to_string(i) + ".txt");
+    }
+    for (int i = 1; i <= N; ++i) {
+        rutas.push_back(nombreArchivoDesencriptado(i, N));
+    }
+    std::vector<std::string> hashes(rutas.size());
+    size_t por_thread = (rutas.size() + pool.numHilos() - 1) / pool.numHilos();
+    const uint64_t bytes_archivo = bytesParaTraza(originalFileName);
+    for (size_t inicio = 0; inicio < rutas.size(); inicio += por_thread) {
+        size_t fin = std::min(rutas.size(), inicio + por_thread);
+        fase.lanzar([&rutas, &hashes, inicio, fin, bytes_archivo]() {
+            EtapaTraza etapa("hash_lote", (fin - inicio) * bytes_archivo);
+            std::vector<std::string> grupo(rutas.begin() + inicio, rutas.begin() + fin);
+            std::vector<std::string> resultado = SHA256Lote().hashearArchivos(grupo);
+            std::copy(resultado.begin(), resultado.end(), hashes.begin() + inicio);
+        });
+    }
+    fase.esperar();
+    auto fin_hash = std::chrono::high_resolution_clock::now();
+    // El tiempo del lote se reparte por igual entre los archivos
+    long long hash_por_archivo = std::chrono::duration_cast<std::chrono::microseconds>(fin_hash - inicio_hash).count() / N;
+
+    // Fase 3: guardar el .sha, releerlo, validar y comparar con el original
+    for (int i = 1; i <= N; ++i) {
+        fase.lanzar([i, N, hash_por_archivo, &opciones, &pool, &hashes, &originalFileName, &tiempos_por_archivo, &mtx, &errores_verificacion]() {
+            auto inicio = std::chrono::high_resolution_clock::now();
+            std::string encriptadoFileName = std::to_string(i) + ".enc";
+            std::string hashFileName = std::to_string(i) + ".sha";
+            std::string desencriptadoFileName = nombreArchivoDesencriptado(i, N);
+            const std::string& hash_generado = hashes[i-1];
+            const std::string& hash_desencriptado = hashes[N + i - 1];
+
+            std::ofstream hash_ofs(hashFileName);
+            if (hash_ofs.is_open()) {
+                hash_ofs << hash_generado;
+                hash_ofs.close();
+            } else {
+                std::lock_guard<std::mutex> lock(mtx);
+                std::cout << "Error: No se pudo crear el archivo hash: " << hashFileName << std::endl;
+                errores_verificacion = true;
+            }
+
+            std::string hash_leido_para_validacion;
+            std::ifstream hash_ifs(hashFileName);
+            if (hash_ifs.is_open()) {
+                hash_ifs >> hash_leido_para_validacion;
+                hash_ifs.close();
+            } else {
+                std::lock_guard<std::mutex> lock(mtx);
+                std::cout << "Error: No se pudo leer el archivo hash: " << hashFileName << std::endl;
+                errores_verificacion = true;
+            }
+
+            if (!errores_verificacion && hash_desencriptado != hash_leido_para_validacion) {
+                std::lock_guard<std::mutex> lock(mtx);
+                std::cout << "Error de validacion de hash para el archivo " << encriptadoFileName << std::endl;
+                errores_verificacion = true;
+            }
+
+            if (!errores_verificacion) {
+                EtapaTraza etapa("comparar", bytesParaTraza(originalFileName), i);
+                if (!compararArchivos(originalFileName, desencriptadoFileName, opciones.es, &pool)) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    std::cout << "Error: El archivo desencriptado " << desencriptadoFileName << " no coincide con el original." << std::endl;
+                    errores_verificacion = true;
+                }
+            }
+
+            auto fin = std::chrono::high_resolution_clock::now();
+            std::lock_guard<std::mutex> lock(mtx);
+            tiempos_por_archivo[i-1] += hash_por_archivo + std::chrono::duration_cast<std::chrono::microseconds>(fin - inicio).count();
+            std::cout << "Tiempo " << std::setw(2) << std::setfill('0') << i << " : " << formatDuration(tiempos_por_archivo[i-1]) << std::endl;
+        });
+    }
+    fase.esperar();
+}
+
+// Configuración del proceso según la plataforma. La afinidad ya no se fija
+// para todo el proceso: cada thread del pool se fija a su CPU con
+// fijarTrabajador() según la disposición elegida (--afinidad).
+void optimizarConfiguracionPlataforma(const OpcionesPrograma& opciones) {
     // Establecer prioridad alta para el proceso actual
-    SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
-    
-    // Configurar threads para usar todos los núcleos disponibles
-    SetProcessAffinityMask(GetCurrentProcess(), 0xFFFFFFFF);
+    if (opciones.prioridadAlta) {
+        elevarPrioridadProceso();
+    }
+
+    // Detectar la topología antes de que ningún thread restrinja su afinidad
+    topologiaCPU();
+}
+
+// Nombre del archivo desencriptado. El formato del enunciado (i2.txt) choca con
+// las copias a partir de N = 12 (12.txt seria la copia 12 y el desencriptado
+// de la 1), asi que en ese caso se separa el sufijo con '_'.
+std::string nombreArchivoDesencriptado(int i, int N) {
+    if (N < 12) {
+        return std::to_string(i) + "2.txt";
+    }
+    return std::to_string(i) + "_2.txt";
 }
 
 // Función para limpiar archivos existentes antes de ejecutar
@@ -635,7 +2572,7 @@ void limpiarArchivosExistentes(int N) {
         std::string copiaFileName = std::to_string(i) + ".txt";
         std::string encriptadoFileName = std::to_string(i) + ".enc";
         std::string hashFileName = std::to_string(i) + ".sha";
-        std::string desencriptadoFileName = std::to_string(i) + "2.txt";
+        std::string desencriptadoFileName = nombreArchivoDesencriptado(i, N);
         
         // Eliminar archivos si existen (no genera error si no existen)
         remove(copiaFileName.c_str());
@@ -646,3 +2583,89 @@ void limpiarArchivosExistentes(int N) {
     
     std::cout << "Limpieza completada." << std::endl;
 }
+
+
+// Verifica que todas las implementaciones aceleradas disponibles en esta CPU
+// producen los mismos resultados que las versiones de referencia
+bool ejecutarAutoprueba() {
+    bool todo_correcto = true;
+    std::string detalle;
+
+    std::cout << "Autoprueba SHA-256 (backend activo: "
+              << SHA256::nombreBackend(SHA256::backendActivo()) << ")... ";
+    if (SHA256::verificarBackends(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba cifrado SIMD (backend activo: "
+              << nombreBackendCifrado(backendCifradoActivo()) << ")... ";
+    if (verificarKernelsCifrado(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba AES-CTR (AES-NI)... ";
+    if (!aesNIDisponible()) {
+        std::cout << "no disponible en esta CPU" << std::endl;
+    } else if (verificarAESCTR(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba SHA-256 multi-buffer (" << SHA256Lote::carrilesDisponibles() << " carriles)... ";
+    if (SHA256Lote::verificar(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba comparacion SIMD... ";
+    if (verificarKernelsComparacion(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba manifiesto Merkle... ";
+    if (verificarManifiestoMerkle(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba compresion LZ... ";
+    if (verificarCompresionLZ(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba pool de threads... ";
+    if (verificarGrupoTareas(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    std::cout << "Autoprueba filtro de flujo... ";
+    if (verificarFiltroFlujo(detalle)) {
+        std::cout << "OK" << std::endl;
+    } else {
+        std::cout << "FALLO: " << detalle << std::endl;
+        todo_correcto = false;
+    }
+
+    return todo_correcto;
+}